@@ -44,6 +44,8 @@ static char buf[128];
 static size_t buf_pos = 0;
 static DisassemblerParams * params = NULL;
 static uint64_t instr_addr = 0;
+static int instr_flow = 0;
+static uint64_t instr_target = 0;
 static uint8_t * code_buf = NULL;
 static size_t code_pos = 0;
 static size_t code_len = 0;
@@ -357,13 +359,14 @@ static void add_rel(unsigned size) {
         offs = (offs ^ (sign | mask)) + 1;
         add_str("-0x");
         add_hex_uint64(offs);
-        add_addr(instr_addr + code_pos - offs);
+        instr_target = instr_addr + code_pos - offs;
     }
     else {
         add_str("+0x");
         add_hex_uint64(offs);
-        add_addr(instr_addr + code_pos + offs);
+        instr_target = instr_addr + code_pos + offs;
     }
+    add_addr(instr_target);
 }
 
 static void add_modrm(unsigned modrm, unsigned size) {
@@ -484,6 +487,22 @@ static void disassemble_0f(void) {
     uint8_t modrm = 0;
 
     switch (opcode) {
+    case 0x1e:
+        if ((prefix & PREFIX_REPZ) && code_pos < code_len) {
+            switch (code_buf[code_pos]) {
+            case 0xfa:
+                code_pos++;
+                buf_pos = 0;
+                add_str("endbr64");
+                return;
+            case 0xfb:
+                code_pos++;
+                buf_pos = 0;
+                add_str("endbr32");
+                return;
+            }
+        }
+        break;
     case 0x1f:
         modrm = get_code();
         add_str("nop ");
@@ -523,6 +542,7 @@ static void disassemble_0f(void) {
         add_ttt(opcode & 0xf);
         add_char(' ');
         add_rel(4);
+        instr_flow = DISASSEMBLY_FLOW_COND_JUMP;
         return;
     case 0xa0:
         add_str("push fs");
@@ -778,6 +798,7 @@ static void disassemble_instr(void) {
         add_ttt(opcode & 0xf);
         add_char(' ');
         add_rel(1);
+        instr_flow = DISASSEMBLY_FLOW_COND_JUMP;
         return;
     case 0x80:
         modrm = get_code();
@@ -896,6 +917,7 @@ static void disassemble_instr(void) {
         add_char(':');
         if (addr_size <= 2) add_imm16();
         else add_imm32();
+        instr_flow = DISASSEMBLY_FLOW_CALL_INDIRECT;
         return;
     case 0xa0:
         add_str("mov al,");
@@ -968,9 +990,11 @@ static void disassemble_instr(void) {
     case 0xc2:
         add_str("ret ");
         add_imm16();
+        instr_flow = DISASSEMBLY_FLOW_JUMP_INDIRECT;
         return;
     case 0xc3:
         add_str("ret");
+        instr_flow = DISASSEMBLY_FLOW_JUMP_INDIRECT;
         return;
     case 0xc6:
         modrm = get_code();
@@ -1007,9 +1031,11 @@ static void disassemble_instr(void) {
     case 0xca:
         add_str("ret ");
         add_imm16();
+        instr_flow = DISASSEMBLY_FLOW_JUMP_INDIRECT;
         return;
     case 0xcb:
         add_str("ret");
+        instr_flow = DISASSEMBLY_FLOW_JUMP_INDIRECT;
         return;
     case 0xd0:
     case 0xd1:
@@ -1030,20 +1056,24 @@ static void disassemble_instr(void) {
         case 2:
             add_str("jcxz ");
             add_rel(1);
+            instr_flow = DISASSEMBLY_FLOW_COND_JUMP;
             return;
         case 4:
             add_str("jecxz ");
             add_rel(1);
+            instr_flow = DISASSEMBLY_FLOW_COND_JUMP;
             return;
         case 8:
             add_str("jrcxz ");
             add_rel(1);
+            instr_flow = DISASSEMBLY_FLOW_COND_JUMP;
             return;
         }
         break;
     case 0xe8:
         add_str("call ");
         add_rel(addr_size <= 2 ? 2: 4);
+        instr_flow = DISASSEMBLY_FLOW_CALL;
         return;
     case 0xd4:
         add_str("aam");
@@ -1064,10 +1094,12 @@ static void disassemble_instr(void) {
     case 0xe9:
         add_str("jmp ");
         add_rel(4);
+        instr_flow = DISASSEMBLY_FLOW_JUMP;
         return;
     case 0xeb:
         add_str("jmp ");
         add_rel(1);
+        instr_flow = DISASSEMBLY_FLOW_JUMP;
         return;
     case 0xf6:
         modrm = get_code();
@@ -1119,10 +1151,12 @@ static void disassemble_instr(void) {
         case 2:
             add_str("call ");
             add_modrm(modrm, data_size);
+            instr_flow = DISASSEMBLY_FLOW_CALL_INDIRECT;
             return;
         case 4:
             add_str("jmp ");
             add_modrm(modrm, data_size);
+            instr_flow = DISASSEMBLY_FLOW_JUMP_INDIRECT;
             return;
         case 6:
             add_str("push ");
@@ -1135,11 +1169,358 @@ static void disassemble_instr(void) {
     buf_pos = 0;
 }
 
+/*
+ * Instruction length decoder. Unlike the text decoder above, it knows operand layout
+ * of all opcode maps, including SSE, AVX and AVX-512, so control flow info is available
+ * for any code, not only for instructions that have text form.
+ * Returns instruction size, or 0 if the code is not a valid instruction.
+ * '*branch' is set if the instruction can transfer control anywhere but the next instruction.
+ */
+static size_t decode_instr_size(int i64, int * branch) {
+    size_t pos = 0;
+    size_t imm = 0;
+    unsigned op_size = 4;
+    unsigned ad_size = i64 ? 8 : 4;
+    unsigned map = 0;
+    unsigned xop_map = 0;
+    int rex_w = 0;
+    int vex_form = 0;
+    int has_modrm = 0;
+    uint8_t opcode = 0;
+    uint8_t modrm = 0;
+
+    *branch = 0;
+    for (;;) {
+        if (pos >= code_len || pos >= 14) return 0;
+        switch (code_buf[pos]) {
+        case 0x66:
+            op_size = 2;
+            pos++;
+            continue;
+        case 0x67:
+            ad_size = i64 ? 4 : 2;
+            pos++;
+            continue;
+        case 0xf0:
+        case 0xf2:
+        case 0xf3:
+        case 0x2e:
+        case 0x36:
+        case 0x3e:
+        case 0x26:
+        case 0x64:
+        case 0x65:
+            pos++;
+            continue;
+        }
+        break;
+    }
+    if (i64 && (code_buf[pos] & 0xf0) == 0x40) {
+        rex_w = (code_buf[pos] & REX_W) != 0;
+        if (++pos >= code_len) return 0;
+    }
+    opcode = code_buf[pos++];
+    if ((opcode == 0xc4 || opcode == 0xc5 || opcode == 0x62) && pos < code_len && (i64 || code_buf[pos] >= 0xc0)) {
+        /* VEX or EVEX, in 32-bit mode these opcodes are LES, LDS or BOUND if ModRM.mod != 3 */
+        if (opcode == 0xc5) {
+            map = 1;
+            pos += 1;
+        }
+        else if (opcode == 0xc4) {
+            if (pos + 1 >= code_len) return 0;
+            map = code_buf[pos] & 0x1f;
+            rex_w = (code_buf[pos + 1] & 0x80) != 0;
+            pos += 2;
+        }
+        else {
+            map = code_buf[pos] & 0x07;
+            pos += 3;
+        }
+        if (map < 1 || map > 3 || pos >= code_len) return 0;
+        opcode = code_buf[pos++];
+        vex_form = 1;
+    }
+    else if (opcode == 0x8f && pos < code_len && (code_buf[pos] & 0x38) != 0) {
+        /* AMD XOP, otherwise this is POP r/m */
+        xop_map = code_buf[pos] & 0x1f;
+        if (xop_map < 8 || xop_map > 10) return 0;
+        pos += 2;
+        if (pos >= code_len) return 0;
+        opcode = code_buf[pos++];
+        map = 4;
+    }
+    else if (opcode == 0x0f) {
+        if (pos >= code_len) return 0;
+        opcode = code_buf[pos++];
+        map = 1;
+        if (opcode == 0x38 || opcode == 0x3a) {
+            map = opcode == 0x38 ? 2 : 3;
+            if (pos >= code_len) return 0;
+            opcode = code_buf[pos++];
+        }
+    }
+
+    switch (map) {
+    case 0:
+        if (opcode < 0x40) {
+            switch (opcode & 7) {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                has_modrm = 1;
+                break;
+            case 4:
+                imm = 1;
+                break;
+            case 5:
+                imm = op_size;
+                break;
+            default:
+                /* PUSH/POP segment register and BCD adjustment, not valid in 64-bit mode */
+                if (i64) return 0;
+                break;
+            }
+            break;
+        }
+        switch (opcode) {
+        case 0x60:
+        case 0x61:
+        case 0x82:
+        case 0xce:
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+            if (i64) return 0;
+            if (opcode == 0x82) {
+                has_modrm = 1;
+                imm = 1;
+            }
+            else if (opcode == 0xd4 || opcode == 0xd5) imm = 1;
+            else if (opcode == 0xce) *branch = 1;
+            break;
+        case 0x62:
+        case 0x63:
+        case 0xc4:
+        case 0xc5:
+        case 0x84: case 0x85: case 0x86: case 0x87:
+        case 0x88: case 0x89: case 0x8a: case 0x8b:
+        case 0x8c: case 0x8d: case 0x8e: case 0x8f:
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+        case 0xd8: case 0xd9: case 0xda: case 0xdb:
+        case 0xdc: case 0xdd: case 0xde: case 0xdf:
+        case 0xf6:
+        case 0xf7:
+        case 0xfe:
+        case 0xff:
+            has_modrm = 1;
+            break;
+        case 0x68:
+        case 0xa9:
+            imm = op_size;
+            break;
+        case 0x69:
+        case 0x81:
+        case 0xc7:
+            has_modrm = 1;
+            imm = op_size;
+            break;
+        case 0x6a:
+        case 0xa8:
+        case 0xe4: case 0xe5: case 0xe6: case 0xe7:
+            imm = 1;
+            break;
+        case 0x6b:
+        case 0x80:
+        case 0x83:
+        case 0xc0:
+        case 0xc1:
+        case 0xc6:
+            has_modrm = 1;
+            imm = 1;
+            break;
+        case 0x9a:
+        case 0xea:
+            if (i64) return 0;
+            imm = op_size + 2;
+            *branch = 1;
+            break;
+        case 0xa0: case 0xa1: case 0xa2: case 0xa3:
+            imm = ad_size;
+            break;
+        case 0xc2:
+        case 0xca:
+            imm = 2;
+            *branch = 1;
+            break;
+        case 0xc3:
+        case 0xcb:
+        case 0xcc:
+        case 0xcf:
+        case 0xf1:
+            *branch = 1;
+            break;
+        case 0xc8:
+            imm = 3;
+            break;
+        case 0xcd:
+        case 0xe0: case 0xe1: case 0xe2: case 0xe3:
+        case 0xeb:
+            imm = 1;
+            *branch = 1;
+            break;
+        case 0xe8:
+        case 0xe9:
+            imm = i64 ? 4 : op_size;
+            *branch = 1;
+            break;
+        default:
+            if (opcode >= 0x70 && opcode <= 0x7f) {
+                imm = 1;
+                *branch = 1;
+            }
+            else if (opcode >= 0xb0 && opcode <= 0xb7) {
+                imm = 1;
+            }
+            else if (opcode >= 0xb8 && opcode <= 0xbf) {
+                imm = rex_w ? 8 : op_size;
+            }
+            break;
+        }
+        break;
+    case 1:
+        if (vex_form) {
+            /* VZEROUPPER and VZEROALL have no ModRM */
+            has_modrm = opcode != 0x77;
+            if ((opcode >= 0x70 && opcode <= 0x73) || (opcode >= 0xc2 && opcode <= 0xc6)) imm = 1;
+            break;
+        }
+        switch (opcode) {
+        case 0x04:
+        case 0x0a:
+        case 0x0c:
+        case 0x24: case 0x25: case 0x26: case 0x27:
+        case 0x36:
+        case 0x39:
+        case 0x3b: case 0x3c: case 0x3d: case 0x3e: case 0x3f:
+            return 0;
+        case 0x06:
+        case 0x08:
+        case 0x09:
+        case 0x0e:
+        case 0x30: case 0x31: case 0x32: case 0x33:
+        case 0x37:
+        case 0x77:
+        case 0xa0: case 0xa1: case 0xa2:
+        case 0xa8: case 0xa9:
+        case 0xc8: case 0xc9: case 0xca: case 0xcb:
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            break;
+        case 0x05:
+        case 0x07:
+        case 0x0b:
+        case 0x34:
+        case 0x35:
+        case 0xaa:
+            /* SYSCALL, SYSRET, UD2, SYSENTER, SYSEXIT, RSM */
+            *branch = 1;
+            break;
+        case 0x01:
+        case 0xb9:
+        case 0xff:
+            /* VMCALL, VMLAUNCH, UD1, UD0 and similar */
+            has_modrm = 1;
+            *branch = 1;
+            break;
+        case 0x0f:
+        case 0x70: case 0x71: case 0x72: case 0x73:
+        case 0xa4:
+        case 0xac:
+        case 0xba:
+        case 0xc2: case 0xc4: case 0xc5: case 0xc6:
+            has_modrm = 1;
+            imm = 1;
+            break;
+        default:
+            if (opcode >= 0x80 && opcode <= 0x8f) {
+                imm = i64 ? 4 : op_size;
+                *branch = 1;
+            }
+            else {
+                has_modrm = 1;
+            }
+            break;
+        }
+        break;
+    case 2:
+        has_modrm = 1;
+        break;
+    case 3:
+        has_modrm = 1;
+        imm = 1;
+        break;
+    case 4:
+        /* XOP map 8 has imm8, map 10 has imm32 */
+        has_modrm = 1;
+        imm = xop_map == 8 ? 1 : xop_map == 10 ? 4 : 0;
+        break;
+    }
+
+    if (has_modrm) {
+        unsigned mod = 0;
+        unsigned rm = 0;
+        if (pos >= code_len) return 0;
+        modrm = code_buf[pos++];
+        mod = (modrm >> 6) & 3;
+        rm = modrm & 7;
+        if (mod != 3) {
+            if (ad_size == 2) {
+                if (mod == 0 && rm == 6) pos += 2;
+                else pos += mod == 1 ? 1 : mod == 2 ? 2 : 0;
+            }
+            else {
+                if (rm == 4) {
+                    if (pos >= code_len) return 0;
+                    if (mod == 0 && (code_buf[pos] & 7) == 5) pos += 4;
+                    pos++;
+                }
+                if (mod == 0 && rm == 5) pos += 4;
+                else pos += mod == 1 ? 1 : mod == 2 ? 4 : 0;
+            }
+        }
+        if (map == 0) {
+            unsigned reg = (modrm >> 3) & 7;
+            switch (opcode) {
+            case 0xf6:
+                if (reg < 2) imm = 1;
+                break;
+            case 0xf7:
+                if (reg < 2) imm = op_size;
+                break;
+            case 0xc7:
+                /* XBEGIN */
+                if (modrm == 0xf8) *branch = 1;
+                break;
+            case 0xff:
+                /* CALL and JMP */
+                if (reg >= 2 && reg <= 5) *branch = 1;
+                if (reg == 7) return 0;
+                break;
+            }
+        }
+    }
+    pos += imm;
+    if (pos > code_len || pos > 15) return 0;
+    return pos;
+}
+
 static DisassemblyResult * disassemble_x86(uint8_t * code,
         ContextAddress addr, ContextAddress size, int i64,
         DisassemblerParams * disass_params) {
 
     static DisassemblyResult dr;
+    size_t instr_size = 0;
+    int branch = 0;
 
     memset(&dr, 0, sizeof(dr));
     buf_pos = 0;
@@ -1148,6 +1529,8 @@ static DisassemblyResult * disassemble_x86(uint8_t * code,
     code_pos = 0;
 
     instr_addr = addr;
+    instr_flow = DISASSEMBLY_FLOW_NEXT;
+    instr_target = 0;
     params = disass_params;
     x86_64 = i64;
     prefix = 0;
@@ -1227,15 +1610,37 @@ static DisassemblyResult * disassemble_x86(uint8_t * code,
     addr_size = x86_64 ? 8 : 4;
 
     disassemble_instr();
+    instr_size = decode_instr_size(i64, &branch);
 
     dr.text = buf;
-    if (buf_pos == 0 || code_pos > code_len) {
-        snprintf(buf, sizeof(buf), ".byte 0x%02x", code_buf[0]);
-        dr.size = 1;
+    if (buf_pos == 0 || vex != 0 || code_pos > code_len || code_pos != instr_size) {
+        /* No text form, show the bytes. Control flow is known if the instruction does not branch */
+        if (instr_size > 0 && !branch) {
+            size_t i;
+            buf_pos = 0;
+            add_str(".byte ");
+            for (i = 0; i < instr_size; i++) {
+                if (i > 0) add_char(',');
+                add_str("0x");
+                add_char("0123456789abcdef"[code_buf[i] >> 4]);
+                add_char("0123456789abcdef"[code_buf[i] & 0xf]);
+            }
+            buf[buf_pos] = 0;
+            dr.size = instr_size;
+            dr.flow = DISASSEMBLY_FLOW_NEXT;
+        }
+        else {
+            snprintf(buf, sizeof(buf), ".byte 0x%02x", code_buf[0]);
+            dr.size = 1;
+        }
     }
     else {
         buf[buf_pos] = 0;
         dr.size = code_pos;
+        dr.flow = instr_flow;
+        dr.target = (ContextAddress)instr_target;
+        /* E.g. INT3 or SYSCALL: the text decoder has no control flow info for them */
+        if (branch && dr.flow == DISASSEMBLY_FLOW_NEXT) dr.flow = 0;
     }
     return &dr;
 }
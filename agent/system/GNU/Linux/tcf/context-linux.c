@@ -18,6 +18,11 @@
  * This module handles process/thread OS contexts and their state machine.
  */
 
+#if defined(__GNUC__) && !defined(_GNU_SOURCE)
+/* process_vm_readv(), process_vm_writev(), pread() and pwrite() need _GNU_SOURCE */
+#  define _GNU_SOURCE
+#endif
+
 #include <tcf/config.h>
 
 #if defined(__linux__)
@@ -31,6 +36,7 @@
 #include <sched.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <asm/unistd.h>
 #include <sys/utsname.h>
 #include <linux/kdev_t.h>
@@ -61,6 +67,22 @@
 
 #define USE_PTRACE_SYSCALL      0
 
+#if !defined(USE_process_vm_readv)
+#  if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 15))
+#    define USE_process_vm_readv 1
+#  else
+#    define USE_process_vm_readv 0
+#  endif
+#endif
+
+#if !defined(USE_proc_pid_mem)
+#  define USE_proc_pid_mem 1
+#endif
+
+#if USE_process_vm_readv
+#  include <sys/uio.h>
+#endif
+
 static const int PTRACE_FLAGS =
 #if USE_PTRACE_SYSCALL
       PTRACE_O_TRACESYSGOOD |
@@ -96,6 +118,11 @@ typedef struct ContextExtensionLinux {
     int                     sigkill_posted;
     int                     detach_req;
     int                     crt0_done;
+    int                     mem_fd;             /* cached /proc/<pid>/mem file descriptor + 1, 0 if not open */
+    struct MemCache *       mem_cache;          /* process memory cache, valid while all threads are stopped */
+#if USE_process_vm_readv
+    int                     vm_rw_denied;       /* process_vm_readv() failed with EPERM for this process */
+#endif
 #if ENABLE_ProfilerSST
     int                     prof_armed;
     int                     prof_fired;
@@ -113,6 +140,11 @@ static LINK detach_list = TCF_LIST_INIT(detach_list);
 
 static MemoryErrorInfo mem_err_info;
 
+#if USE_process_vm_readv
+/* Set if the kernel does not support process_vm_readv() */
+static int process_vm_rw_disabled = 0;
+#endif
+
 static const char * event_name(int event) {
     switch (event) {
     case 0: return "none";
@@ -647,6 +679,245 @@ int context_can_resume(Context * ctx, int mode) {
     return 0;
 }
 
+#if USE_proc_pid_mem
+static int get_mem_fd(Context * ctx) {
+    ContextExtensionLinux * ext = EXT(ctx);
+    if (ext->mem_fd == 0) {
+        int fd = -1;
+        char file_name[FILE_PATH_SIZE];
+        snprintf(file_name, sizeof(file_name), "/proc/%d/mem", ext->pid);
+        fd = open(file_name, O_RDWR);
+        /* Read-only access is still useful if the file cannot be opened for writing */
+        if (fd < 0) fd = open(file_name, O_RDONLY);
+        if (fd < 0) {
+            trace(LOG_CONTEXT, "context: cannot open %s: %s", file_name, errno_to_str(errno));
+            return -1;
+        }
+        ext->mem_fd = fd + 1;
+    }
+    return ext->mem_fd - 1;
+}
+#endif
+
+static void close_mem_fd(Context * ctx) {
+    ContextExtensionLinux * ext = EXT(ctx);
+    if (ext->mem_fd != 0) {
+        close(ext->mem_fd - 1);
+        ext->mem_fd = 0;
+    }
+}
+
+/*
+ * Read a block of memory using process_vm_readv() or /proc/<pid>/mem.
+ * Returns number of bytes read starting at 'address', which can be less than 'size'.
+ * The caller reads the rest, if any, word by word using ptrace().
+ */
+static size_t read_mem_bulk(Context * ctx, ContextAddress address, void * buf, size_t size) {
+    size_t done = 0;
+#if USE_process_vm_readv
+    while (done < size && !process_vm_rw_disabled && !EXT(ctx->mem)->vm_rw_denied) {
+        struct iovec local;
+        struct iovec remote;
+        ssize_t rd = 0;
+        local.iov_base = (char *)buf + done;
+        local.iov_len = size - done;
+        remote.iov_base = (void *)(uintptr_t)(address + done);
+        remote.iov_len = size - done;
+        rd = process_vm_readv(EXT(ctx)->pid, &local, 1, &remote, 1, 0);
+        if (rd < 0 && errno == ENOSYS) process_vm_rw_disabled = 1;
+        /* Other processes can still allow it, e.g. if this one changed credentials */
+        if (rd < 0 && errno == EPERM) EXT(ctx->mem)->vm_rw_denied = 1;
+        if (rd <= 0) break;
+        done += (size_t)rd;
+    }
+#endif
+#if USE_proc_pid_mem
+    while (done < size) {
+        ssize_t rd = 0;
+        int fd = get_mem_fd(ctx);
+        if (fd < 0) break;
+        /* Note: /proc/<pid>/mem can read pages that are not readable by the process itself */
+        rd = pread(fd, (char *)buf + done, size - done, (off_t)(address + done));
+        if (rd <= 0) break;
+        done += (size_t)rd;
+    }
+#endif
+    return done;
+}
+
+/*
+ * Write a block of memory using process_vm_writev() or /proc/<pid>/mem.
+ * Returns number of bytes written starting at 'address', which can be less than 'size'.
+ * process_vm_writev() cannot write read-only pages, like program code,
+ * /proc/<pid>/mem can, the caller writes the rest, if any, word by word using ptrace().
+ */
+static size_t write_mem_bulk(Context * ctx, ContextAddress address, void * buf, size_t size) {
+    size_t done = 0;
+#if USE_process_vm_readv
+    while (done < size && !process_vm_rw_disabled && !EXT(ctx->mem)->vm_rw_denied) {
+        struct iovec local;
+        struct iovec remote;
+        ssize_t wr = 0;
+        local.iov_base = (char *)buf + done;
+        local.iov_len = size - done;
+        remote.iov_base = (void *)(uintptr_t)(address + done);
+        remote.iov_len = size - done;
+        wr = process_vm_writev(EXT(ctx)->pid, &local, 1, &remote, 1, 0);
+        if (wr < 0 && errno == ENOSYS) process_vm_rw_disabled = 1;
+        /* Other processes can still allow it, e.g. if this one changed credentials */
+        if (wr < 0 && errno == EPERM) EXT(ctx->mem)->vm_rw_denied = 1;
+        if (wr <= 0) break;
+        done += (size_t)wr;
+    }
+#endif
+#if USE_proc_pid_mem
+    while (done < size) {
+        ssize_t wr = 0;
+        int fd = get_mem_fd(ctx);
+        if (fd < 0) break;
+        wr = pwrite(fd, (char *)buf + done, size - done, (off_t)(address + done));
+        if (wr <= 0) break;
+        done += (size_t)wr;
+    }
+#endif
+    return done;
+}
+
+#define MEM_CACHE_PAGE_SIZE     0x1000
+#define MEM_CACHE_HASH_SIZE     127
+#define MEM_CACHE_MAX_PAGES     256
+
+typedef struct MemCachePage {
+    struct MemCachePage * next;
+    ContextAddress addr;
+    uint8_t data[MEM_CACHE_PAGE_SIZE];
+} MemCachePage;
+
+typedef struct MemCache {
+    MemCachePage * hash[MEM_CACHE_HASH_SIZE];
+    unsigned page_cnt;
+    unsigned long hits;
+    unsigned long misses;
+} MemCache;
+
+#define mem_cache_hash(addr) ((unsigned)((addr) / MEM_CACHE_PAGE_SIZE % MEM_CACHE_HASH_SIZE))
+
+/*
+ * Memory cache is only valid while all threads of the process are stopped,
+ * it is flushed when any of the threads is resumed.
+ */
+static int is_mem_cache_enabled(Context * mem) {
+    LINK * l;
+    if (mem->exited || mem->exiting) return 0;
+    if (list_is_empty(&mem->children)) return 0;
+    for (l = mem->children.next; l != &mem->children; l = l->next) {
+        Context * c = cldl2ctxp(l);
+        if (c->exited) continue;
+        if (!c->stopped || c->exiting) return 0;
+    }
+    return 1;
+}
+
+static void flush_mem_cache(Context * mem) {
+    unsigned i;
+    MemCache * cache = EXT(mem)->mem_cache;
+    if (cache == NULL || cache->page_cnt == 0) return;
+    trace(LOG_CONTEXT,
+        "context: flush memory cache ctx %#" PRIxPTR ", id %s, pages %u, hits %lu, misses %lu",
+        (uintptr_t)mem, mem->id, cache->page_cnt, cache->hits, cache->misses);
+    for (i = 0; i < MEM_CACHE_HASH_SIZE; i++) {
+        while (cache->hash[i] != NULL) {
+            MemCachePage * page = cache->hash[i];
+            cache->hash[i] = page->next;
+            loc_free(page);
+        }
+    }
+    cache->page_cnt = 0;
+}
+
+static void free_mem_cache(Context * mem) {
+    ContextExtensionLinux * ext = EXT(mem);
+    if (ext->mem_cache == NULL) return;
+    flush_mem_cache(mem);
+    loc_free(ext->mem_cache);
+    ext->mem_cache = NULL;
+}
+
+static void invalidate_mem_cache(Context * mem, ContextAddress addr, ContextAddress size) {
+    MemCache * cache = EXT(mem)->mem_cache;
+    ContextAddress page_addr = addr & ~((ContextAddress)MEM_CACHE_PAGE_SIZE - 1);
+    if (cache == NULL || cache->page_cnt == 0) return;
+    if (size > (ContextAddress)MEM_CACHE_MAX_PAGES * MEM_CACHE_PAGE_SIZE) {
+        flush_mem_cache(mem);
+        return;
+    }
+    while (page_addr < addr + size) {
+        MemCachePage ** ref = cache->hash + mem_cache_hash(page_addr);
+        while (*ref != NULL) {
+            MemCachePage * page = *ref;
+            if (page->addr == page_addr) {
+                *ref = page->next;
+                loc_free(page);
+                cache->page_cnt--;
+                break;
+            }
+            ref = &page->next;
+        }
+        page_addr += MEM_CACHE_PAGE_SIZE;
+        if (page_addr == 0) break;
+    }
+}
+
+static MemCachePage * get_mem_cache_page(Context * ctx, MemCache * cache, ContextAddress page_addr) {
+    MemCachePage ** ref = cache->hash + mem_cache_hash(page_addr);
+    MemCachePage * page = *ref;
+    while (page != NULL) {
+        if (page->addr == page_addr) {
+            cache->hits++;
+            return page;
+        }
+        page = page->next;
+    }
+    cache->misses++;
+    if (cache->page_cnt >= MEM_CACHE_MAX_PAGES) return NULL;
+    page = (MemCachePage *)loc_alloc(sizeof(MemCachePage));
+    if (read_mem_bulk(ctx, page_addr, page->data, MEM_CACHE_PAGE_SIZE) < MEM_CACHE_PAGE_SIZE) {
+        /* Partially readable pages are not cached */
+        loc_free(page);
+        return NULL;
+    }
+    page->addr = page_addr;
+    page->next = *ref;
+    *ref = page;
+    cache->page_cnt++;
+    return page;
+}
+
+/*
+ * Read memory from the memory cache of the process, load missing pages if needed.
+ * Returns -1 if the cache cannot be used, the caller should read the memory directly.
+ */
+static int read_mem_cache(Context * ctx, ContextAddress address, void * buf, size_t size) {
+    Context * mem = ctx->mem;
+    ContextExtensionLinux * ext = EXT(mem);
+    ContextAddress addr = address;
+
+    if (size > MEM_CACHE_MAX_PAGES / 4 * MEM_CACHE_PAGE_SIZE) return -1;
+    if (!is_mem_cache_enabled(mem)) return -1;
+    if (ext->mem_cache == NULL) ext->mem_cache = (MemCache *)loc_alloc_zero(sizeof(MemCache));
+    while (addr < address + size) {
+        ContextAddress page_addr = addr & ~((ContextAddress)MEM_CACHE_PAGE_SIZE - 1);
+        MemCachePage * page = get_mem_cache_page(ctx, ext->mem_cache, page_addr);
+        size_t offs = (size_t)(addr - page_addr);
+        size_t rd = MEM_CACHE_PAGE_SIZE - offs;
+        if (page == NULL) return -1;
+        if (rd > address + size - addr) rd = (size_t)(address + size - addr);
+        memcpy((char *)buf + (addr - address), page->data + offs, rd);
+        addr += rd;
+    }
+    return 0;
+}
+
 #if ENABLE_MemoryAccessModes
 int context_write_mem_ext(Context * ctx, MemoryAccessMode * mode, ContextAddress address, void * buf, size_t size) {
     return context_write_mem(ctx, address, buf, size);
@@ -657,6 +928,7 @@ int context_write_mem(Context * ctx, ContextAddress address, void * buf, size_t
     ContextAddress word_addr;
     unsigned word_size = context_word_size(ctx);
     ContextExtensionLinux * ext = EXT(ctx);
+    size_t size_bulk = 0;
     int error = 0;
 
     assert(word_size <= sizeof(unsigned long));
@@ -675,7 +947,12 @@ int context_write_mem(Context * ctx, ContextAddress address, void * buf, size_t
         return -1;
     }
     if (check_breakpoints_on_memory_write(ctx, address, buf, size) < 0) return -1;
-    for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
+    invalidate_mem_cache(ctx->mem, address, size);
+    size_bulk = write_mem_bulk(ctx, address, buf, size);
+    if (size_bulk < size) word_addr = (address + size_bulk) & ~((ContextAddress)word_size - 1);
+    else word_addr = address + size;
+    /* Write the rest, if any, word by word */
+    for (; word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         if (word_addr < address || word_addr + word_size > address + size) {
             unsigned i = 0;
@@ -757,6 +1034,7 @@ int context_read_mem(Context * ctx, ContextAddress address, void * buf, size_t s
     unsigned word_size = context_word_size(ctx);
     ContextExtensionLinux * ext = EXT(ctx);
     size_t size_valid = 0;
+    size_t size_bulk = 0;
     int error = 0;
 
     assert(word_size <= sizeof(unsigned long));
@@ -774,7 +1052,14 @@ int context_read_mem(Context * ctx, ContextAddress address, void * buf, size_t s
         errno = EFAULT;
         return -1;
     }
-    for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
+    if (read_mem_cache(ctx, address, buf, size) == 0) {
+        return check_breakpoints_on_memory_read(ctx, address, buf, size);
+    }
+    size_bulk = read_mem_bulk(ctx, address, buf, size);
+    if (size_bulk < size) word_addr = (address + size_bulk) & ~((ContextAddress)word_size - 1);
+    else word_addr = address + size;
+    /* Read the rest, if any, word by word */
+    for (; word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         errno = 0;
         word = ptrace(PTRACE_PEEKDATA, ext->pid, (void *)word_addr, 0);
@@ -1478,6 +1763,14 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
         }
         break;
     case PTRACE_EVENT_EXEC:
+        /* Cached /proc/<pid>/mem refers to the old address space */
+        close_mem_fd(ctx);
+        close_mem_fd(ctx->mem);
+        flush_mem_cache(ctx->mem);
+#if USE_process_vm_readv
+        /* The new program can have different credentials */
+        EXT(ctx->mem)->vm_rw_denied = 0;
+#endif
         invalidate_breakpoints_on_process_exec(ctx);
         send_context_changed_event(ctx);
         memory_map_event_mapping_changed(ctx->mem);
@@ -1756,9 +2049,46 @@ static int cmp_linux_kernel_name(Context * ctx, const char * v) {
     return (strcmp(un.sysname, v)== 0);
 }
 
+static void event_context_exited(Context * ctx, void * args) {
+    close_mem_fd(ctx);
+    free_mem_cache(ctx);
+}
+
+static void event_context_started(Context * ctx, void * args) {
+    if (ctx->mem != NULL) flush_mem_cache(ctx->mem);
+}
+
+#if SERVICE_MemoryMap
+static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * args) {
+    if (ctx->mem != NULL) invalidate_mem_cache(ctx->mem, addr, size);
+}
+
+static void event_mapping_changed(Context * ctx, void * args) {
+    if (ctx->mem != NULL) flush_mem_cache(ctx->mem);
+}
+#endif
+
 void init_contexts_sys_dep(void) {
+    static ContextEventListener listener = {
+        NULL,
+        event_context_exited,
+        NULL,
+        event_context_started
+    };
+#if SERVICE_MemoryMap
+    static MemoryMapEventListener map_listener = {
+        event_mapping_changed,
+        event_code_unmapped,
+        event_mapping_changed,
+        event_mapping_changed
+    };
+#endif
     context_extension_offset = context_extension(sizeof(ContextExtensionLinux));
     add_waitpid_listener(waitpid_listener, NULL);
+    add_context_event_listener(&listener, NULL);
+#if SERVICE_MemoryMap
+    add_memory_map_event_listener(&map_listener, NULL);
+#endif
     ini_context_pid_hash();
 #if SERVICE_Expressions && ENABLE_ELF
     add_identifier_callback(expression_identifier_callback);
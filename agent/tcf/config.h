@@ -279,6 +279,45 @@
 #  endif
 #endif
 
+#if !defined(ENABLE_AsyncReqEpoll)
+/* Complete socket async requests on a single epoll thread instead of blocking worker threads */
+#  if defined(__linux__)
+#    define ENABLE_AsyncReqEpoll 1
+#  else
+#    define ENABLE_AsyncReqEpoll 0
+#  endif
+#endif
+
+#if !defined(ENABLE_AsyncReqUring)
+/* Submit file async requests to io_uring, completions are reaped by the epoll thread */
+#  if ENABLE_AsyncReqEpoll && defined(__has_include)
+#    if __has_include(<linux/io_uring.h>)
+#      define ENABLE_AsyncReqUring 1
+#    endif
+#  endif
+#  if !defined(ENABLE_AsyncReqUring)
+#    define ENABLE_AsyncReqUring 0
+#  endif
+#endif
+
+#if !defined(ENABLE_AsyncReqSendMsg)
+/* Support gather write of socket data with a single sendmsg() call */
+#  if defined(_WIN32) || defined(__SYMBIAN32__)
+#    define ENABLE_AsyncReqSendMsg 0
+#  else
+#    define ENABLE_AsyncReqSendMsg 1
+#  endif
+#endif
+
+#if !defined(ENABLE_DwarfDiskCache)
+/* On-disk cache of DWARF indices, the cache is used only if enabled by -C command line option */
+#  if defined(_WIN32) || defined(__SYMBIAN32__)
+#    define ENABLE_DwarfDiskCache 0
+#  else
+#    define ENABLE_DwarfDiskCache (ENABLE_ELF && ENABLE_DebugContext)
+#  endif
+#endif
+
 #if !defined(ENABLE_STREAM_MACROS)
 /* Enabling stream macros increases code size about 5%, and increases speed about 7% */
 #  define ENABLE_STREAM_MACROS  0
@@ -341,6 +380,18 @@
 #  define ENABLE_ProfilerSST (SERVICE_Profiler && SERVICE_RunControl && SERVICE_StackTrace && ENABLE_DebugContext)
 #endif
 
+#if !defined(ENABLE_ProfilerPerf)
+/* Collect profiler samples with perf_event_open() instead of stopping the target */
+#  if ENABLE_ProfilerSST && defined(__linux__) && defined(__has_include)
+#    if __has_include(<linux/perf_event.h>)
+#      define ENABLE_ProfilerPerf 1
+#    endif
+#  endif
+#  if !defined(ENABLE_ProfilerPerf)
+#    define ENABLE_ProfilerPerf 0
+#  endif
+#endif
+
 #if !defined(ENABLE_ContextIdHashTable)
 #  define ENABLE_ContextIdHashTable (ENABLE_DebugContext && !ENABLE_ContextProxy && TARGET_WINDOWS)
 #endif
@@ -30,6 +30,16 @@
 #else
 #  include <sys/wait.h>
 #endif
+#if ENABLE_AsyncReqEpoll
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#endif
+#if ENABLE_AsyncReqUring
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/sysmacros.h>
+#  include <linux/io_uring.h>
+#endif
 #include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/mdep-inet.h>
 #include <tcf/framework/mdep-fs.h>
@@ -40,22 +50,86 @@
 #include <tcf/framework/asyncreq.h>
 #include <tcf/framework/shutdown.h>
 
+#ifndef MIN_WORKER_THREADS
+#define MIN_WORKER_THREADS 2
+#endif
+
 #ifndef MAX_WORKER_THREADS
-#define MAX_WORKER_THREADS 32
+#define MAX_WORKER_THREADS 128
+#endif
+
+#ifndef WORKER_THREAD_IDLE_TIMEOUT
+#define WORKER_THREAD_IDLE_TIMEOUT 30
+#endif
+
+#ifndef WORKER_POOL_STATS_INTERVAL
+#define WORKER_POOL_STATS_INTERVAL 10
 #endif
 
 #ifndef EVENTS_TIMER_RESOLUTION
 #define EVENTS_TIMER_RESOLUTION 50
 #endif
 
+#if !defined(USE_CLOCK_MONOTONIC)
+#  if defined(__UCLIBC__)
+#    define USE_CLOCK_MONOTONIC 0
+#  elif defined(__linux__) && !(defined(ANDROID) && defined(HAVE_PTHREAD_COND_TIMEDWAIT_MONOTONIC))
+#    define USE_CLOCK_MONOTONIC 1
+#  elif (defined(_WIN32) || defined(__CYGWIN__)) && !defined(DISABLE_PTHREADS_WIN32)
+#    define USE_CLOCK_MONOTONIC 1
+#  else
+#    define USE_CLOCK_MONOTONIC 0
+#  endif
+#endif
+
+#if USE_CLOCK_MONOTONIC
+#  define WORKER_CLOCK_TYPE CLOCK_MONOTONIC
+#else
+#  define WORKER_CLOCK_TYPE CLOCK_REALTIME
+#endif
+
 static LINK wtlist = TCF_LIST_INIT(wtlist);
 static int wtlist_size = 0;
 static int wtrunning_count = 0;
+static int wtthread_count = 0;
+static int wtblocking_count = 0;
 static pthread_mutex_t wtlock;
 
+/* Threads that run requests which can block indefinitely are not counted in the pool size */
+#define wtpool_size() (wtthread_count - wtblocking_count)
+
+/* Pool limits, see async_req_set_pool_limits() */
+static int wtmin = MIN_WORKER_THREADS;
+static int wtmax = MAX_WORKER_THREADS;
+static int wtidle_timeout = WORKER_THREAD_IDLE_TIMEOUT;
+
+/* Requests waiting for a free worker thread, one FIFO per priority */
+#define REQ_PRIORITY_HIGH   0   /* Processes and sockets */
+#define REQ_PRIORITY_NORMAL 1   /* File system metadata, user requests */
+#define REQ_PRIORITY_LOW    2   /* Bulk file data */
+#define REQ_PRIORITY_CNT    3
+
+typedef struct QueuedReq {
+    LINK link;
+    AsyncReqInfo * req;
+    struct timespec time;
+} QueuedReq;
+
+#define link2qreq(A)  ((QueuedReq *)((char *)(A) - offsetof(QueuedReq, link)))
+
+static LINK wtqueue[REQ_PRIORITY_CNT];
+static int wtqueue_size = 0;
+
+/* Pool statistics since last report */
+static int stat_queue_max = 0;
+static unsigned stat_queued_cnt = 0;
+static uint64_t stat_wait_total = 0;
+static uint64_t stat_wait_max = 0;
+
 typedef struct WorkerThread {
     LINK wtlink;
     AsyncReqInfo * req;
+    int blocking;
     pthread_cond_t cond;
     pthread_t thread;
 } WorkerThread;
@@ -74,6 +148,7 @@ static void trigger_async_shutdown(ShutdownInfo * obj) {
         list_remove(&wt->wtlink);
         wtlist_size--;
         assert(wt->req == NULL);
+        wtthread_count--;
         wt->req = &shutdown_req;
         check_error(pthread_cond_signal(&wt->cond));
     }
@@ -95,6 +170,121 @@ static void worker_thread_exit(void * x) {
     loc_free(wt);
 }
 
+static int get_req_priority(AsyncReqInfo * req) {
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqSend:
+    case AsyncReqRecvFrom:
+    case AsyncReqSendTo:
+    case AsyncReqSendMsg:
+    case AsyncReqAccept:
+    case AsyncReqConnect:
+    case AsyncReqConnectPipe:
+    case AsyncReqWaitpid:
+    case AsyncReqSelect:
+        return REQ_PRIORITY_HIGH;
+    case AsyncReqRead:
+    case AsyncReqWrite:
+    case AsyncReqSeekRead:
+    case AsyncReqSeekWrite:
+    case AsyncReqReadDir:
+        return REQ_PRIORITY_LOW;
+    }
+    return REQ_PRIORITY_NORMAL;
+}
+
+/*
+ * Requests that wait for another process, a peer or a device can block indefinitely.
+ * Such requests are never queued and don't count against the pool size limit,
+ * otherwise they could occupy all worker threads and starve short requests.
+ */
+static int is_blocking_req(AsyncReqInfo * req) {
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqSend:
+    case AsyncReqRecvFrom:
+    case AsyncReqSendTo:
+    case AsyncReqSendMsg:
+    case AsyncReqAccept:
+    case AsyncReqConnectPipe:
+    case AsyncReqWaitpid:
+    case AsyncReqSelect:
+        return 1;
+    case AsyncReqRead:
+    case AsyncReqWrite:
+        /* Pipes, terminals and serial ports */
+        {
+            struct stat st;
+            if (fstat(req->u.fio.fd, &st) < 0) return 0;
+#if defined(S_ISBLK)
+            if (S_ISBLK(st.st_mode)) return 0;
+#endif
+            return (st.st_mode & S_IFMT) != S_IFREG;
+        }
+    }
+    return 0;
+}
+
+/* Remove first request from the queue, returns NULL if the queue is empty. Must be called with wtlock */
+static AsyncReqInfo * worker_queue_get(void) {
+    int i;
+
+    for (i = 0; i < REQ_PRIORITY_CNT; i++) {
+        if (!list_is_empty(wtqueue + i)) {
+            QueuedReq * q = link2qreq(wtqueue[i].next);
+            AsyncReqInfo * req = q->req;
+            struct timespec timenow;
+            uint64_t wait = 0;
+            list_remove(&q->link);
+            wtqueue_size--;
+            if (clock_gettime(CLOCK_MONOTONIC, &timenow) == 0) {
+                wait = (uint64_t)(timenow.tv_sec - q->time.tv_sec) * 1000000 +
+                    (timenow.tv_nsec - q->time.tv_nsec) / 1000;
+            }
+            stat_wait_total += wait;
+            if (wait > stat_wait_max) stat_wait_max = wait;
+            loc_free(q);
+            return req;
+        }
+    }
+    return NULL;
+}
+
+/* Get next request for a worker thread, returns 0 if the thread should exit. Must be called with wtlock */
+static int worker_thread_next(WorkerThread * wt) {
+    struct timespec timeout;
+
+    assert(wt->req == NULL);
+    assert(!wt->blocking);
+    wt->req = worker_queue_get();
+    if (wt->req != NULL) return 1;
+    if (async_shutdown.state == SHUTDOWN_STATE_PENDING) {
+        wtthread_count--;
+        return 0;
+    }
+    list_add_last(&wt->wtlink, &wtlist);
+    wtlist_size++;
+    if (clock_gettime(WORKER_CLOCK_TYPE, &timeout)) check_error(errno);
+    timeout.tv_sec += wtidle_timeout;
+    while (wt->req == NULL) {
+        if (wtpool_size() > wtmin) {
+            int error = pthread_cond_timedwait(&wt->cond, &wtlock, &timeout);
+            if (error == ETIMEDOUT && wt->req == NULL && wtpool_size() > wtmin) {
+                /* Idle for too long, the pool has more threads than the minimum */
+                list_remove(&wt->wtlink);
+                wtlist_size--;
+                wtthread_count--;
+                return 0;
+            }
+            if (error && error != ETIMEDOUT) check_error(error);
+        }
+        else {
+            check_error(pthread_cond_wait(&wt->cond, &wtlock));
+        }
+    }
+    return 1;
+}
+
 static void * worker_thread_handler(void * x) {
     WorkerThread * wt = (WorkerThread *)x;
 
@@ -184,6 +374,22 @@ static void * worker_thread_handler(void * x) {
             }
             break;
 
+#if ENABLE_AsyncReqSendMsg
+        case AsyncReqSendMsg:           /* Socket sendmsg */
+            {
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = req->u.sio.iov;
+                msg.msg_iovlen = req->u.sio.iovcnt;
+                req->u.sio.rval = sendmsg(req->u.sio.sock, &msg, req->u.sio.flags);
+                if (req->u.sio.rval == -1) {
+                    req->error = errno;
+                    assert(req->error);
+                }
+            }
+            break;
+#endif
+
         case AsyncReqAccept:            /* Accept socket connections */
             req->u.acc.rval = accept(req->u.acc.sock, req->u.acc.addr, req->u.acc.addr ? &req->u.acc.addrlen : NULL);
             if (req->u.acc.rval == -1) {
@@ -520,16 +726,14 @@ static void * worker_thread_handler(void * x) {
         /* Post event inside lock to make sure a new worker thread is not created unnecessarily */
         post_event(req->done, req);
         wt->req = NULL;
-        if (wtlist_size >= MAX_WORKER_THREADS || async_shutdown.state == SHUTDOWN_STATE_PENDING) {
+        if (wt->blocking) {
+            wt->blocking = 0;
+            wtblocking_count--;
+        }
+        if (!worker_thread_next(wt)) {
             check_error(pthread_mutex_unlock(&wtlock));
             break;
         }
-        list_add_last(&wt->wtlink, &wtlist);
-        wtlist_size++;
-        for (;;) {
-            check_error(pthread_cond_wait(&wt->cond, &wtlock));
-            if (wt->req != NULL) break;
-        }
         check_error(pthread_mutex_unlock(&wtlock));
         if (wt->req == &shutdown_req) break;
     }
@@ -537,26 +741,922 @@ static void * worker_thread_handler(void * x) {
     return NULL;
 }
 
-static void worker_thread_add(AsyncReqInfo * req) {
-    WorkerThread * wt;
-
+static void worker_thread_add(WorkerThread * wt) {
     assert(is_dispatch_thread());
-    wt = (WorkerThread *)loc_alloc_zero(sizeof *wt);
-    wt->req = req;
+#if USE_CLOCK_MONOTONIC
+    {
+        pthread_condattr_t attr;
+        check_error(pthread_condattr_init(&attr));
+        check_error(pthread_condattr_setclock(&attr, WORKER_CLOCK_TYPE));
+        check_error(pthread_cond_init(&wt->cond, &attr));
+        check_error(pthread_condattr_destroy(&attr));
+    }
+#else
     check_error(pthread_cond_init(&wt->cond, NULL));
+#endif
     check_error(pthread_create(&wt->thread, &pthread_create_attr, worker_thread_handler, wt));
     if (wtrunning_count++ == 0) shutdown_set_normal(&async_shutdown);
     trace(LOG_ASYNCREQ, "worker_thread_add %p running threads %d", wt, wtrunning_count);
 }
 
 static void worker_thread_add_deferred(void * x) {
-    AsyncReqInfo * req = (AsyncReqInfo *)x;
+    check_error(pthread_mutex_lock(&wtlock));
+    worker_thread_add((WorkerThread *)x);
+    check_error(pthread_mutex_unlock(&wtlock));
+}
+
+/* Start a new worker thread for a request. Must be called with wtlock */
+static void worker_thread_start(AsyncReqInfo * req, int blocking) {
+    WorkerThread * wt = (WorkerThread *)loc_alloc_zero(sizeof *wt);
+
+    wt->req = req;
+    wt->blocking = blocking;
+    /* The timer thread runs forever and is not counted in the pool size */
+    if (req->type != AsyncReqTimer) wtthread_count++;
+    if (blocking) wtblocking_count++;
+    if (is_dispatch_thread()) {
+        worker_thread_add(wt);
+    }
+    else {
+        post_event(worker_thread_add_deferred, wt);
+    }
+}
+
+static void worker_thread_post(AsyncReqInfo * req) {
+    int blocking = is_blocking_req(req);
 
     check_error(pthread_mutex_lock(&wtlock));
-    worker_thread_add(req);
+    if (req->type != AsyncReqTimer && !list_is_empty(&wtlist)) {
+        WorkerThread * wt = wtlink2wt(wtlist.next);
+        list_remove(&wt->wtlink);
+        wtlist_size--;
+        assert(wt->req == NULL);
+        wt->req = req;
+        wt->blocking = blocking;
+        if (blocking) wtblocking_count++;
+        check_error(pthread_cond_signal(&wt->cond));
+    }
+    else if (req->type == AsyncReqTimer || blocking || wtpool_size() < wtmax) {
+        worker_thread_start(req, blocking);
+    }
+    else {
+        QueuedReq * q = (QueuedReq *)loc_alloc_zero(sizeof(QueuedReq));
+        q->req = req;
+        if (clock_gettime(CLOCK_MONOTONIC, &q->time)) check_error(errno);
+        list_add_last(&q->link, wtqueue + get_req_priority(req));
+        if (++wtqueue_size > stat_queue_max) stat_queue_max = wtqueue_size;
+        stat_queued_cnt++;
+        trace(LOG_ASYNCREQ, "async_req_post: req %p, type %d, queued, queue size %d", req, req->type, wtqueue_size);
+    }
     check_error(pthread_mutex_unlock(&wtlock));
 }
 
+#if ENABLE_AsyncReqEpoll
+/*
+ * Socket requests are completed by a single reactor thread: the operation is
+ * attempted without blocking, and if it would block, the request waits until
+ * epoll reports the socket ready. Worker threads are used only for requests
+ * that cannot be done this way.
+ */
+
+#define REACTOR_MAX_EVENTS 64
+
+typedef struct ReactorOp ReactorOp;
+
+typedef struct ReactorWait {
+    LINK link_fd;
+    ReactorOp * op;
+    int fd;
+    uint32_t events;
+} ReactorWait;
+
+#define REACTOR_CONNECT_NONE        0   /* connect() not called yet */
+#define REACTOR_CONNECT_IN_PROGRESS 1   /* connect() returned EINPROGRESS, result is reported by SO_ERROR */
+#define REACTOR_CONNECT_RETRY       2   /* AF_UNIX connect() returned EAGAIN, call it again when writable */
+#define REACTOR_CONNECT_BLOCKING    3   /* Listener backlog is still full, pass the request to a worker thread */
+
+struct ReactorOp {
+    LINK link_all;
+    AsyncReqInfo * req;
+    uint64_t deadline;          /* AsyncReqSelect timeout time, ms */
+    int fd_flags;               /* Original socket flags if changed by AsyncReqConnect, -1 otherwise */
+    int connect_state;          /* AsyncReqConnect progress, see REACTOR_CONNECT_* */
+    fd_set readfds;             /* Original AsyncReqSelect file descriptor sets */
+    fd_set writefds;
+    fd_set errorfds;
+    unsigned wait_cnt;
+    ReactorWait * waits;
+};
+
+typedef struct ReactorFd {
+    LINK waits;
+    uint32_t events;            /* Events registered in epoll */
+} ReactorFd;
+
+#define link_fd2wait(A) ((ReactorWait *)((char *)(A) - offsetof(ReactorWait, link_fd)))
+#define link_all2op(A)  ((ReactorOp *)((char *)(A) - offsetof(ReactorOp, link_all)))
+
+static int reactor_epoll = -1;
+static int reactor_wakeup = -1;
+static int reactor_created = 0;
+static int reactor_stopped = 1;
+static int reactor_exiting = 0;
+static pthread_t reactor_thread;
+static pthread_mutex_t reactor_lock;
+static LINK reactor_queue = TCF_LIST_INIT(reactor_queue);
+
+/* Owned by the reactor thread */
+static LINK reactor_ops = TCF_LIST_INIT(reactor_ops);
+static ReactorFd ** reactor_fds = NULL;
+static unsigned reactor_fds_max = 0;
+
+static void reactor_create(void);
+
+static void trigger_reactor_shutdown(ShutdownInfo * obj) {
+    uint64_t cnt = 1;
+    check_error(pthread_mutex_lock(&reactor_lock));
+    reactor_exiting = 1;
+    if (write(reactor_wakeup, &cnt, sizeof(cnt)) < 0) trace(LOG_ALWAYS, "Can't wake up reactor: %s", errno_to_str(errno));
+    check_error(pthread_mutex_unlock(&reactor_lock));
+}
+
+static ShutdownInfo reactor_shutdown = { trigger_reactor_shutdown };
+
+static uint64_t reactor_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int is_reactor_req(AsyncReqInfo * req) {
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqSend:
+    case AsyncReqRecvFrom:
+    case AsyncReqSendTo:
+    case AsyncReqSendMsg:
+    case AsyncReqAccept:
+    case AsyncReqConnect:
+        return 1;
+    case AsyncReqSelect:
+        return req->u.select.nfds >= 0 && req->u.select.nfds <= FD_SETSIZE;
+    }
+    return 0;
+}
+
+static int reactor_update_fd(int fd) {
+    ReactorFd * f = reactor_fds[fd];
+    struct epoll_event event;
+    uint32_t events = 0;
+    LINK * l;
+
+    for (l = f->waits.next; l != &f->waits; l = l->next) events |= link_fd2wait(l)->events;
+    if (events == f->events) return 0;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (events == 0) {
+        /* The descriptor can be closed already, ignore errors */
+        epoll_ctl(reactor_epoll, EPOLL_CTL_DEL, fd, &event);
+    }
+    else if (epoll_ctl(reactor_epoll, f->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) {
+        /* The descriptor was closed and reused, or registration was left from a closed one */
+        int error = errno;
+        if (error == ENOENT && epoll_ctl(reactor_epoll, EPOLL_CTL_ADD, fd, &event) == 0) error = 0;
+        else if (error == EEXIST && epoll_ctl(reactor_epoll, EPOLL_CTL_MOD, fd, &event) == 0) error = 0;
+        if (error) {
+            f->events = 0;
+            errno = error;
+            return -1;
+        }
+    }
+    f->events = events;
+    return 0;
+}
+
+/* Try to complete the request without blocking, return 0 if it would block */
+static int reactor_try(ReactorOp * op) {
+    AsyncReqInfo * req = op->req;
+
+    req->error = 0;
+    switch (req->type) {
+    case AsyncReqRecv:
+        req->u.sio.rval = recv(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT);
+        if (req->u.sio.rval == -1) req->error = errno;
+        break;
+
+    case AsyncReqSend:
+        req->u.sio.rval = send(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT);
+        if (req->u.sio.rval == -1) req->error = errno;
+        break;
+
+    case AsyncReqRecvFrom:
+        req->u.sio.rval = recvfrom(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT,
+            req->u.sio.addr, &req->u.sio.addrlen);
+        if (req->u.sio.rval == -1) req->error = errno;
+        break;
+
+    case AsyncReqSendTo:
+        req->u.sio.rval = sendto(req->u.sio.sock, req->u.sio.bufp, req->u.sio.bufsz, req->u.sio.flags | MSG_DONTWAIT,
+            req->u.sio.addr, req->u.sio.addrlen);
+        if (req->u.sio.rval == -1) req->error = errno;
+        break;
+
+    case AsyncReqSendMsg:
+        {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = req->u.sio.iov;
+            msg.msg_iovlen = req->u.sio.iovcnt;
+            req->u.sio.rval = sendmsg(req->u.sio.sock, &msg, req->u.sio.flags | MSG_DONTWAIT);
+            if (req->u.sio.rval == -1) req->error = errno;
+        }
+        break;
+
+    case AsyncReqAccept:
+        {
+            /* Listening socket is switched to non-blocking mode only for the duration of the call */
+            int flags = fcntl(req->u.acc.sock, F_GETFL);
+            if (flags < 0 || (!(flags & O_NONBLOCK) && fcntl(req->u.acc.sock, F_SETFL, flags | O_NONBLOCK) < 0)) {
+                req->u.acc.rval = -1;
+                req->error = errno;
+                break;
+            }
+            req->u.acc.rval = accept(req->u.acc.sock, req->u.acc.addr, req->u.acc.addr ? &req->u.acc.addrlen : NULL);
+            if (req->u.acc.rval == -1) req->error = errno;
+            if (!(flags & O_NONBLOCK)) fcntl(req->u.acc.sock, F_SETFL, flags);
+        }
+        break;
+
+    case AsyncReqConnect:
+        if (op->connect_state == REACTOR_CONNECT_IN_PROGRESS) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(req->u.con.sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0) err = errno;
+            req->u.con.rval = err ? -1 : 0;
+            req->error = err;
+            return 1;
+        }
+        if (op->connect_state == REACTOR_CONNECT_NONE) {
+            int flags = fcntl(req->u.con.sock, F_GETFL);
+            if (flags < 0 || (!(flags & O_NONBLOCK) && fcntl(req->u.con.sock, F_SETFL, flags | O_NONBLOCK) < 0)) {
+                req->u.con.rval = -1;
+                req->error = errno;
+                return 1;
+            }
+            if (!(flags & O_NONBLOCK)) op->fd_flags = flags;
+        }
+        req->u.con.rval = connect(req->u.con.sock, req->u.con.addr, req->u.con.addrlen);
+        if (req->u.con.rval == -1) {
+            req->error = errno;
+            if (req->error == EINPROGRESS) {
+                op->connect_state = REACTOR_CONNECT_IN_PROGRESS;
+                return 0;
+            }
+            if ((req->error == EAGAIN || req->error == EWOULDBLOCK) && req->u.con.addr->sa_family == AF_UNIX) {
+                /* Listener backlog is full. Epoll reports unconnected AF_UNIX sockets writable
+                 * right away, so if the second attempt fails too, only a blocking connect() can wait */
+                if (op->connect_state == REACTOR_CONNECT_NONE) {
+                    op->connect_state = REACTOR_CONNECT_RETRY;
+                    return 0;
+                }
+                op->connect_state = REACTOR_CONNECT_BLOCKING;
+            }
+        }
+        return 1;
+
+    case AsyncReqSelect:
+        {
+            struct timeval tv;
+            memset(&tv, 0, sizeof(tv));
+            memcpy(&req->u.select.readfds, &op->readfds, sizeof(fd_set));
+            memcpy(&req->u.select.writefds, &op->writefds, sizeof(fd_set));
+            memcpy(&req->u.select.errorfds, &op->errorfds, sizeof(fd_set));
+            req->u.select.rval = select(req->u.select.nfds, &req->u.select.readfds,
+                        &req->u.select.writefds, &req->u.select.errorfds, &tv);
+            if (req->u.select.rval == -1) req->error = errno;
+            else if (req->u.select.rval == 0 && reactor_time() < op->deadline) return 0;
+        }
+        return 1;
+
+    default:
+        assert(0);
+    }
+    return req->error != EAGAIN && req->error != EWOULDBLOCK;
+}
+
+static void reactor_done(ReactorOp * op) {
+    AsyncReqInfo * req = op->req;
+    unsigned i;
+
+    if (op->waits != NULL) {
+        /* The request was waiting in reactor_ops */
+        for (i = 0; i < op->wait_cnt; i++) {
+            list_remove(&op->waits[i].link_fd);
+            reactor_update_fd(op->waits[i].fd);
+        }
+        list_remove(&op->link_all);
+        loc_free(op->waits);
+    }
+    if (op->fd_flags >= 0) fcntl(req->u.con.sock, F_SETFL, op->fd_flags);
+    if (op->connect_state == REACTOR_CONNECT_BLOCKING) {
+        loc_free(op);
+        trace(LOG_ASYNCREQ, "async_req_post: req %p, type %d, listener backlog is full, using worker thread", req, req->type);
+        worker_thread_post(req);
+        return;
+    }
+    loc_free(op);
+    trace(LOG_ASYNCREQ, "async_req_complete: req %p, type %d, error %d", req, req->type, req->error);
+    post_event(req->done, req);
+}
+
+static int reactor_add_wait(ReactorOp * op, int fd, uint32_t events) {
+    ReactorWait * w = op->waits + op->wait_cnt++;
+
+    if ((unsigned)fd >= reactor_fds_max) {
+        unsigned max = reactor_fds_max;
+        reactor_fds_max = fd + 64;
+        reactor_fds = (ReactorFd **)loc_realloc(reactor_fds, sizeof(ReactorFd *) * reactor_fds_max);
+        memset(reactor_fds + max, 0, sizeof(ReactorFd *) * (reactor_fds_max - max));
+    }
+    if (reactor_fds[fd] == NULL) {
+        reactor_fds[fd] = (ReactorFd *)loc_alloc_zero(sizeof(ReactorFd));
+        list_init(&reactor_fds[fd]->waits);
+    }
+    w->op = op;
+    w->fd = fd;
+    w->events = events;
+    list_add_last(&w->link_fd, &reactor_fds[fd]->waits);
+    return reactor_update_fd(fd);
+}
+
+static void reactor_wait(ReactorOp * op) {
+    AsyncReqInfo * req = op->req;
+    int error = 0;
+    unsigned i;
+
+    list_add_last(&op->link_all, &reactor_ops);
+    switch (req->type) {
+    case AsyncReqRecv:
+    case AsyncReqRecvFrom:
+        op->waits = (ReactorWait *)loc_alloc_zero(sizeof(ReactorWait));
+        if (reactor_add_wait(op, req->u.sio.sock, EPOLLIN) < 0) error = errno;
+        break;
+    case AsyncReqSend:
+    case AsyncReqSendTo:
+    case AsyncReqSendMsg:
+        op->waits = (ReactorWait *)loc_alloc_zero(sizeof(ReactorWait));
+        if (reactor_add_wait(op, req->u.sio.sock, EPOLLOUT) < 0) error = errno;
+        break;
+    case AsyncReqAccept:
+        op->waits = (ReactorWait *)loc_alloc_zero(sizeof(ReactorWait));
+        if (reactor_add_wait(op, req->u.acc.sock, EPOLLIN) < 0) error = errno;
+        break;
+    case AsyncReqConnect:
+        op->waits = (ReactorWait *)loc_alloc_zero(sizeof(ReactorWait));
+        if (reactor_add_wait(op, req->u.con.sock, EPOLLOUT) < 0) error = errno;
+        break;
+    case AsyncReqSelect:
+        op->waits = (ReactorWait *)loc_alloc_zero(sizeof(ReactorWait) * (req->u.select.nfds + 1));
+        for (i = 0; i < (unsigned)req->u.select.nfds && !error; i++) {
+            uint32_t events = 0;
+            if (FD_ISSET(i, &op->readfds)) events |= EPOLLIN;
+            if (FD_ISSET(i, &op->writefds)) events |= EPOLLOUT;
+            if (FD_ISSET(i, &op->errorfds)) events |= EPOLLPRI;
+            if (events && reactor_add_wait(op, i, events) < 0) error = errno;
+        }
+        break;
+    }
+    if (error) {
+        trace(LOG_ASYNCREQ, "async_req_post: req %p, type %d, cannot use epoll: %s", req, req->type, errno_to_str(error));
+        if (req->type == AsyncReqConnect) {
+            req->u.con.rval = -1;
+            req->error = error;
+            reactor_done(op);
+            return;
+        }
+        if (req->type == AsyncReqSelect) {
+            memcpy(&req->u.select.readfds, &op->readfds, sizeof(fd_set));
+            memcpy(&req->u.select.writefds, &op->writefds, sizeof(fd_set));
+            memcpy(&req->u.select.errorfds, &op->errorfds, sizeof(fd_set));
+        }
+        for (i = 0; i < op->wait_cnt; i++) {
+            list_remove(&op->waits[i].link_fd);
+            reactor_update_fd(op->waits[i].fd);
+        }
+        list_remove(&op->link_all);
+        loc_free(op->waits);
+        loc_free(op);
+        worker_thread_post(req);
+    }
+}
+
+static void reactor_start(ReactorOp * op) {
+    AsyncReqInfo * req = op->req;
+
+    if (req->type == AsyncReqSelect) {
+        memcpy(&op->readfds, &req->u.select.readfds, sizeof(fd_set));
+        memcpy(&op->writefds, &req->u.select.writefds, sizeof(fd_set));
+        memcpy(&op->errorfds, &req->u.select.errorfds, sizeof(fd_set));
+        op->deadline = reactor_time() + (uint64_t)req->u.select.timeout.tv_sec * 1000 +
+            req->u.select.timeout.tv_nsec / 1000000;
+    }
+    if (reactor_try(op)) reactor_done(op);
+    else reactor_wait(op);
+}
+
+static void reactor_fd_ready(int fd, uint32_t events) {
+    ReactorFd * f = (unsigned)fd < reactor_fds_max ? reactor_fds[fd] : NULL;
+    LINK * l;
+
+    if (f == NULL) return;
+    l = f->waits.next;
+    while (l != &f->waits) {
+        ReactorWait * w = link_fd2wait(l);
+        l = l->next;
+        if ((w->events & events) == 0 && (events & (EPOLLERR | EPOLLHUP)) == 0) continue;
+        if (reactor_try(w->op)) reactor_done(w->op);
+    }
+}
+
+static int reactor_timeout(void) {
+    uint64_t deadline = 0;
+    uint64_t time_now = 0;
+    LINK * l;
+
+    for (l = reactor_ops.next; l != &reactor_ops; l = l->next) {
+        ReactorOp * op = link_all2op(l);
+        if (op->req->type != AsyncReqSelect) continue;
+        if (deadline == 0 || op->deadline < deadline) deadline = op->deadline;
+    }
+    if (deadline == 0) return -1;
+    time_now = reactor_time();
+    if (deadline <= time_now) return 0;
+    return (int)(deadline - time_now);
+}
+
+static void reactor_check_timeouts(void) {
+    uint64_t time_now = reactor_time();
+    LINK * l = reactor_ops.next;
+
+    while (l != &reactor_ops) {
+        ReactorOp * op = link_all2op(l);
+        l = l->next;
+        if (op->req->type != AsyncReqSelect || op->deadline > time_now) continue;
+        if (reactor_try(op)) reactor_done(op);
+    }
+}
+
+#if ENABLE_AsyncReqUring
+/*
+ * File requests are submitted to io_uring. Submissions are batched:
+ * async_req_post() only fills submission queue entries, and the reactor
+ * thread passes all of them to the kernel at once. Completions are reported
+ * by the ring eventfd and are reaped by the reactor thread as well.
+ */
+
+#define URING_ENTRIES 256
+
+typedef struct UringReq {
+    AsyncReqInfo * req;
+    struct statx stx;
+} UringReq;
+
+static int uring_fd = -1;
+static int uring_event = -1;
+static int uring_created = 0;
+static int uring_closed = 1;
+static int uring_cur_pos = 0;
+static pthread_mutex_t uring_lock;
+static unsigned uring_pending = 0;      /* Entries not yet passed to the kernel */
+static unsigned uring_inflight = 0;     /* Requests not yet completed */
+static uint8_t uring_ops[IORING_OP_LAST];
+
+static unsigned * sq_head;
+static unsigned * sq_tail;
+static unsigned * sq_mask;
+static unsigned * sq_array;
+static unsigned sq_entries;
+static struct io_uring_sqe * sqes;
+static unsigned * cq_head;
+static unsigned * cq_tail;
+static unsigned * cq_mask;
+static unsigned cq_entries;
+static struct io_uring_cqe * cqes;
+
+static int get_uring_op(AsyncReqInfo * req) {
+    switch (req->type) {
+    case AsyncReqRead: return uring_cur_pos ? IORING_OP_READ : -1;
+    case AsyncReqWrite: return uring_cur_pos ? IORING_OP_WRITE : -1;
+    case AsyncReqSeekRead: return IORING_OP_READ;
+    case AsyncReqSeekWrite: return IORING_OP_WRITE;
+    case AsyncReqOpen: return IORING_OP_OPENAT;
+    case AsyncReqClose: return IORING_OP_CLOSE;
+    case AsyncReqStat:
+    case AsyncReqLstat:
+    case AsyncReqFstat:
+        return IORING_OP_STATX;
+    }
+    return -1;
+}
+
+static void statx_to_stat(struct statx * x, struct stat * st) {
+    memset(st, 0, sizeof(struct stat));
+    st->st_dev = makedev(x->stx_dev_major, x->stx_dev_minor);
+    st->st_ino = x->stx_ino;
+    st->st_mode = x->stx_mode;
+    st->st_nlink = x->stx_nlink;
+    st->st_uid = x->stx_uid;
+    st->st_gid = x->stx_gid;
+    st->st_rdev = makedev(x->stx_rdev_major, x->stx_rdev_minor);
+    st->st_size = x->stx_size;
+    st->st_blksize = x->stx_blksize;
+    st->st_blocks = x->stx_blocks;
+    st->st_atim.tv_sec = x->stx_atime.tv_sec;
+    st->st_atim.tv_nsec = x->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec = x->stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec = x->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec = x->stx_ctime.tv_sec;
+    st->st_ctim.tv_nsec = x->stx_ctime.tv_nsec;
+}
+
+/* Must be called with uring_lock */
+static void uring_enter(void) {
+    while (uring_pending > 0) {
+        int n = (int)syscall(__NR_io_uring_enter, uring_fd, uring_pending, 0, 0, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            /* EAGAIN or EBUSY: the kernel is short of resources, retry on next post or completion */
+            if (errno == EAGAIN || errno == EBUSY) break;
+            check_error(errno);
+        }
+        uring_pending -= n;
+    }
+}
+
+static void uring_create(void);
+
+static int uring_post(AsyncReqInfo * req) {
+    struct io_uring_sqe * sqe = NULL;
+    UringReq * ureq = NULL;
+    unsigned tail = 0;
+    int op = 0;
+
+    if (!uring_created) {
+        if (!is_dispatch_thread()) return 0;
+        uring_create();
+    }
+    op = get_uring_op(req);
+    if (op < 0 || !uring_ops[op]) return 0;
+    check_error(pthread_mutex_lock(&uring_lock));
+    if (uring_closed || uring_inflight >= cq_entries ||
+            (tail = *sq_tail) - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        check_error(pthread_mutex_unlock(&uring_lock));
+        return 0;
+    }
+    ureq = (UringReq *)loc_alloc_zero(sizeof(UringReq));
+    ureq->req = req;
+    sqe = sqes + (tail & *sq_mask);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = (uint8_t)op;
+    sqe->user_data = (uintptr_t)ureq;
+    switch (req->type) {
+    case AsyncReqRead:
+    case AsyncReqWrite:
+        sqe->fd = req->u.fio.fd;
+        sqe->addr = (uintptr_t)req->u.fio.bufp;
+        sqe->len = (unsigned)req->u.fio.bufsz;
+        sqe->off = (uint64_t)-1;        /* Use and update the file position */
+        break;
+    case AsyncReqSeekRead:
+    case AsyncReqSeekWrite:
+        sqe->fd = req->u.fio.fd;
+        sqe->addr = (uintptr_t)req->u.fio.bufp;
+        sqe->len = (unsigned)req->u.fio.bufsz;
+        sqe->off = (uint64_t)req->u.fio.offset;
+        break;
+    case AsyncReqOpen:
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)req->u.fio.file_name;
+        sqe->len = req->u.fio.permission;
+        sqe->open_flags = req->u.fio.flags;
+        break;
+    case AsyncReqClose:
+        sqe->fd = req->u.fio.fd;
+        break;
+    case AsyncReqStat:
+    case AsyncReqLstat:
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)req->u.fio.file_name;
+        sqe->len = STATX_BASIC_STATS;
+        sqe->off = (uintptr_t)&ureq->stx;
+        sqe->statx_flags = req->type == AsyncReqLstat ? AT_SYMLINK_NOFOLLOW : 0;
+        break;
+    case AsyncReqFstat:
+        sqe->fd = req->u.fio.fd;
+        sqe->addr = (uintptr_t)"";
+        sqe->len = STATX_BASIC_STATS;
+        sqe->off = (uintptr_t)&ureq->stx;
+        sqe->statx_flags = AT_EMPTY_PATH;
+        break;
+    }
+    sq_array[tail & *sq_mask] = tail & *sq_mask;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    uring_inflight++;
+    if (uring_pending++ == 0) {
+        /* Let the reactor thread submit the batch */
+        uint64_t cnt = 1;
+        if (write(reactor_wakeup, &cnt, sizeof(cnt)) < 0) uring_enter();
+    }
+    check_error(pthread_mutex_unlock(&uring_lock));
+    return 1;
+}
+
+static void uring_submit(void) {
+    check_error(pthread_mutex_lock(&uring_lock));
+    uring_enter();
+    check_error(pthread_mutex_unlock(&uring_lock));
+}
+
+static void uring_reap(void) {
+    unsigned head = *cq_head;
+    unsigned cnt = 0;
+    uint64_t val = 0;
+
+    if (read(uring_event, &val, sizeof(val)) < 0) assert(errno == EAGAIN);
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe * cqe = cqes + (head & *cq_mask);
+        UringReq * ureq = (UringReq *)(uintptr_t)cqe->user_data;
+        AsyncReqInfo * req = ureq->req;
+        int res = cqe->res;
+
+        head++;
+        cnt++;
+        req->error = res < 0 ? -res : 0;
+        switch (req->type) {
+        case AsyncReqStat:
+        case AsyncReqLstat:
+        case AsyncReqFstat:
+            if (res < 0) memset(&req->u.fio.statbuf, 0, sizeof(req->u.fio.statbuf));
+            else statx_to_stat(&ureq->stx, &req->u.fio.statbuf);
+            req->u.fio.rval = res < 0 ? -1 : 0;
+            break;
+        default:
+            req->u.fio.rval = res < 0 ? -1 : res;
+            break;
+        }
+        loc_free(ureq);
+        trace(LOG_ASYNCREQ, "async_req_complete: req %p, type %d, error %d", req, req->type, req->error);
+        post_event(req->done, req);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    check_error(pthread_mutex_lock(&uring_lock));
+    uring_inflight -= cnt;
+    uring_enter();
+    check_error(pthread_mutex_unlock(&uring_lock));
+}
+
+/* Stop accepting new requests if nothing is in flight, called by the reactor thread when exiting */
+static int uring_close(void) {
+    int ok = 0;
+    check_error(pthread_mutex_lock(&uring_lock));
+    if (uring_inflight == 0) uring_closed = ok = 1;
+    check_error(pthread_mutex_unlock(&uring_lock));
+    return ok;
+}
+
+/* Called on first use: descriptors created before the agent becomes a daemon would be closed */
+static void uring_create(void) {
+    struct io_uring_params params;
+    struct io_uring_probe * probe = NULL;
+    struct epoll_event event;
+    size_t sq_size = 0, cq_size = 0;
+    size_t sqes_size = 0;
+    char * sq_ptr = NULL;
+    char * cq_ptr = NULL;
+    int i;
+
+    assert(is_dispatch_thread());
+    uring_created = 1;
+    /* Completions are reaped by the reactor thread */
+    if (!reactor_created) reactor_create();
+    if (reactor_stopped) return;
+    memset(&params, 0, sizeof(params));
+    uring_fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (uring_fd < 0) {
+        trace(LOG_ASYNCREQ, "io_uring is not available: %s", errno_to_str(errno));
+        return;
+    }
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) sq_size = cq_size;
+        cq_size = sq_size;
+    }
+    sq_ptr = (char *)mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        sq_ptr = NULL;
+        goto error;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    }
+    else {
+        cq_ptr = (char *)mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            cq_ptr = NULL;
+            goto error;
+        }
+    }
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe *)mmap(NULL, sqes_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        sqes = NULL;
+        goto error;
+    }
+    sq_head = (unsigned *)(sq_ptr + params.sq_off.head);
+    sq_tail = (unsigned *)(sq_ptr + params.sq_off.tail);
+    sq_mask = (unsigned *)(sq_ptr + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq_ptr + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    cq_head = (unsigned *)(cq_ptr + params.cq_off.head);
+    cq_tail = (unsigned *)(cq_ptr + params.cq_off.tail);
+    cq_mask = (unsigned *)(cq_ptr + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq_ptr + params.cq_off.cqes);
+    cq_entries = params.cq_entries;
+
+    /* Use only operations supported by the kernel */
+    probe = (struct io_uring_probe *)loc_alloc_zero(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+    if (syscall(__NR_io_uring_register, uring_fd, IORING_REGISTER_PROBE, probe, 256) < 0) goto error;
+    for (i = 0; i < IORING_OP_LAST && i <= probe->last_op; i++) {
+        uring_ops[i] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+    loc_free(probe);
+    probe = NULL;
+    /* Without current file position only the seek variants of read and write can be used */
+    uring_cur_pos = (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+
+    uring_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (uring_event < 0) goto error;
+    if (syscall(__NR_io_uring_register, uring_fd, IORING_REGISTER_EVENTFD, &uring_event, 1) < 0) goto error;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = uring_event;
+    if (epoll_ctl(reactor_epoll, EPOLL_CTL_ADD, uring_event, &event) < 0) goto error;
+    uring_closed = 0;
+    trace(LOG_ASYNCREQ, "io_uring: %u entries", sq_entries);
+    return;
+
+error:
+    /* File requests are done by worker threads */
+    trace(LOG_ALWAYS, "Can't initialize io_uring: %s", errno_to_str(errno));
+    memset(uring_ops, 0, sizeof(uring_ops));
+    loc_free(probe);
+    if (sqes != NULL) munmap(sqes, sqes_size);
+    if (cq_ptr != NULL && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+    if (sq_ptr != NULL) munmap(sq_ptr, sq_size);
+    if (uring_event >= 0) close(uring_event);
+    close(uring_fd);
+    sqes = NULL;
+    uring_event = -1;
+    uring_fd = -1;
+}
+#endif /* ENABLE_AsyncReqUring */
+
+static void reactor_exit(void * x) {
+    pthread_join(reactor_thread, NULL);
+#if ENABLE_AsyncReqUring
+    if (uring_fd >= 0) {
+        close(uring_event);
+        close(uring_fd);
+        uring_event = -1;
+        uring_fd = -1;
+    }
+#endif
+    close(reactor_wakeup);
+    close(reactor_epoll);
+    reactor_wakeup = -1;
+    reactor_epoll = -1;
+    trace(LOG_ASYNCREQ, "reactor_exit");
+    shutdown_set_stopped(&reactor_shutdown);
+}
+
+static void * reactor_handler(void * x) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    for (;;) {
+        LINK queue;
+        int i, n;
+
+        n = epoll_wait(reactor_epoll, events, REACTOR_MAX_EVENTS, reactor_timeout());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            check_error(errno);
+        }
+        for (i = 0; i < n; i++) {
+            if (events[i].data.fd == reactor_wakeup) {
+                uint64_t cnt = 0;
+                if (read(reactor_wakeup, &cnt, sizeof(cnt)) < 0) assert(errno == EAGAIN);
+#if ENABLE_AsyncReqUring
+                uring_submit();
+#endif
+                continue;
+            }
+#if ENABLE_AsyncReqUring
+            if (events[i].data.fd == uring_event) {
+                uring_reap();
+                continue;
+            }
+#endif
+            reactor_fd_ready(events[i].data.fd, events[i].events);
+        }
+        reactor_check_timeouts();
+
+        list_init(&queue);
+        check_error(pthread_mutex_lock(&reactor_lock));
+        list_concat(&queue, &reactor_queue);
+        list_init(&reactor_queue);
+        if (reactor_exiting && list_is_empty(&queue) && list_is_empty(&reactor_ops)) {
+#if ENABLE_AsyncReqUring
+            if (uring_close()) reactor_stopped = 1;
+#else
+            reactor_stopped = 1;
+#endif
+        }
+        check_error(pthread_mutex_unlock(&reactor_lock));
+        if (reactor_stopped) break;
+        while (!list_is_empty(&queue)) {
+            ReactorOp * op = link_all2op(queue.next);
+            list_remove(&op->link_all);
+            reactor_start(op);
+        }
+    }
+    post_event(reactor_exit, NULL);
+    return NULL;
+}
+
+static int reactor_post(AsyncReqInfo * req) {
+    ReactorOp * op = NULL;
+    int ok = 0;
+
+    if (!is_reactor_req(req)) return 0;
+    if (!reactor_created) {
+        if (!is_dispatch_thread()) return 0;
+        reactor_create();
+    }
+    op = (ReactorOp *)loc_alloc_zero(sizeof(ReactorOp));
+    op->req = req;
+    op->fd_flags = -1;
+    check_error(pthread_mutex_lock(&reactor_lock));
+    if (!reactor_stopped) {
+        if (list_is_empty(&reactor_queue)) {
+            uint64_t cnt = 1;
+            if (write(reactor_wakeup, &cnt, sizeof(cnt)) < 0) check_error(errno);
+        }
+        list_add_last(&op->link_all, &reactor_queue);
+        ok = 1;
+    }
+    check_error(pthread_mutex_unlock(&reactor_lock));
+    if (!ok) loc_free(op);
+    return ok;
+}
+
+/* Called on first use: descriptors created before the agent becomes a daemon would be closed */
+static void reactor_create(void) {
+    struct epoll_event event;
+
+    assert(is_dispatch_thread());
+    reactor_created = 1;
+    reactor_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor_epoll < 0) {
+        trace(LOG_ALWAYS, "Can't create epoll instance: %s", errno_to_str(errno));
+        return;
+    }
+    reactor_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor_wakeup < 0) {
+        trace(LOG_ALWAYS, "Can't create eventfd: %s", errno_to_str(errno));
+        close(reactor_epoll);
+        reactor_epoll = -1;
+        return;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = reactor_wakeup;
+    check_error(epoll_ctl(reactor_epoll, EPOLL_CTL_ADD, reactor_wakeup, &event) < 0 ? errno : 0);
+    reactor_stopped = 0;
+    check_error(pthread_create(&reactor_thread, &pthread_create_attr, reactor_handler, NULL));
+    shutdown_set_normal(&reactor_shutdown);
+}
+
+static void ini_reactor(void) {
+    check_error(pthread_mutex_init(&reactor_lock, NULL));
+#if ENABLE_AsyncReqUring
+    check_error(pthread_mutex_init(&uring_lock, NULL));
+#endif
+}
+#endif /* ENABLE_AsyncReqEpoll */
+
 #if ENABLE_AIO
 static void aio_done(union sigval arg) {
     AsyncReqInfo * req = (AsyncReqInfo *)arg.sival_ptr;
@@ -567,8 +1667,6 @@ static void aio_done(union sigval arg) {
 #endif
 
 void async_req_post(AsyncReqInfo * req) {
-    WorkerThread * wt;
-
     trace(LOG_ASYNCREQ, "async_req_post: req %p, type %d", req, req->type);
     assert(req->done != NULL || req->type == AsyncReqTimer);
 
@@ -598,34 +1696,69 @@ void async_req_post(AsyncReqInfo * req) {
         }
     }
 #endif
+#if ENABLE_AsyncReqUring
+    if (uring_post(req)) return;
+#endif
+#if ENABLE_AsyncReqEpoll
+    if (reactor_post(req)) return;
+#endif
+    worker_thread_post(req);
+}
+
+void async_req_set_pool_limits(int min_threads, int max_threads, int idle_timeout) {
+    LINK * l;
+
     check_error(pthread_mutex_lock(&wtlock));
-    if (list_is_empty(&wtlist)) {
-        assert(wtlist_size == 0);
-        if (is_dispatch_thread()) {
-            worker_thread_add(req);
-        }
-        else {
-            post_event(worker_thread_add_deferred, req);
-        }
+    if (max_threads > 0) wtmax = max_threads;
+    if (min_threads >= 0) wtmin = min_threads;
+    if (wtmin > wtmax) wtmin = wtmax;
+    if (idle_timeout >= 0) wtidle_timeout = idle_timeout;
+    /* Let idle threads re-check the limits */
+    for (l = wtlist.next; l != &wtlist; l = l->next) {
+        check_error(pthread_cond_signal(&wtlink2wt(l)->cond));
     }
-    else {
-        wt = wtlink2wt(wtlist.next);
-        list_remove(&wt->wtlink);
-        wtlist_size--;
-        assert(wt->req == NULL);
-        wt->req = req;
-        check_error(pthread_cond_signal(&wt->cond));
+    /* Start threads for queued requests if the limit was raised */
+    while (wtqueue_size > 0 && wtpool_size() < wtmax) {
+        worker_thread_start(worker_queue_get(), 0);
     }
     check_error(pthread_mutex_unlock(&wtlock));
+    trace(LOG_ASYNCREQ, "worker pool limits: min %d, max %d, idle timeout %d", wtmin, wtmax, wtidle_timeout);
+}
+
+static void report_pool_stats(void * args) {
+    if (log_mode & LOG_ASYNCREQ) {
+        check_error(pthread_mutex_lock(&wtlock));
+        if (stat_queued_cnt > 0 || wtqueue_size > 0) {
+            trace(LOG_ASYNCREQ, "worker pool: threads %d, idle %d, queue size %d, max %d, "
+                "queued requests %u, wait time avg %u us, max %u us",
+                wtthread_count, wtlist_size, wtqueue_size, stat_queue_max, stat_queued_cnt,
+                stat_queued_cnt ? (unsigned)(stat_wait_total / stat_queued_cnt) : 0,
+                (unsigned)stat_wait_max);
+        }
+        stat_queue_max = wtqueue_size;
+        stat_queued_cnt = 0;
+        stat_wait_total = 0;
+        stat_wait_max = 0;
+        check_error(pthread_mutex_unlock(&wtlock));
+        post_event_with_delay(report_pool_stats, NULL, WORKER_POOL_STATS_INTERVAL * 1000000);
+    }
 }
 
 static void start_timer(void * args) {
     memset(&timer_req, 0, sizeof(timer_req));
     timer_req.type = AsyncReqTimer;
     async_req_post(&timer_req);
+    /* The statistics are only logged, don't wake up the dispatch thread if the log is off */
+    if (log_mode & LOG_ASYNCREQ) report_pool_stats(NULL);
 }
 
 void ini_asyncreq(void) {
+    int i;
+
     check_error(pthread_mutex_init(&wtlock, NULL));
+    for (i = 0; i < REQ_PRIORITY_CNT; i++) list_init(wtqueue + i);
+#if ENABLE_AsyncReqEpoll
+    ini_reactor();
+#endif
     post_event(start_timer, NULL);
 }
@@ -30,6 +30,9 @@
 #endif
 #include <time.h>
 #include <sys/stat.h>
+#if ENABLE_AsyncReqSendMsg
+#  include <sys/uio.h>
+#endif
 
 #include <tcf/framework/events.h>
 
@@ -59,7 +62,8 @@ enum {
     AsyncReqReadDir,                    /* Directory read */
     AsyncReqCloseDir,                   /* Directory close */
     AsyncReqRoots,                      /* Root device list */
-    AsyncReqUser                        /* User defined req */
+    AsyncReqUser,                       /* User defined req */
+    AsyncReqSendMsg                     /* Socket sendmsg, gather write of iov */
 };
 
 #define AsyncReqSetSize         1
@@ -135,6 +139,10 @@ struct AsyncReqInfo {
 #else
             socklen_t addrlen;
 #endif
+#if ENABLE_AsyncReqSendMsg
+            struct iovec * iov;
+            int iovcnt;
+#endif
 
             /* Out */
             ssize_t rval;
@@ -208,6 +216,14 @@ struct AsyncReqInfo {
 
 extern void async_req_post(AsyncReqInfo * req);
 
+/*
+ * Set worker thread pool limits, a negative value leaves a limit unchanged.
+ * min_threads - number of idle threads that are never stopped,
+ * max_threads - max number of worker threads, when all are busy, requests wait in a queue,
+ * idle_timeout - seconds before an idle thread above the minimum is stopped.
+ */
+extern void async_req_set_pool_limits(int min_threads, int max_threads, int idle_timeout);
+
 extern void ini_asyncreq(void);
 
 #endif /* D_asyncreq */
@@ -37,6 +37,7 @@
 #include <tcf/framework/channel_pipe.h>
 #include <tcf/framework/protocol.h>
 #include <tcf/framework/myalloc.h>
+#include <tcf/framework/outputbuf.h>
 #include <tcf/framework/events.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/trace.h>
@@ -54,6 +55,15 @@ typedef struct ChannelLock {
     unsigned timer;
 } ChannelLock;
 
+typedef struct ChannelOutWaiter {
+    LINK link;
+    Channel * channel;
+    ChannelOutReadyCallBack callback;
+    void * args;
+} ChannelOutWaiter;
+
+#define link2waiter(A)  ((ChannelOutWaiter *)((char *)(A) - offsetof(ChannelOutWaiter, link)))
+
 typedef struct ChannelTransport {
     char * transportname;
     ChannelServerCreate create;
@@ -88,6 +98,7 @@ static unsigned open_listeners_max = 0;
 static ChannelCloseListener * close_listeners = NULL;
 static unsigned close_listeners_cnt = 0;
 static unsigned close_listeners_max = 0;
+static LINK out_waiters = TCF_LIST_INIT(out_waiters);
 static size_t extension_size = 0;
 static int channel_created = 0;
 
@@ -224,9 +235,22 @@ void notify_channel_opened(Channel * c) {
     notify_client_connected(&c->client);
 }
 
+static void notify_out_waiters(Channel * c) {
+    LINK * l = out_waiters.next;
+    while (l != &out_waiters) {
+        ChannelOutWaiter * w = link2waiter(l);
+        l = l->next;
+        if (w->channel != c) continue;
+        list_remove(&w->link);
+        post_event(w->callback, w->args);
+        loc_free(w);
+    }
+}
+
 void notify_channel_closed(Channel * c) {
     unsigned i;
     assert(c->state != ChannelStateConnected);
+    notify_out_waiters(c);
     if (!c->notified_open) return;
     c->notified_open = 0;
     notify_client_disconnected(&c->client);
@@ -399,6 +423,40 @@ int is_channel_closed(Channel * c) {
     return c->is_closed(c);
 }
 
+void channel_set_out_queue_size(Channel * c, size_t size) {
+    if (!c->out_congested) {
+        if (size < OUTPUT_QUEUE_HIGH_WATERMARK) return;
+        trace(LOG_PROTOCOL, "Channel %#" PRIxPTR " output is congested, %lu bytes queued",
+            (uintptr_t)c, (unsigned long)size);
+        c->out_congested = 1;
+    }
+    else if (size <= OUTPUT_QUEUE_LOW_WATERMARK) {
+        trace(LOG_PROTOCOL, "Channel %#" PRIxPTR " output congestion cleared", (uintptr_t)c);
+        c->out_congested = 0;
+        if (c->check_pending != NULL) c->check_pending(c);
+        notify_out_waiters(c);
+    }
+}
+
+int is_channel_out_congested(Channel * c) {
+    return c->out_congested && c->state != ChannelStateDisconnected;
+}
+
+void channel_wait_out_ready(Channel * c, ChannelOutReadyCallBack callback, void * args) {
+    ChannelOutWaiter * w = NULL;
+
+    assert(is_dispatch_thread());
+    if (!is_channel_out_congested(c)) {
+        post_event(callback, args);
+        return;
+    }
+    w = (ChannelOutWaiter *)loc_alloc_zero(sizeof(ChannelOutWaiter));
+    w->channel = c;
+    w->callback = callback;
+    w->args = args;
+    list_add_last(&w->link, &out_waiters);
+}
+
 PeerServer * channel_peer_from_url(const char * url) {
     int i;
     const char * s;
@@ -564,6 +622,7 @@ Channel * channel_alloc(void) {
  * Release a buffer allocated using channel_alloc().
  */
 void channel_free(Channel * c) {
+    notify_out_waiters(c);
     loc_free(c);
 }
 
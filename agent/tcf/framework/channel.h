@@ -77,6 +77,7 @@ struct Channel {
     LINK susplink;                      /* Suspend list */
     LINK locks;                         /* List of channel locks */
     int congestion_level;               /* Congestion level */
+    int out_congested;                  /* Output queue is over the high watermark */
     int state;                          /* Current state */
     int disable_zero_copy;              /* Don't send ZeroCopy in Hello message even if we support it */
     int incoming;                       /* Created by an incoming connect */
@@ -264,6 +265,28 @@ extern void channel_unlock_with_msg(Channel *, const char *);
  */
 extern int is_channel_closed(Channel *);
 
+/*
+ * Output flow control.
+ * Channel implementation calls channel_set_out_queue_size() when size of queued output changes.
+ * When the size reaches OUTPUT_QUEUE_HIGH_WATERMARK, the channel stops handling incoming messages,
+ * handling is resumed when the size drops to OUTPUT_QUEUE_LOW_WATERMARK.
+ * Producers of large amounts of data should check is_channel_out_congested() and defer the work.
+ */
+extern void channel_set_out_queue_size(Channel *, size_t size);
+
+/*
+ * Return 1 if channel output is congested, otherwise return 0.
+ */
+extern int is_channel_out_congested(Channel *);
+
+/*
+ * Call 'callback' once, as an event, when channel output is not congested.
+ * The callback is called right away if the output is not congested now,
+ * otherwise when the queue drops to OUTPUT_QUEUE_LOW_WATERMARK or the channel is closed.
+ */
+typedef void (*ChannelOutReadyCallBack)(void * args);
+extern void channel_wait_out_ready(Channel *, ChannelOutReadyCallBack callback, void * args);
+
 /* Deprecated function names are kept for backward compatibility */
 #define stream_lock(channel) channel_lock(channel)
 #define stream_unlock(channel) channel_unlock(channel)
@@ -135,6 +135,7 @@ typedef struct ChannelWS {
     OutputBuffer * obuf;
     int out_errno;
     int out_flush_cnt;      /* Number of posted lazy flush events */
+    int out_flush_delayed;  /* Flush is delayed because remote peer is congested */
     int out_eom_cnt;        /* Number of end-of-message markers in the output buffer */
     OutputQueue out_queue;
     int is_ssl;
@@ -696,6 +697,7 @@ static void done_write_request(void * args) {
     c->outbuf.len = 0;
     pthread_mutex_unlock(&c->data->mutex);
     output_queue_done(&c->out_queue, error, size);
+    channel_set_out_queue_size(c->chan, c->out_queue.size);
     if (error) c->out_errno = error;
     if (output_queue_is_empty(&c->out_queue) &&
         c->chan->state == ChannelStateDisconnected) lws_shutdown(c);
@@ -748,6 +750,7 @@ static void lws_flush_with_flags(ChannelWS * c, int flags) {
         trace(LOG_PROTOCOL, "Outbuf add size:%d",c->obuf->buf_len);
 
         output_queue_add_obuf(&c->out_queue, c->obuf);
+        channel_set_out_queue_size(c->chan, c->out_queue.size);
         c->obuf = output_queue_alloc_obuf();
         c->chan->out.end = c->obuf->buf + sizeof(c->obuf->buf);
     }
@@ -760,7 +763,14 @@ static void lws_flush_event(void * x) {
     assert(c->magic == CHANNEL_MAGIC);
     if (--c->out_flush_cnt == 0) {
         int congestion_level = c->chan->congestion_level;
-        if (congestion_level > 0) usleep(congestion_level * 2500);
+        if (congestion_level > 0 && !c->out_flush_delayed && c->chan->state != ChannelStateDisconnected) {
+            /* Remote peer is congested: delay the flush instead of blocking the dispatch thread */
+            c->out_flush_delayed = 1;
+            c->out_flush_cnt++;
+            post_event_with_delay(lws_flush_event, c, congestion_level * 2500);
+            return;
+        }
+        c->out_flush_delayed = 0;
         lws_flush_with_flags(c, 0);
         lws_unlock(c->chan);
     }
@@ -1014,7 +1024,7 @@ static void channel_check_pending(Channel * channel) {
     ChannelWS * c = channel2ws(channel);
 
     assert(is_dispatch_thread());
-    if (c->ibuf.handling_msg == HandleMsgIdle && c->ibuf.message_count) {
+    if (c->ibuf.handling_msg == HandleMsgIdle && c->ibuf.message_count && !is_channel_out_congested(channel)) {
         post_event(handle_channel_msg, c);
         c->ibuf.handling_msg = HandleMsgTriggered;
     }
@@ -1025,7 +1035,7 @@ static void lws_trigger_message(InputBuf * ibuf) {
 
     assert(is_dispatch_thread());
     assert(c->ibuf.message_count > 0);
-    if (c->ibuf.handling_msg == HandleMsgIdle) {
+    if (c->ibuf.handling_msg == HandleMsgIdle && !is_channel_out_congested(c->chan)) {
         post_event(handle_channel_msg, c);
         c->ibuf.handling_msg = HandleMsgTriggered;
     }
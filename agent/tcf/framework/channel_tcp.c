@@ -88,6 +88,11 @@
 #  endif
 #endif
 
+#if !defined(TCP_SEND_IOV_MAX)
+/* Max number of output buffers written with one sendmsg() call */
+#  define TCP_SEND_IOV_MAX 64
+#endif
+
 typedef struct ChannelTCP ChannelTCP;
 
 struct ChannelTCP {
@@ -116,10 +121,16 @@ struct ChannelTCP {
     OutputBuffer * obuf;
     int out_errno;
     int out_flush_cnt;      /* Number of posted lazy flush events */
+    int out_flush_delayed;  /* Flush is delayed because remote peer is congested */
     int out_eom_cnt;        /* Number of end-of-message markers in the output buffer */
 #if ENABLE_OutputQueue
     OutputQueue out_queue;
     AsyncReqInfo wr_req;
+#if ENABLE_AsyncReqSendMsg
+    struct iovec wr_iov[TCP_SEND_IOV_MAX];
+#endif
+    unsigned out_send_cnt;  /* Statistics: number of completed socket writes */
+    uint64_t out_send_size; /* Statistics: number of bytes written */
 #endif /* ENABLE_OutputQueue */
 
     /* Async read request */
@@ -148,6 +159,7 @@ static size_t channel_tcp_extension_offset = 0;
 #define servlink2tcp(A) ((ServerTCP *)((char *)(A) - offsetof(ServerTCP, servlink)))
 #define ibuf2tcp(A)     ((ChannelTCP *)((char *)(A) - offsetof(ChannelTCP, ibuf)))
 #define obuf2tcp(A)     ((ChannelTCP *)((char *)(A) - offsetof(ChannelTCP, out_queue)))
+#define link2obuf(A)    ((OutputBuffer *)((char *)(A) - offsetof(OutputBuffer, link)))
 
 static LINK server_list;
 static void tcp_channel_read_done(void * x);
@@ -301,6 +313,10 @@ static void delete_channel(ChannelTCP * c) {
         shutdown_set_stopped(&channel_shutdown);
     c->magic = 0;
 #if ENABLE_OutputQueue
+    if (c->out_send_cnt > 0) {
+        trace(LOG_PROTOCOL, "Channel %#" PRIxPTR " output: %u writes, %" PRIu64 " bytes, %u bytes per write",
+            (uintptr_t)c, c->out_send_cnt, c->out_send_size, (unsigned)(c->out_send_size / c->out_send_cnt));
+    }
     output_queue_clear(&c->out_queue);
 #endif /* ENABLE_OutputQueue */
 #if ENABLE_SSL
@@ -355,8 +371,13 @@ static void done_write_request(void * args) {
     assert(c->socket >= 0);
 
     if (c->wr_req.u.sio.rval < 0) error = c->wr_req.error;
-    else if (c->wr_req.type == AsyncReqSend) size = c->wr_req.u.sio.rval;
+    else if (c->wr_req.type == AsyncReqSend || c->wr_req.type == AsyncReqSendMsg) size = c->wr_req.u.sio.rval;
+    if (size > 0) {
+        c->out_send_cnt++;
+        c->out_send_size += size;
+    }
     output_queue_done(&c->out_queue, error, size);
+    channel_set_out_queue_size(c->chan, c->out_queue.size);
     if (error) c->out_errno = error;
     if (output_queue_is_empty(&c->out_queue) &&
         c->chan->state == ChannelStateDisconnected) shutdown(c->socket, SHUT_WR);
@@ -404,6 +425,27 @@ static void post_write_request(OutputBuffer * bf) {
         }
     }
     else
+#endif
+#if ENABLE_AsyncReqSendMsg
+    if (bf->link.next != &c->out_queue.queue) {
+        /* Several buffers are pending, write all of them with one system call */
+        LINK * l = &bf->link;
+        int n = 0;
+        while (l != &c->out_queue.queue && n < TCP_SEND_IOV_MAX) {
+            OutputBuffer * b = link2obuf(l);
+            c->wr_iov[n].iov_base = b->buf + b->buf_pos;
+            c->wr_iov[n].iov_len = b->buf_len - b->buf_pos;
+            l = l->next;
+            n++;
+        }
+        c->wr_req.type = AsyncReqSendMsg;
+        c->wr_req.u.sio.sock = c->socket;
+        c->wr_req.u.sio.iov = c->wr_iov;
+        c->wr_req.u.sio.iovcnt = n;
+        c->wr_req.u.sio.flags = l == &c->out_queue.queue ? 0 : MSG_MORE;
+        async_req_post(&c->wr_req);
+    }
+    else
 #endif
     {
         c->wr_req.type = AsyncReqSend;
@@ -431,6 +473,7 @@ static void tcp_flush_with_flags(ChannelTCP * c, int flags) {
         c->obuf->buf_len = c->chan->out.cur - p;
         c->out_queue.post_io_request = post_write_request;
         output_queue_add_obuf(&c->out_queue, c->obuf);
+        channel_set_out_queue_size(c->chan, c->out_queue.size);
         c->obuf = output_queue_alloc_obuf();
         c->chan->out.end = c->obuf->buf + sizeof(c->obuf->buf);
 #else
@@ -460,7 +503,14 @@ static void tcp_flush_event(void * x) {
     assert(c->magic == CHANNEL_MAGIC);
     if (--c->out_flush_cnt == 0) {
         int congestion_level = c->chan->congestion_level;
-        if (congestion_level > 0) usleep(congestion_level * 2500);
+        if (congestion_level > 0 && !c->out_flush_delayed && c->chan->state != ChannelStateDisconnected) {
+            /* Remote peer is congested: delay the flush instead of blocking the dispatch thread */
+            c->out_flush_delayed = 1;
+            c->out_flush_cnt++;
+            post_event_with_delay(tcp_flush_event, c, congestion_level * 2500);
+            return;
+        }
+        c->out_flush_delayed = 0;
         tcp_flush_with_flags(c, 0);
         tcp_unlock(c->chan);
     }
@@ -575,7 +625,8 @@ static ssize_t tcp_splice_block_stream(OutputStream * out, int fd, size_t size,
 #if ENABLE_Splice
     {
         ChannelTCP * c = channel2tcp(out2channel(out));
-        if (!c->ssl && out->supports_zero_copy) {
+        /* After an output error the pipe can hold unsent data, and splice() into it would block */
+        if (!c->ssl && out->supports_zero_copy && c->out_errno == 0 && c->chan->state != ChannelStateDisconnected) {
             ssize_t rd = splice(fd, offset, c->pipefd[1], NULL, size, SPLICE_F_MOVE);
             if (rd > 0) {
                 /* Send the binary data escape seq */
@@ -779,7 +830,7 @@ static void channel_check_pending(Channel * channel) {
     ChannelTCP * c = channel2tcp(channel);
 
     assert(is_dispatch_thread());
-    if (c->ibuf.handling_msg == HandleMsgIdle && c->ibuf.message_count) {
+    if (c->ibuf.handling_msg == HandleMsgIdle && c->ibuf.message_count && !is_channel_out_congested(channel)) {
         post_event(handle_channel_msg, c);
         c->ibuf.handling_msg = HandleMsgTriggered;
     }
@@ -790,7 +841,7 @@ static void tcp_trigger_message(InputBuf * ibuf) {
 
     assert(is_dispatch_thread());
     assert(c->ibuf.message_count > 0);
-    if (c->ibuf.handling_msg == HandleMsgIdle) {
+    if (c->ibuf.handling_msg == HandleMsgIdle && !is_channel_out_congested(c->chan)) {
         post_event(handle_channel_msg, c);
         c->ibuf.handling_msg = HandleMsgTriggered;
     }
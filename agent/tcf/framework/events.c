@@ -52,6 +52,16 @@
 #  endif
 #endif
 
+/* Events posted by background threads without delay are passed to the dispatch thread
+ * through a lock-free multi-producer/single-consumer queue */
+#if !defined(ENABLE_LockFreeEventQueue)
+#  if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#    define ENABLE_LockFreeEventQueue 1
+#  else
+#    define ENABLE_LockFreeEventQueue 0
+#  endif
+#endif
+
 #if USE_CLOCK_MONOTONIC
 #  define EVENTS_CLOCK_TYPE CLOCK_MONOTONIC
 #else
@@ -65,8 +75,17 @@ struct event_node {
     struct timespec     runtime;
     EventCallBack *     handler;
     void *              arg;
+    /* Timer queue data */
+    uint64_t            seq;        /* Keeps FIFO order of events with same runtime */
+    unsigned            heap_pos;   /* Index in timer_heap */
+    event_node *        hash_next;  /* (handler, arg) hash chain, used by cancel_event() */
+    event_node *        hash_prev;
 };
 
+/* Timer queue is a binary min-heap ordered by (runtime, seq),
+ * plus a hash table of (handler, arg) for fast cancel_event() */
+#define TIMER_HEAP_INI_SIZE 0x100
+
 #if defined(_WIN32) || defined(__CYGWIN__)
    static DWORD event_thread;
 #  define current_thread GetCurrentThreadId()
@@ -122,12 +141,28 @@ static pthread_cond_t cancel_cond;
 
 static event_node * event_queue = NULL;
 static event_node * event_last = NULL;
-static event_node * timer_queue = NULL;
+static event_node ** timer_heap = NULL;
+static unsigned timer_heap_cnt = 0;
+static unsigned timer_heap_max = 0;
+static event_node ** timer_hash = NULL;
+static unsigned timer_hash_size = 0;
+static uint64_t timer_seq = 0;
 static EventCallBack * cancel_handler = NULL;
 static void * cancel_arg = NULL;
 static int process_events = 0;
 static event_node * exit_event = NULL;
 
+#if ENABLE_LockFreeEventQueue
+/* Intrusive MPSC queue, see D. Vyukov "Non-intrusive MPSC node-based queue".
+ * Producers only swap bg_head, the dispatch thread owns bg_tail.
+ * A sleeping dispatch thread is woken up by event_cond, not by an eventfd: it waits for
+ * timers with pthread_cond_timedwait(), and the same code is used on all platforms. */
+static event_node bg_stub;
+static event_node * bg_head = &bg_stub;
+static event_node * bg_tail = &bg_stub;
+static int dispatch_sleeping = 0;
+#endif
+
 uint32_t events_timer_ms = 0;
 
 static int time_cmp(const struct timespec * tv1, const struct timespec * tv2) {
@@ -150,12 +185,175 @@ static void time_add_usec(struct timespec * tv, unsigned long usec) {
     }
 }
 
+static int timer_before(event_node * x, event_node * y) {
+    int c = time_cmp(&x->runtime, &y->runtime);
+    if (c != 0) return c < 0;
+    return x->seq < y->seq;
+}
+
+static unsigned timer_hash_index(EventCallBack * handler, void * arg) {
+    uintptr_t h = ((uintptr_t)handler >> 2) ^ ((uintptr_t)arg >> 3) ^ ((uintptr_t)arg >> 13);
+    return (unsigned)(h % timer_hash_size);
+}
+
+static void timer_heap_set(unsigned pos, event_node * ev) {
+    timer_heap[pos] = ev;
+    ev->heap_pos = pos;
+}
+
+static void timer_sift_up(unsigned pos) {
+    event_node * ev = timer_heap[pos];
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if (!timer_before(ev, timer_heap[parent])) break;
+        timer_heap_set(pos, timer_heap[parent]);
+        pos = parent;
+    }
+    timer_heap_set(pos, ev);
+}
+
+static void timer_sift_down(unsigned pos) {
+    event_node * ev = timer_heap[pos];
+    for (;;) {
+        unsigned child = pos * 2 + 1;
+        if (child >= timer_heap_cnt) break;
+        if (child + 1 < timer_heap_cnt && timer_before(timer_heap[child + 1], timer_heap[child])) child++;
+        if (!timer_before(timer_heap[child], ev)) break;
+        timer_heap_set(pos, timer_heap[child]);
+        pos = child;
+    }
+    timer_heap_set(pos, ev);
+}
+
+/* Add event to the timer queue, must be called with event_lock held.
+ * The heap always has a spare slot, so exit_event_loop() does not need to allocate memory. */
+static void timer_insert(event_node * ev) {
+    event_node ** bucket = timer_hash + timer_hash_index(ev->handler, ev->arg);
+    assert(timer_heap_cnt < timer_heap_max);
+    ev->seq = timer_seq++;
+    ev->hash_prev = NULL;
+    ev->hash_next = *bucket;
+    if (*bucket != NULL) (*bucket)->hash_prev = ev;
+    *bucket = ev;
+    timer_heap[timer_heap_cnt] = ev;
+    timer_sift_up(timer_heap_cnt++);
+}
+
+static void timer_add(event_node * ev) {
+    if (timer_heap_cnt + 2 > timer_heap_max) {
+        unsigned i;
+        timer_heap_max *= 2;
+        timer_heap = (event_node **)loc_realloc(timer_heap, sizeof(event_node *) * timer_heap_max);
+        /* Keep hash chains short */
+        loc_free(timer_hash);
+        timer_hash_size = timer_heap_max;
+        timer_hash = (event_node **)loc_alloc_zero(sizeof(event_node *) * timer_hash_size);
+        for (i = 0; i < timer_heap_cnt; i++) {
+            event_node * x = timer_heap[i];
+            event_node ** bucket = timer_hash + timer_hash_index(x->handler, x->arg);
+            x->hash_prev = NULL;
+            x->hash_next = *bucket;
+            if (*bucket != NULL) (*bucket)->hash_prev = x;
+            *bucket = x;
+        }
+    }
+    timer_insert(ev);
+}
+
+static void timer_remove(event_node * ev) {
+    unsigned pos = ev->heap_pos;
+    assert(pos < timer_heap_cnt && timer_heap[pos] == ev);
+    if (ev->hash_prev != NULL) ev->hash_prev->hash_next = ev->hash_next;
+    else timer_hash[timer_hash_index(ev->handler, ev->arg)] = ev->hash_next;
+    if (ev->hash_next != NULL) ev->hash_next->hash_prev = ev->hash_prev;
+    if (pos != --timer_heap_cnt) {
+        timer_heap_set(pos, timer_heap[timer_heap_cnt]);
+        if (pos > 0 && timer_before(timer_heap[pos], timer_heap[(pos - 1) / 2])) timer_sift_up(pos);
+        else timer_sift_down(pos);
+    }
+}
+
+#if ENABLE_LockFreeEventQueue
+
+static void bg_queue_push(event_node * ev) {
+    event_node * prev;
+    ev->next = NULL;
+    prev = __atomic_exchange_n(&bg_head, ev, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev->next, ev, __ATOMIC_SEQ_CST);
+}
+
+/* Returns NULL if the queue is empty or a producer has not finished linking its node yet */
+static event_node * bg_queue_pop(void) {
+    event_node * tail = bg_tail;
+    event_node * next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (tail == &bg_stub) {
+        if (next == NULL) return NULL;
+        bg_tail = tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if (next == NULL) {
+        if (tail != __atomic_load_n(&bg_head, __ATOMIC_SEQ_CST)) return NULL;
+        bg_queue_push(&bg_stub);
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if (next == NULL) return NULL;
+    }
+    bg_tail = next;
+    return tail;
+}
+
+static int bg_queue_is_empty(void) {
+    return bg_tail == &bg_stub && __atomic_load_n(&bg_head, __ATOMIC_SEQ_CST) == &bg_stub;
+}
+
+/* Move events posted by background threads to the beginning of the event queue */
+static void drain_bg_queue(void) {
+    event_node * first = NULL;
+    event_node * last = NULL;
+    event_node * ev;
+    while ((ev = bg_queue_pop()) != NULL) {
+        if (last == NULL) first = ev;
+        else last->next = ev;
+        last = ev;
+    }
+    if (last != NULL) {
+        last->next = event_queue;
+        if (event_queue == NULL) {
+            assert(event_last == NULL);
+            event_last = last;
+        }
+        event_queue = first;
+    }
+}
+
+#endif /* ENABLE_LockFreeEventQueue */
+
 static void post_from_bg_thread(EventCallBack * handler, void * arg, unsigned long delay) {
     event_node * ev;
-    event_node * next;
-    event_node * prev;
     struct timespec runtime;
 
+#if ENABLE_LockFreeEventQueue
+    if (delay == 0) {
+        ev = (event_node *)loc_alloc(sizeof(event_node));
+        /* Non-zero runtime: like timer events, these are not counted by run_event_loop() */
+        if (clock_gettime(EVENTS_CLOCK_TYPE, &ev->runtime)) check_error(errno);
+        ev->handler = handler;
+        ev->arg = arg;
+        bg_queue_push(ev);
+        trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR,
+            (uintptr_t)ev, (uintptr_t)handler, (uintptr_t)arg);
+        /* The dispatch thread checks the queue after setting these flags, so it is enough
+         * to take the lock only when it might be waiting */
+        if (__atomic_load_n(&dispatch_sleeping, __ATOMIC_SEQ_CST) ||
+                __atomic_load_n(&cancel_handler, __ATOMIC_SEQ_CST) != NULL) {
+            check_error(pthread_mutex_lock(&event_lock));
+            check_error(pthread_cond_signal(&event_cond));
+            check_error(pthread_cond_signal(&cancel_cond));
+            check_error(pthread_mutex_unlock(&event_lock));
+        }
+        return;
+    }
+#endif
+
     if (clock_gettime(EVENTS_CLOCK_TYPE, &runtime)) check_error(errno);
     time_add_usec(&runtime, delay);
 
@@ -171,20 +369,8 @@ static void post_from_bg_thread(EventCallBack * handler, void * arg, unsigned lo
     ev->handler = handler;
     ev->arg = arg;
 
-    prev = NULL;
-    next = timer_queue;
-    while (next != NULL && time_cmp(&ev->runtime, &next->runtime) >= 0) {
-        prev = next;
-        next = next->next;
-    }
-    ev->next = next;
-    if (prev == NULL) {
-        timer_queue = ev;
-        check_error(pthread_cond_signal(&event_cond));
-    }
-    else {
-        prev->next = ev;
-    }
+    timer_add(ev);
+    if (ev->heap_pos == 0) check_error(pthread_cond_signal(&event_cond));
     trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR ", runtime %02u:%02u.%03u",
         (uintptr_t)ev, (uintptr_t)ev->handler, (uintptr_t)ev->arg,
         (unsigned)(ev->runtime.tv_sec / 60 % 60),
@@ -196,8 +382,6 @@ static void post_from_bg_thread(EventCallBack * handler, void * arg, unsigned lo
 void post_event_with_delay(EventCallBack * handler, void * arg, unsigned long delay) {
     if (is_event_thread && cancel_handler == NULL) {
         event_node * ev;
-        event_node * next;
-        event_node * prev;
         struct timespec runtime;
 
         if (clock_gettime(EVENTS_CLOCK_TYPE, &runtime)) check_error(errno);
@@ -209,20 +393,7 @@ void post_event_with_delay(EventCallBack * handler, void * arg, unsigned long de
         ev->arg = arg;
 
         check_error(pthread_mutex_lock(&event_lock));
-
-        prev = NULL;
-        next = timer_queue;
-        while (next != NULL && time_cmp(&ev->runtime, &next->runtime) >= 0) {
-            prev = next;
-            next = next->next;
-        }
-        ev->next = next;
-        if (prev == NULL) {
-            timer_queue = ev;
-        }
-        else {
-            prev->next = ev;
-        }
+        timer_add(ev);
         check_error(pthread_mutex_unlock(&event_lock));
 
         trace(LOG_EVENTCORE, "post_event: event %#" PRIxPTR ", handler %#" PRIxPTR ", arg %#" PRIxPTR ", runtime %02u%02u.%03u",
@@ -271,6 +442,9 @@ int cancel_event(EventCallBack * handler, void * arg, int wait) {
     assert(cancel_handler == NULL);
 
     trace(LOG_EVENTCORE, "cancel_event: handler %#" PRIxPTR ", arg %#" PRIxPTR ", wait %d", (uintptr_t)handler, (uintptr_t)arg, wait);
+#if ENABLE_LockFreeEventQueue
+    drain_bg_queue();
+#endif
     prev = NULL;
     ev = event_queue;
     while (ev != NULL) {
@@ -294,21 +468,17 @@ int cancel_event(EventCallBack * handler, void * arg, int wait) {
 
     check_error(pthread_mutex_lock(&event_lock));
     prev = NULL;
-    ev = timer_queue;
+    ev = timer_hash[timer_hash_index(handler, arg)];
     while (ev != NULL) {
-        if (ev->handler == handler && ev->arg == arg) {
-            if (prev == NULL) {
-                timer_queue = ev->next;
-            }
-            else {
-                prev->next = ev->next;
-            }
-            free_event_node(ev);
-            check_error(pthread_mutex_unlock(&event_lock));
-            return 1;
-        }
-        prev = ev;
-        ev = ev->next;
+        /* Cancel the earliest of matching timer events */
+        if (ev->handler == handler && ev->arg == arg && (prev == NULL || timer_before(ev, prev))) prev = ev;
+        ev = ev->hash_next;
+    }
+    if (prev != NULL) {
+        timer_remove(prev);
+        free_event_node(prev);
+        check_error(pthread_mutex_unlock(&event_lock));
+        return 1;
     }
 
     if (!wait) {
@@ -316,10 +486,33 @@ int cancel_event(EventCallBack * handler, void * arg, int wait) {
         return 0;
     }
 
-    cancel_handler = handler;
     cancel_arg = arg;
+#if ENABLE_LockFreeEventQueue
+    __atomic_store_n(&cancel_handler, handler, __ATOMIC_SEQ_CST);
+    for (;;) {
+        drain_bg_queue();
+        prev = NULL;
+        ev = event_queue;
+        while (ev != NULL && (ev->handler != handler || ev->arg != arg)) {
+            prev = ev;
+            ev = ev->next;
+        }
+        if (ev != NULL) {
+            if (ev->next == NULL) event_last = prev;
+            if (prev == NULL) event_queue = ev->next;
+            else prev->next = ev->next;
+            free_event_node(ev);
+            cancel_handler = NULL;
+            break;
+        }
+        if (cancel_handler == NULL) break;
+        check_error(pthread_cond_wait(&cancel_cond, &event_lock));
+    }
+#else
+    cancel_handler = handler;
     do check_error(pthread_cond_wait(&cancel_cond, &event_lock));
     while (cancel_handler != NULL);
+#endif
     check_error(pthread_mutex_unlock(&event_lock));
     return 1;
 }
@@ -343,6 +536,10 @@ void ini_events_queue(void) {
     check_error(pthread_cond_init(&event_cond, NULL));
 #endif
     check_error(pthread_cond_init(&cancel_cond, NULL));
+    timer_heap_max = TIMER_HEAP_INI_SIZE;
+    timer_heap = (event_node **)loc_alloc(sizeof(event_node *) * timer_heap_max);
+    timer_hash_size = timer_heap_max;
+    timer_hash = (event_node **)loc_alloc_zero(sizeof(event_node *) * timer_hash_size);
 #if ENABLE_FastMemAlloc
     {
         int i;
@@ -376,8 +573,7 @@ void exit_event_loop(void) {
     check_error(pthread_mutex_lock(&event_lock));
     if (exit_event != NULL) {
         exit_event->handler = exit_event_handler;
-        exit_event->next = timer_queue;
-        timer_queue = exit_event;
+        timer_insert(exit_event);
         exit_event = NULL;
         check_error(pthread_cond_signal(&event_cond));
     }
@@ -410,41 +606,51 @@ void run_event_loop(void) {
 #endif
             for (;;) {
                 last_tick_count_ms = events_timer_ms;
-                if ((ev = timer_queue) != NULL) {
+#if ENABLE_LockFreeEventQueue
+                drain_bg_queue();
+#endif
+                if (timer_heap_cnt > 0) {
                     struct timespec timenow;
+                    event_node * evfirst = NULL;
                     event_node * evlast = NULL;
                     if (clock_gettime(EVENTS_CLOCK_TYPE, &timenow)) check_error(errno);
-                    while (ev != NULL && time_cmp(&ev->runtime, &timenow) <= 0) {
+                    while (timer_heap_cnt > 0 && time_cmp(&timer_heap[0]->runtime, &timenow) <= 0) {
+                        ev = timer_heap[0];
+                        timer_remove(ev);
+                        if (evlast == NULL) evfirst = ev;
+                        else evlast->next = ev;
                         evlast = ev;
-                        ev = ev->next;
                     }
                     if (evlast != NULL) {
                         /* Move timed events that are ready to the
                          * beginning of the untimed event queue. */
-                        ev = timer_queue;
-                        timer_queue = evlast->next;
                         evlast->next = event_queue;
                         if (event_queue == NULL) {
                             assert(event_last == NULL);
                             event_last = evlast;
                         }
-                        event_queue = ev;
-                        break;
-                    }
-                    if (event_queue == NULL) {
-                        int error = pthread_cond_timedwait(&event_cond, &event_lock, &timer_queue->runtime);
-                        if (error && error != ETIMEDOUT) check_error(error);
-                    }
-                    else {
+                        event_queue = evfirst;
                         break;
                     }
                 }
-                else if (event_queue == NULL) {
-                    check_error(pthread_cond_wait(&event_cond, &event_lock));
+                if (event_queue != NULL) break;
+#if ENABLE_LockFreeEventQueue
+                __atomic_store_n(&dispatch_sleeping, 1, __ATOMIC_SEQ_CST);
+                if (!bg_queue_is_empty()) {
+                    dispatch_sleeping = 0;
+                    continue;
+                }
+#endif
+                if (timer_heap_cnt > 0) {
+                    int error = pthread_cond_timedwait(&event_cond, &event_lock, &timer_heap[0]->runtime);
+                    if (error && error != ETIMEDOUT) check_error(error);
                 }
                 else {
-                    break;
+                    check_error(pthread_cond_wait(&event_cond, &event_lock));
                 }
+#if ENABLE_LockFreeEventQueue
+                dispatch_sleeping = 0;
+#endif
             }
             check_error(pthread_mutex_unlock(&event_lock));
         }
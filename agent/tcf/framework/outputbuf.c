@@ -34,6 +34,7 @@ static int pool_size = 0;
 
 void output_queue_ini(OutputQueue * q) {
     list_init(&q->queue);
+    q->size = 0;
 }
 
 OutputBuffer * output_queue_alloc_obuf(void) {
@@ -64,6 +65,7 @@ void output_queue_free_obuf(OutputBuffer * bf) {
 }
 
 void output_queue_add_obuf(OutputQueue * q, OutputBuffer * bf) {
+    q->size += bf->buf_len;
     if (q->queue.next != q->queue.prev) {
         /* Append data to the last pending buffer */
         OutputBuffer * bp = link2buf(q->queue.prev);
@@ -86,6 +88,7 @@ void output_queue_add_obuf(OutputQueue * q, OutputBuffer * bf) {
 
 void output_queue_add(OutputQueue * q, const void * buf, size_t size) {
     if (q->error) return;
+    q->size += size;
     if (q->queue.next != q->queue.prev) {
         /* Append data to the last pending buffer */
         OutputBuffer * bf = link2buf(q->queue.prev);
@@ -127,13 +130,20 @@ void output_queue_done(OutputQueue * q, int error, int size) {
         output_queue_clear(q);
     }
     else {
-        bf->buf_pos += size;
-        if (bf->buf_pos < bf->buf_len) {
-            /* Nothing */
-        }
-        else {
+        assert(q->size >= (size_t)size);
+        q->size -= size;
+        /* A gather write can complete several buffers at once */
+        for (;;) {
+            size_t len = bf->buf_len - bf->buf_pos;
+            if (len > (size_t)size) len = size;
+            bf->buf_pos += len;
+            size -= (int)len;
+            if (bf->buf_pos < bf->buf_len) break;
             list_remove(&bf->link);
             output_queue_free_obuf(bf);
+            if (size == 0) break;
+            assert(!list_is_empty(&q->queue));
+            bf = link2buf(q->queue.next);
         }
     }
     if (!list_is_empty(&q->queue)) {
@@ -148,4 +158,5 @@ void output_queue_clear(OutputQueue * q) {
         list_remove(&bf->link);
         output_queue_free_obuf(bf);
     }
+    q->size = 0;
 }
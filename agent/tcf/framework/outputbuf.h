@@ -30,12 +30,17 @@
 #  define OUTPUT_QUEUE_BUF_SIZE (128 * MEM_USAGE_FACTOR)
 #endif
 
+/* Output flow control: a channel stops handling incoming messages when the amount of
+ * queued output reaches the high watermark, and resumes when it drops to the low watermark */
+#define OUTPUT_QUEUE_HIGH_WATERMARK (OUTPUT_QUEUE_BUF_SIZE * 256)
+#define OUTPUT_QUEUE_LOW_WATERMARK  (OUTPUT_QUEUE_BUF_SIZE * 64)
 
 typedef struct OutputQueue OutputQueue;
 typedef struct OutputBuffer OutputBuffer;
 
 struct OutputQueue {
     int error;
+    size_t size;    /* Number of bytes waiting to be written */
     LINK queue;
     void (*post_io_request)(OutputBuffer *);
 };
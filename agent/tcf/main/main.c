@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
+#include <string.h>
 #include <signal.h>
 #include <tcf/framework/mdep-threads.h>
 #include <tcf/framework/asyncreq.h>
@@ -34,6 +35,7 @@
 #include <tcf/framework/channel_tcp.h>
 #include <tcf/framework/plugins.h>
 #include <tcf/services/discovery.h>
+#include <tcf/services/dwarfdiskcache.h>
 #include <tcf/main/test.h>
 #include <tcf/main/cmdline.h>
 #include <tcf/main/services.h>
@@ -224,9 +226,14 @@ static const char * help_text[] = {
     "  -g<port>         start GDB Remote Serial Protocol server at the specified TCP port",
 #endif
     "  -I<idle-seconds> exit if there are no connections for the specified time",
+    "  -W<min>,<max>[,<idle-seconds>]",
+    "                   set worker thread pool size and idle thread timeout",
 #if ENABLE_Plugins
     "  -P<dir>          set agent plugins directory name",
 #endif
+#if ENABLE_DwarfDiskCache
+    "  -C<dir>[,<MB>]   enable on-disk cache of debug info indices, optionally set max cache size",
+#endif
 #if ENABLE_SSL
     "  -c               generate SSL certificate and exit",
 #endif
@@ -346,11 +353,15 @@ int main(int argc, char ** argv) {
 #endif
             case 'L':
             case 's':
+            case 'W':
 #if ENABLE_GdbRemoteSerialProtocol
             case 'g':
 #endif
 #if ENABLE_Plugins
             case 'P':
+#endif
+#if ENABLE_DwarfDiskCache
+            case 'C':
 #endif
                 if (*s == '\0') {
                     if (++ind >= argc) {
@@ -379,6 +390,22 @@ int main(int argc, char ** argv) {
                     url = s;
                     break;
 
+                case 'W':
+                    {
+                        char * p = s;
+                        int min_threads = (int)strtol(p, &p, 0);
+                        int max_threads = -1;
+                        int idle_timeout = -1;
+                        if (*p == ',') max_threads = (int)strtol(p + 1, &p, 0);
+                        if (*p == ',') idle_timeout = (int)strtol(p + 1, &p, 0);
+                        if (*p != '\0' || max_threads <= 0 || min_threads < 0) {
+                            fprintf(stderr, "%s: error: invalid worker pool size '%s'\n", progname, s);
+                            exit(1);
+                        }
+                        async_req_set_pool_limits(min_threads, max_threads, idle_timeout);
+                    }
+                    break;
+
 #if ENABLE_GdbRemoteSerialProtocol
                 case 'g':
                     if (ini_gdb_rsp(s) < 0) {
@@ -393,6 +420,26 @@ int main(int argc, char ** argv) {
                     plugins_path = s;
                     break;
 #endif
+
+#if ENABLE_DwarfDiskCache
+                case 'C':
+                    {
+                        char * p = strchr(s, ',');
+                        uint64_t max_size = 0;
+                        if (p != NULL) {
+                            char * e = NULL;
+                            long mb = strtol(p + 1, &e, 0);
+                            if (*e != '\0' || mb <= 0) {
+                                fprintf(stderr, "%s: error: invalid cache size '%s'\n", progname, p + 1);
+                                exit(1);
+                            }
+                            max_size = (uint64_t)mb * 1024 * 1024;
+                            *p = '\0';
+                        }
+                        set_dwarf_disk_cache(s, max_size);
+                    }
+                    break;
+#endif
                 }
                 s = NULL;
                 break;
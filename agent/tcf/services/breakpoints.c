@@ -54,6 +54,11 @@
 #  define ENABLE_SkipPrologueWhenPlanting 0
 #endif
 
+/* Software breakpoints in same page of target memory are planted with one memory read and one write */
+#if !defined(PLANTING_BATCH_SIZE)
+#  define PLANTING_BATCH_SIZE 0x1000
+#endif
+
 typedef struct BreakpointRef BreakpointRef;
 typedef struct InstructionRef InstructionRef;
 typedef struct BreakInstruction BreakInstruction;
@@ -85,6 +90,7 @@ struct BreakpointInfo {
     char * type;
     char * location;
     char * condition;
+    CompiledExpression * compiled_condition;
     char * context_query;
     char ** context_ids;
     char ** context_names;
@@ -189,6 +195,18 @@ struct EvaluationRequest {
     unsigned bp_max;
 };
 
+typedef struct PlantingBatch {
+    Context * ctx;
+    ContextAddress addr;
+    size_t size;
+    size_t mod_lo;          /* Range of modified bytes in 'buf' */
+    size_t mod_hi;
+    BreakInstruction ** bi_arr;   /* Instructions planted into 'buf' */
+    unsigned bi_cnt;
+    unsigned bi_max;
+    uint8_t buf[PLANTING_BATCH_SIZE];
+} PlantingBatch;
+
 struct ContextExtensionBP {
     int step_over_bp_cnt;
     BreakInstruction * stepping_over_bp;    /* if not NULL, the context is stepping over a breakpoint instruction */
@@ -197,6 +215,9 @@ struct ContextExtensionBP {
     int empty_bp_grp;
     int instruction_cnt;
     LINK link_hit_count;
+    BreakInstruction ** sw_code;    /* planted software breakpoint instructions, sorted by address */
+    unsigned sw_code_cnt;
+    unsigned sw_code_max;
 };
 
 static const char * BREAKPOINTS = "Breakpoints";
@@ -262,6 +283,10 @@ static uintptr_t generation_done = 0;
 static int planting_instruction = 0;
 static int cache_enter_cnt = 0;
 static int planted_sw_bp_cnt = 0;
+static int planted_sw_code_cnt = 0;
+static PlantingBatch planting_batch;
+static BreakInstruction ** planting_arr = NULL;
+static unsigned planting_max = 0;
 
 static int bp_location_error = 0;
 #if ENABLE_LineNumbers
@@ -343,6 +368,45 @@ static int select_sw_breakpoint_isa(BreakInstruction * sw, Context ** ctx, uint8
     return 0;
 }
 
+/* Return index of first planted software breakpoint in 'mem' with address >= 'addr' */
+static unsigned find_sw_code(Context * mem, ContextAddress addr) {
+    ContextExtensionBP * ext = EXT(mem);
+    unsigned l = 0;
+    unsigned h = ext->sw_code_cnt;
+    while (l < h) {
+        unsigned k = (l + h) / 2;
+        if (ext->sw_code[k]->cb.address < addr) l = k + 1;
+        else h = k;
+    }
+    return l;
+}
+
+static void add_sw_code(BreakInstruction * bi) {
+    ContextExtensionBP * ext = EXT(bi->cb.ctx);
+    unsigned i = find_sw_code(bi->cb.ctx, bi->cb.address);
+    assert(bi->planted);
+    assert(bi->saved_size > 0);
+    if (ext->sw_code_cnt >= ext->sw_code_max) {
+        ext->sw_code_max = ext->sw_code_max ? ext->sw_code_max * 2 : 16;
+        ext->sw_code = (BreakInstruction **)loc_realloc(ext->sw_code, sizeof(BreakInstruction *) * ext->sw_code_max);
+    }
+    memmove(ext->sw_code + i + 1, ext->sw_code + i, sizeof(BreakInstruction *) * (ext->sw_code_cnt - i));
+    ext->sw_code[i] = bi;
+    ext->sw_code_cnt++;
+    planted_sw_code_cnt++;
+}
+
+static void remove_sw_code(BreakInstruction * bi) {
+    ContextExtensionBP * ext = EXT(bi->cb.ctx);
+    unsigned i = find_sw_code(bi->cb.ctx, bi->cb.address);
+    assert(bi->saved_size > 0);
+    while (i < ext->sw_code_cnt && ext->sw_code[i] != bi) i++;
+    assert(i < ext->sw_code_cnt);
+    if (i >= ext->sw_code_cnt) return;
+    ext->sw_code_cnt--;
+    memmove(ext->sw_code + i, ext->sw_code + i + 1, sizeof(BreakInstruction *) * (ext->sw_code_cnt - i));
+    planted_sw_code_cnt--;
+}
 
 static void plant_instruction(BreakInstruction * bi) {
     int error = 0;
@@ -396,19 +460,36 @@ static void plant_instruction(BreakInstruction * bi) {
                 error = set_errno(ERR_OTHER, "The context does not support software breakpoints");
             }
             else {
+                PlantingBatch * b = &planting_batch;
                 bi->saved_size = bp_size;
                 assert(bi->saved_size > 0);
                 assert(sizeof(bi->saved_code) >= bi->saved_size);
                 assert(!bi->virtual_addr);
-                planting_instruction = 1;
                 memcpy(bi->planted_code, bp_encoding, bi->saved_size);
-                if (context_read_mem(bi->cb.ctx, bi->cb.address, bi->saved_code, bi->saved_size) < 0) {
-                    error = errno;
+                if (b->ctx == bi->cb.ctx && bi->cb.address >= b->addr &&
+                        bi->cb.address + bi->saved_size <= b->addr + b->size) {
+                    /* The code is written into target memory by flush_planting_batch() */
+                    size_t offs = (size_t)(bi->cb.address - b->addr);
+                    memcpy(bi->saved_code, b->buf + offs, bi->saved_size);
+                    memcpy(b->buf + offs, bi->planted_code, bi->saved_size);
+                    if (b->mod_lo >= b->mod_hi || offs < b->mod_lo) b->mod_lo = offs;
+                    if (offs + bi->saved_size > b->mod_hi) b->mod_hi = offs + bi->saved_size;
+                    if (b->bi_cnt >= b->bi_max) {
+                        b->bi_max = b->bi_max ? b->bi_max * 2 : 32;
+                        b->bi_arr = (BreakInstruction **)loc_realloc(b->bi_arr, sizeof(BreakInstruction *) * b->bi_max);
+                    }
+                    b->bi_arr[b->bi_cnt++] = bi;
                 }
-                else if (context_write_mem(bi->cb.ctx, bi->cb.address, bi->planted_code, bi->saved_size) < 0) {
-                    error = errno;
+                else {
+                    planting_instruction = 1;
+                    if (context_read_mem(bi->cb.ctx, bi->cb.address, bi->saved_code, bi->saved_size) < 0) {
+                        error = errno;
+                    }
+                    else if (context_write_mem(bi->cb.ctx, bi->cb.address, bi->planted_code, bi->saved_size) < 0) {
+                        error = errno;
+                    }
+                    planting_instruction = 0;
                 }
-                planting_instruction = 0;
             }
         }
     }
@@ -430,6 +511,84 @@ static void plant_instruction(BreakInstruction * bi) {
     }
     bi->planted = bi->planting_error == NULL;
     if (bi->planted && !bi->virtual_addr) planted_sw_bp_cnt++;
+    if (bi->planted && bi->saved_size) add_sw_code(bi);
+}
+
+static void start_planting_batch(Context * ctx, ContextAddress addr, size_t size) {
+    PlantingBatch * b = &planting_batch;
+    assert(b->ctx == NULL);
+    assert(size <= sizeof(b->buf));
+    planting_instruction = 1;
+    if (context_read_mem(ctx, addr, b->buf, size) == 0) {
+        b->ctx = ctx;
+        b->addr = addr;
+        b->size = size;
+        b->mod_lo = 0;
+        b->mod_hi = 0;
+        b->bi_cnt = 0;
+    }
+    planting_instruction = 0;
+}
+
+static void flush_planting_batch(void) {
+    unsigned i;
+    int error = 0;
+    PlantingBatch * b = &planting_batch;
+    if (b->ctx == NULL) return;
+    if (b->mod_lo < b->mod_hi) {
+        planting_instruction = 1;
+        if (context_write_mem(b->ctx, b->addr + b->mod_lo, b->buf + b->mod_lo, b->mod_hi - b->mod_lo) < 0) error = errno;
+        planting_instruction = 0;
+    }
+    b->ctx = NULL;
+    if (error) {
+        trace(LOG_CONTEXT, "Batch breakpoint planting failed: %s", errno_to_str(error));
+        /* Plant the instructions one by one to get individual error reports */
+        for (i = 0; i < b->bi_cnt; i++) {
+            BreakInstruction * bi = b->bi_arr[i];
+            if (!bi->planted) continue;
+            remove_sw_code(bi);
+            planted_sw_bp_cnt--;
+            bi->planted = 0;
+        }
+        for (i = 0; i < b->bi_cnt; i++) {
+            BreakInstruction * bi = b->bi_arr[i];
+            if (!bi->planted) plant_instruction(bi);
+        }
+    }
+    b->bi_cnt = 0;
+}
+
+static int cmp_planting_order(const void * x, const void * y) {
+    BreakInstruction * bx = *(BreakInstruction **)x;
+    BreakInstruction * by = *(BreakInstruction **)y;
+    if (bx->cb.ctx != by->cb.ctx) return (uintptr_t)bx->cb.ctx < (uintptr_t)by->cb.ctx ? -1 : +1;
+    if (bx->cb.address != by->cb.address) return bx->cb.address < by->cb.address ? -1 : +1;
+    return 0;
+}
+
+static void plant_instructions(BreakInstruction ** arr, unsigned cnt) {
+    /* Software breakpoints are sorted by address, and breakpoints in same page
+     * are planted using one memory read and one memory write */
+    unsigned i = 0;
+    if (cnt > 1) qsort(arr, cnt, sizeof(BreakInstruction *), cmp_planting_order);
+    while (i < cnt) {
+        unsigned j = i + 1;
+        Context * ctx = arr[i]->cb.ctx;
+        ContextAddress addr = arr[i]->cb.address;
+        ContextAddress page_end = (addr | (PLANTING_BATCH_SIZE - 1)) + 1;
+        while (j < cnt && arr[j]->cb.ctx == ctx && (page_end == 0 || arr[j]->cb.address < page_end)) j++;
+        if (j - i > 1) {
+            ContextAddress end = arr[j - 1]->cb.address + MAX_BI_SIZE;
+            if (page_end != 0 && (end > page_end || end < addr)) end = page_end;
+            start_planting_batch(ctx, addr, (size_t)(end - addr));
+        }
+        while (i < j) {
+            BreakInstruction * bi = arr[i++];
+            if (!bi->planted) plant_instruction(bi);
+        }
+        flush_planting_batch();
+    }
 }
 
 static int remove_instruction(BreakInstruction * bi) {
@@ -459,6 +618,7 @@ static int remove_instruction(BreakInstruction * bi) {
         }
     }
     if (!bi->virtual_addr) planted_sw_bp_cnt--;
+    if (bi->saved_size) remove_sw_code(bi);
     bi->planted = 0;
     bi->dirty = 0;
     return 0;
@@ -582,6 +742,12 @@ static void validate_bi_refs(BreakInstruction * bi) {
 static void flush_instructions(void) {
     LINK lst;
     LINK * l;
+    unsigned planting_cnt = 0;
+#if ENABLE_Trace
+    struct timespec time_start;
+    int timing = log_file != NULL && (log_mode & LOG_CONTEXT) != 0;
+    if (timing) clock_gettime(CLOCK_REALTIME, &time_start);
+#endif
 
     list_init(&lst);
 
@@ -716,8 +882,14 @@ static void flush_instructions(void) {
         assert(!bi->no_addr);
         if (bi->stepping_over_bp) continue;
         if (bi->ref_cnt == 0) continue;
-        if (!bi->planted) plant_instruction(bi);
+        if (bi->planted) continue;
+        if (planting_cnt >= planting_max) {
+            planting_max = planting_max ? planting_max * 2 : 64;
+            planting_arr = (BreakInstruction **)loc_realloc(planting_arr, sizeof(BreakInstruction *) * planting_max);
+        }
+        planting_arr[planting_cnt++] = bi;
     }
+    plant_instructions(planting_arr, planting_cnt);
 
     /* Free unused break instructions */
     l = instructions.next;
@@ -731,6 +903,15 @@ static void flush_instructions(void) {
         if (bi->planted && is_all_stopped(bi->cb.ctx)) remove_instruction(bi);
         if (!bi->planted) free_instruction(bi);
     }
+
+#if ENABLE_Trace
+    if (timing && planting_cnt > 0) {
+        struct timespec time_end;
+        clock_gettime(CLOCK_REALTIME, &time_end);
+        trace(LOG_CONTEXT, "Breakpoints: %u instructions planted in %ld ms", planting_cnt,
+            (long)(time_end.tv_sec - time_start.tv_sec) * 1000 + (time_end.tv_nsec - time_start.tv_nsec) / 1000000);
+    }
+#endif
 }
 
 static unsigned get_bp_hit_count(BreakpointInfo * bp, Context * ctx) {
@@ -811,6 +992,7 @@ void clone_breakpoints_on_process_fork(Context * parent, Context * child) {
         ci->valid = 1;
         ci->planted = 1;
         if (!bi->virtual_addr) planted_sw_bp_cnt++;
+        add_sw_code(ci);
     }
 }
 
@@ -824,6 +1006,7 @@ void invalidate_breakpoints_on_process_exec(Context * ctx) {
         if (!bi->saved_size) continue;
         if (bi->cb.ctx != mem) continue;
         if (!bi->virtual_addr) planted_sw_bp_cnt--;
+        remove_sw_code(bi);
         bi->planted = 0;
     }
 }
@@ -862,28 +1045,25 @@ int unplant_breakpoints(Context * ctx) {
 }
 
 int check_breakpoints_on_memory_read(Context * ctx, ContextAddress address, void * p, size_t size) {
-    if (!planting_instruction) {
+    if (!planting_instruction && planted_sw_code_cnt > 0) {
         while (size > 0) {
             size_t sz = size;
             uint8_t * buf = (uint8_t *)p;
-            LINK * l = instructions.next;
             Context * mem = NULL;
             ContextAddress mem_addr = 0;
             ContextAddress mem_base = 0;
             ContextAddress mem_size = 0;
-            while (l != &instructions) {
-                BreakInstruction * bi = link_all2bi(l);
+            ContextExtensionBP * ext = NULL;
+            unsigned n;
+            if (context_get_canonical_addr(ctx, address, &mem, &mem_addr, &mem_base, &mem_size) < 0) return -1;
+            if ((size_t)(mem_base + mem_size - mem_addr) < sz) sz = (size_t)(mem_base + mem_size - mem_addr);
+            ext = EXT(mem);
+            n = find_sw_code(mem, mem_addr >= MAX_BI_SIZE ? mem_addr - MAX_BI_SIZE + 1 : 0);
+            while (n < ext->sw_code_cnt) {
+                BreakInstruction * bi = ext->sw_code[n++];
                 size_t i;
-                l = l->next;
-                if (!bi->planted) continue;
-                if (!bi->saved_size) continue;
-                if (mem == NULL) {
-                    if (context_get_canonical_addr(ctx, address, &mem, &mem_addr, &mem_base, &mem_size) < 0) return -1;
-                    if ((size_t)(mem_base + mem_size - mem_addr) < sz) sz = (size_t)(mem_base + mem_size - mem_addr);
-                }
-                if (bi->cb.ctx != mem) continue;
+                if (bi->cb.address >= mem_addr + sz) break;
                 if (bi->cb.address + bi->saved_size <= mem_addr) continue;
-                if (bi->cb.address >= mem_addr + sz) continue;
                 for (i = 0; i < bi->saved_size; i++) {
                     if (bi->cb.address + i < mem_addr) continue;
                     if (bi->cb.address + i >= mem_addr + sz) continue;
@@ -899,28 +1079,25 @@ int check_breakpoints_on_memory_read(Context * ctx, ContextAddress address, void
 }
 
 int check_breakpoints_on_memory_write(Context * ctx, ContextAddress address, void * p, size_t size) {
-    if (!planting_instruction) {
+    if (!planting_instruction && planted_sw_code_cnt > 0) {
         while (size > 0) {
             size_t sz = size;
             uint8_t * buf = (uint8_t *)p;
-            LINK * l = instructions.next;
             Context * mem = NULL;
             ContextAddress mem_addr = 0;
             ContextAddress mem_base = 0;
             ContextAddress mem_size = 0;
-            while (l != &instructions) {
+            ContextExtensionBP * ext = NULL;
+            unsigned n;
+            if (context_get_canonical_addr(ctx, address, &mem, &mem_addr, &mem_base, &mem_size) < 0) return -1;
+            if ((size_t)(mem_base + mem_size - mem_addr) < sz) sz = (size_t)(mem_base + mem_size - mem_addr);
+            ext = EXT(mem);
+            n = find_sw_code(mem, mem_addr >= MAX_BI_SIZE ? mem_addr - MAX_BI_SIZE + 1 : 0);
+            while (n < ext->sw_code_cnt) {
+                BreakInstruction * bi = ext->sw_code[n++];
                 size_t i;
-                BreakInstruction * bi = link_all2bi(l);
-                l = l->next;
-                if (!bi->planted) continue;
-                if (!bi->saved_size) continue;
-                if (mem == NULL) {
-                    if (context_get_canonical_addr(ctx, address, &mem, &mem_addr, &mem_base, &mem_size) < 0) return -1;
-                    if ((size_t)(mem_base + mem_size - mem_addr) < sz) sz = (size_t)(mem_base + mem_size - mem_addr);
-                }
-                if (bi->cb.ctx != mem) continue;
+                if (bi->cb.address >= mem_addr + sz) break;
                 if (bi->cb.address + bi->saved_size <= mem_addr) continue;
-                if (bi->cb.address >= mem_addr + sz) continue;
                 for (i = 0; i < bi->saved_size; i++) {
                     if (bi->cb.address + i < mem_addr) continue;
                     if (bi->cb.address + i >= mem_addr + sz) continue;
@@ -1430,6 +1607,7 @@ static void free_bp(BreakpointInfo * bp) {
     loc_free(bp->stop_group);
     loc_free(bp->file);
     loc_free(bp->condition);
+    free_compiled_expression(bp->compiled_condition);
     loc_free(bp->client_data);
     while (bp->attrs != NULL) {
         BreakpointAttribute * attr = bp->attrs;
@@ -1831,7 +2009,8 @@ static void evaluate_condition(void * x) {
             if (bp->condition != NULL) {
                 Value v;
                 int b = 0;
-                if (evaluate_expression(ctx, STACK_TOP_FRAME, 0, bp->condition, 1, &v) < 0 ||
+                if (bp->compiled_condition == NULL) bp->compiled_condition = compile_expression(bp->condition);
+                if (evaluate_compiled_expression(ctx, STACK_TOP_FRAME, bp->compiled_condition, 1, &v) < 0 ||
                         (v.size > 0 && value_to_boolean(&v, &b) < 0)) {
                     int error = errno;
                     Channel * c = cache_channel();
@@ -2226,6 +2405,8 @@ static int set_breakpoint_attributes(BreakpointInfo * bp, BreakpointAttribute *
             }
             else if (strcmp(name, BREAKPOINT_CONDITION) == 0) {
                 loc_free(bp->condition);
+                free_compiled_expression(bp->compiled_condition);
+                bp->compiled_condition = NULL;
                 bp->condition = json_read_alloc_string(buf_inp);
             }
             else if (strcmp(name, BREAKPOINT_CONTEXTIDS) == 0) {
@@ -2306,6 +2487,8 @@ static int set_breakpoint_attributes(BreakpointInfo * bp, BreakpointAttribute *
         }
         else if (strcmp(name, BREAKPOINT_CONDITION) == 0) {
             loc_free(bp->condition);
+            free_compiled_expression(bp->compiled_condition);
+            bp->compiled_condition = NULL;
             bp->condition = NULL;
         }
         else if (strcmp(name, BREAKPOINT_CONTEXTIDS) == 0) {
@@ -3225,6 +3408,10 @@ static void event_context_disposed(Context * ctx, void * args) {
             loc_free(c);
         }
     }
+    assert(ext->sw_code_cnt == 0);
+    loc_free(ext->sw_code);
+    ext->sw_code = NULL;
+    ext->sw_code_max = 0;
 }
 
 #if SERVICE_MemoryMap
@@ -3235,26 +3422,27 @@ static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddre
     int cnt = 0;
     while (size > 0) {
         ContextAddress sz = size;
-        LINK * l = instructions.next;
         Context * mem = NULL;
         ContextAddress mem_addr = 0;
         ContextAddress mem_base = 0;
         ContextAddress mem_size = 0;
+        ContextExtensionBP * ext = NULL;
+        unsigned n;
         if (context_get_canonical_addr(ctx, addr, &mem, &mem_addr, &mem_base, &mem_size) < 0) break;
         if (mem_base + mem_size - mem_addr < sz) sz = mem_base + mem_size - mem_addr;
-        while (l != &instructions) {
+        ext = EXT(mem);
+        n = find_sw_code(mem, mem_addr);
+        while (n < ext->sw_code_cnt) {
             unsigned i;
-            BreakInstruction * bi = link_all2bi(l);
-            l = l->next;
-            if (!bi->planted) continue;
-            if (!bi->saved_size) continue;
-            if (bi->cb.ctx != mem) continue;
-            if (bi->cb.address < mem_addr || bi->cb.address >= mem_addr + sz) continue;
+            BreakInstruction * bi = ext->sw_code[n];
+            if (bi->cb.address >= mem_addr + sz) break;
+            assert(bi->planted);
             for (i = 0; i < bi->ref_cnt; i++) {
                 bi->refs[i].bp->status_changed = 1;
                 cnt++;
             }
             if (!bi->virtual_addr) planted_sw_bp_cnt--;
+            remove_sw_code(bi);
             bi->planted = 0;
         }
         addr += sz;
@@ -177,6 +177,16 @@ static int get_isa(Context * ctx, ContextAddress addr, ContextISA * isa) {
     return 0;
 }
 
+Disassembler * get_disassembler(Context * ctx, ContextAddress addr, ContextISA * isa) {
+    Disassembler * disassembler = NULL;
+    Context * cpu = context_get_group(ctx, CONTEXT_GROUP_CPU);
+    if (get_isa(ctx, addr, isa) < 0) return NULL;
+    if (isa->isa != NULL) disassembler = find_disassembler(cpu, isa->isa);
+    else disassembler = find_disassembler(cpu, isa->def);
+    if (disassembler == NULL) set_errno(ERR_OTHER, "Disassembler not available");
+    return disassembler;
+}
+
 static int disassemble_block(Context * ctx, OutputStream * out, uint8_t * mem_buf,
                               ContextAddress buf_addr, ContextAddress buf_size,
                               ContextAddress mem_size, ContextISA * isa,
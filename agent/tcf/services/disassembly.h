@@ -17,13 +17,27 @@
 #define D_disassembly
 
 #include <tcf/config.h>
+#include <tcf/framework/context.h>
 #include <tcf/framework/cpudefs.h>
 #include <tcf/framework/protocol.h>
 
+/*
+ * Control flow classes of an instruction, see DisassemblyResult.flow.
+ * Zero means the disassembler does not provide control flow info.
+ */
+#define DISASSEMBLY_FLOW_NEXT           1   /* Execution continues at next instruction */
+#define DISASSEMBLY_FLOW_JUMP           2   /* Jump to 'target' */
+#define DISASSEMBLY_FLOW_COND_JUMP      3   /* Conditional jump to 'target' */
+#define DISASSEMBLY_FLOW_CALL           4   /* Call 'target' */
+#define DISASSEMBLY_FLOW_CALL_INDIRECT  5   /* Call unknown address */
+#define DISASSEMBLY_FLOW_JUMP_INDIRECT  6   /* Jump to unknown address, including return */
+
 typedef struct {
     const char * text;
     ContextAddress size;
     int incomplete;
+    int flow;
+    ContextAddress target;
 } DisassemblyResult;
 
 /*
@@ -44,6 +58,13 @@ typedef DisassemblyResult * Disassembler(uint8_t * /* code */, ContextAddress /*
 
 extern void add_disassembler(Context * ctx, const char * isa, Disassembler disassembler);
 
+/*
+ * Find disassembler for the code at given address.
+ * On success, 'isa' is filled with ISA information for the address.
+ * Return NULL and set errno if there is no disassembler for the ISA.
+ */
+extern Disassembler * get_disassembler(Context * ctx, ContextAddress addr, ContextISA * isa);
+
 extern void ini_disassembly_service(Protocol * proto);
 
 #else /* SERVICE_Disassembly */
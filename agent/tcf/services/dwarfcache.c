@@ -24,28 +24,25 @@
 #if ENABLE_ELF && ENABLE_DebugContext
 
 #include <assert.h>
+#include <ctype.h>
+#include <tcf/framework/asyncreq.h>
+#include <tcf/framework/cache.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/myalloc.h>
 #include <tcf/framework/trace.h>
 #include <tcf/services/dwarf.h>
 #include <tcf/services/dwarfcache.h>
+#include <tcf/services/dwarfdiskcache.h>
 #include <tcf/services/dwarfexpr.h>
 #include <tcf/services/stacktrace.h>
 
 #define OBJ_HASH(HashTable,ID) (((U4_T)(ID) + ((U4_T)(ID) >> 8)) % HashTable->mObjectHashSize)
 
-#define OBJECT_ARRAY_SIZE 128
-
 /* Pseudo object IDs for fundamental types */
 #define OBJECT_ID_VOID(CompUnit) (~(CompUnit)->mFundTypeID - 0)
 #define OBJECT_ID_CHAR(CompUnit) (~(CompUnit)->mFundTypeID - 1)
 #define OBJECT_ID_LAST(Cache) (~(Cache)->mFundTypeID)
 
-typedef struct ObjectArray {
-    struct ObjectArray * mNext;
-    ObjectInfo mArray[OBJECT_ARRAY_SIZE];
-} ObjectArray;
-
 typedef struct ObjectReference {
     ObjectInfo * obj;
     ObjectInfo * org;
@@ -55,8 +52,8 @@ static DWARFCache * sCache;
 static ELF_Section * sDebugSection;
 static DIO_UnitDescriptor sUnitDesc;
 static CompUnit * sCompUnit;
-static ObjectInfo * sParentObject;
-static ObjectInfo * sPrevSibling;
+static U4_T sParentObject;     /* Arena index of parent of current entry */
+static U4_T sPrevSibling;      /* Arena index of previous sibling of current entry */
 static ObjectReference * sObjRefs;
 static U4_T sObjRefsCnt = 0;
 static U4_T sObjRefsMax = 0;
@@ -80,29 +77,45 @@ unsigned calc_file_name_hash(const char * s) {
     return h;
 }
 
-static ObjectInfo * add_object_info(ContextAddress ID) {
+static U4_T find_object_index(DWARFCache * Cache, ELF_Section * Section, ContextAddress ID) {
+    ObjectHashTable * HashTable = Cache->mObjectHashTable + Section->index;
+    U4_T Index = HashTable->mObjectHash[OBJ_HASH(HashTable, ID)];
+    while (Index != 0) {
+        ObjectInfo * Info = get_dwarf_object(Cache, Index);
+        if (Info->mID == ID) return Index;
+        Index = Info->mHashNext;
+    }
+    return 0;
+}
+
+static U4_T add_object_index(ContextAddress ID) {
     ObjectHashTable * HashTable = sCache->mObjectHashTable + sDebugSection->index;
     U4_T Hash = OBJ_HASH(HashTable, ID);
-    ObjectInfo * Info = HashTable->mObjectHash[Hash];
-    while (Info != NULL) {
-        if (Info->mID == ID) return Info;
-        Info = Info->mHashNext;
-    }
+    U4_T Index = find_object_index(sCache, sDebugSection, ID);
+    ObjectInfo * Info = NULL;
+    if (Index != 0) return Index;
     if (ID < OBJECT_ID_LAST(sCache)) {
         if (ID < sDebugSection->addr) str_exception(ERR_INV_DWARF, "Invalid entry reference");
         if (ID > sDebugSection->addr + sDebugSection->size) str_exception(ERR_INV_DWARF, "Invalid entry reference");
     }
-    if (sCache->mObjectArrayPos >= OBJECT_ARRAY_SIZE) {
-        ObjectArray * Buf = (ObjectArray *)loc_alloc_zero(sizeof(ObjectArray));
-        Buf->mNext = sCache->mObjectList;
-        sCache->mObjectList = Buf;
-        sCache->mObjectArrayPos = 0;
+    if (sCache->mObjectCnt >= sCache->mObjectChunksCnt * OBJECT_CHUNK_SIZE) {
+        if (sCache->mObjectCnt >= 0xffffffffu - OBJECT_CHUNK_SIZE) str_exception(ERR_BUFFER_OVERFLOW, "Too many debug info entries");
+        if (sCache->mObjectChunksCnt >= sCache->mObjectChunksMax) {
+            sCache->mObjectChunksMax = sCache->mObjectChunksMax == 0 ? 64 : sCache->mObjectChunksMax * 2;
+            sCache->mObjectChunks = (ObjectInfo **)loc_realloc(sCache->mObjectChunks, sizeof(ObjectInfo *) * sCache->mObjectChunksMax);
+        }
+        sCache->mObjectChunks[sCache->mObjectChunksCnt++] = (ObjectInfo *)loc_alloc_zero(sizeof(ObjectInfo) * OBJECT_CHUNK_SIZE);
     }
-    Info = sCache->mObjectList->mArray + sCache->mObjectArrayPos++;
+    Index = ++sCache->mObjectCnt;
+    Info = get_dwarf_object(sCache, Index);
     Info->mHashNext = HashTable->mObjectHash[Hash];
-    HashTable->mObjectHash[Hash] = Info;
+    HashTable->mObjectHash[Hash] = Index;
     Info->mID = ID;
-    return Info;
+    return Index;
+}
+
+static ObjectInfo * add_object_info(ContextAddress ID) {
+    return get_dwarf_object(sCache, add_object_index(ID));
 }
 
 static CompUnit * add_comp_unit(ContextAddress ID) {
@@ -170,7 +183,7 @@ static CompUnit * find_type_unit(U8_T Signature) {
 static void read_type_unit_header(U2_T Tag, U2_T Attr, U2_T Form) {
     if (Attr == 0) {
         if (Form) {
-            assert(sParentObject == NULL);
+            assert(sParentObject == 0);
             if (Tag != TAG_type_unit) str_exception(ERR_INV_DWARF, "Invalid .debug_types section");
             sCompUnit = add_comp_unit((ContextAddress)(sDebugSection->addr + dio_gEntryPos));
         }
@@ -193,12 +206,8 @@ static void read_object_refs(ELF_Section * Section);
 
 ObjectInfo * find_object(ELF_Section * Section, ContextAddress ID) {
     DWARFCache * Cache = get_dwarf_cache(Section->file);
-    ObjectHashTable * HashTable = Cache->mObjectHashTable + Section->index;
-    ObjectInfo * Info = HashTable->mObjectHash[OBJ_HASH(HashTable, ID)];
-    while (Info != NULL) {
-        if (Info->mID == ID) return Info;
-        Info = Info->mHashNext;
-    }
+    ObjectInfo * Info = get_dwarf_object(Cache, find_object_index(Cache, Section, ID));
+    if (Info != NULL) return Info;
 #if ENABLE_DWARF_LAZY_LOAD
     if (Cache->lazy_loaded) {
         sCache = Cache;
@@ -208,16 +217,12 @@ ObjectInfo * find_object(ELF_Section * Section, ContextAddress ID) {
             Trap trap;
             sUnitDesc = sCompUnit->mDesc;
             sDebugSection = sUnitDesc.mSection;
-            sParentObject = NULL;
-            sPrevSibling = NULL;
+            sParentObject = 0;
+            sPrevSibling = 0;
             dio_EnterSection(&sCompUnit->mDesc, sDebugSection, ID - sDebugSection->addr);
             if (set_trap(&trap)) {
                 dio_ReadEntry(read_object_info, 0);
-                Info = HashTable->mObjectHash[OBJ_HASH(HashTable, ID)];
-                while (Info != NULL) {
-                    if (Info->mID == ID) break;
-                    Info = Info->mHashNext;
-                }
+                Info = get_dwarf_object(Cache, find_object_index(Cache, Section, ID));
                 clear_trap(&trap);
             }
             dio_ExitSection();
@@ -233,14 +238,7 @@ ObjectInfo * find_object(ELF_Section * Section, ContextAddress ID) {
 
 static ObjectInfo * find_loaded_object(ELF_Section * Section, ContextAddress ID) {
     DWARFCache * Cache = (DWARFCache *)Section->file->dwarf_dt_cache;
-    if (Cache != NULL) {
-        ObjectHashTable * HashTable = Cache->mObjectHashTable + Section->index;
-        ObjectInfo * Info = HashTable->mObjectHash[OBJ_HASH(HashTable, ID)];
-        while (Info != NULL) {
-            if (Info->mID == ID) return Info;
-            Info = Info->mHashNext;
-        }
-    }
+    if (Cache != NULL) return get_dwarf_object(Cache, find_object_index(Cache, Section, ID));
     return NULL;
 }
 
@@ -438,25 +436,31 @@ static void read_subscr_data(U2_T Form, ObjectInfo * Array) {
             break;
         }
         if (Type != NULL) {
-            ObjectInfo * Range = add_object_info((ContextAddress)(sDebugSection->addr + dio_GetPos()));
+            U4_T RangeIndex = add_object_index((ContextAddress)(sDebugSection->addr + dio_GetPos()));
+            ObjectInfo * Range = get_dwarf_object(sCache, RangeIndex);
             Range->mTag = TAG_index_range;
             Range->mCompUnit = sCompUnit;
             Range->mType = Type;
-            Range->u.mRange.mFmt = Fmt;
+            if (Range->u.mRange == NULL) {
+                Range->u.mRange = (IndexRangeInfo *)loc_alloc_zero(sizeof(IndexRangeInfo));
+                Range->u.mRange->mNext = sCache->mIndexRanges;
+                sCache->mIndexRanges = Range->u.mRange;
+            }
+            Range->u.mRange->mFmt = Fmt;
             switch (Fmt) {
             case FMT_FT_C_C:
             case FMT_FT_C_X:
             case FMT_UT_C_C:
             case FMT_UT_C_X:
-                Range->u.mRange.mLow.mValue = read_long_value();
+                Range->u.mRange->mLow.mValue = read_long_value();
                 break;
             case FMT_FT_X_C:
             case FMT_FT_X_X:
             case FMT_UT_X_C:
             case FMT_UT_X_X:
                 dio_ReadAttribute(0, FORM_BLOCK2);
-                Range->u.mRange.mLow.mExpr.mAddr = (U1_T *)dio_gFormDataAddr;
-                Range->u.mRange.mLow.mExpr.mSize = dio_gFormDataSize;
+                Range->u.mRange->mLow.mExpr.mAddr = (U1_T *)dio_gFormDataAddr;
+                Range->u.mRange->mLow.mExpr.mSize = dio_gFormDataSize;
                 break;
             }
             switch (Fmt) {
@@ -464,15 +468,15 @@ static void read_subscr_data(U2_T Form, ObjectInfo * Array) {
             case FMT_FT_X_C:
             case FMT_UT_C_C:
             case FMT_UT_X_C:
-                Range->u.mRange.mHigh.mValue = read_long_value();
+                Range->u.mRange->mHigh.mValue = read_long_value();
                 break;
             case FMT_FT_C_X:
             case FMT_FT_X_X:
             case FMT_UT_C_X:
             case FMT_UT_X_X:
                 dio_ReadAttribute(0, FORM_BLOCK2);
-                Range->u.mRange.mHigh.mExpr.mAddr = (U1_T *)dio_gFormDataAddr;
-                Range->u.mRange.mHigh.mExpr.mSize = dio_gFormDataSize;
+                Range->u.mRange->mHigh.mExpr.mAddr = (U1_T *)dio_gFormDataAddr;
+                Range->u.mRange->mHigh.mExpr.mSize = dio_gFormDataSize;
                 break;
             }
             *Children = Range;
@@ -516,6 +520,7 @@ static void read_subscr_data(U2_T Form, ObjectInfo * Array) {
 
 static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
     static ObjectInfo * Info;
+    static U4_T InfoIndex;
     static U8_T Sibling;
     static int HasChildren;
     static int Skip;
@@ -528,19 +533,18 @@ static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
         if (Form) {
             /* Initialization: executed before debug entry processing */
             high_pc_offs = 0;
+            InfoIndex = add_object_index((ContextAddress)(sDebugSection->addr + dio_gEntryPos));
+            Info = get_dwarf_object(sCache, InfoIndex);
             if (Tag == TAG_compile_unit || Tag == TAG_partial_unit || Tag == TAG_type_unit) {
-                CompUnit * Unit = add_comp_unit((ContextAddress)(sDebugSection->addr + dio_gEntryPos));
-                assert(sParentObject == NULL);
-                Info = Unit->mObject;
+                CompUnit * Unit = add_comp_unit(Info->mID);
+                assert(sParentObject == 0);
+                assert(Info == Unit->mObject);
                 assert(Info->mTag == 0);
                 sCompUnit = Unit;
             }
-            else {
-                Info = add_object_info((ContextAddress)(sDebugSection->addr + dio_gEntryPos));
-            }
             if (sParentObject) {
                 Info->mParent = sParentObject;
-                if (sParentObject->mFlags & DOIF_need_frame) {
+                if (get_dwarf_object(sCache, sParentObject)->mFlags & DOIF_need_frame) {
                     /* Allow frame in get_symbol_container() */
                     Info->mFlags |= DOIF_need_frame;
                 }
@@ -626,17 +630,17 @@ static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
                 }
                 break;
             }
-            if (sPrevSibling != NULL) sPrevSibling->mSibling = Info;
-            else if (sParentObject != NULL) sParentObject->mChildren = Info;
+            if (sPrevSibling != 0) get_dwarf_object(sCache, sPrevSibling)->mSibling = Info;
+            else if (sParentObject != 0) get_dwarf_object(sCache, sParentObject)->mChildren = Info;
             else if (Tag == TAG_compile_unit) sCache->mObjectHashTable[sDebugSection->index].mCompUnits = Info;
             else if (Tag == TAG_partial_unit) sCache->mObjectHashTable[sDebugSection->index].mCompUnits = Info;
             else if (Tag == TAG_type_unit) sCache->mObjectHashTable[sDebugSection->index].mCompUnits = Info;
-            sPrevSibling = Info;
+            sPrevSibling = InfoIndex;
             if (Skip && Sibling != 0) {
                 dio_SetPos(Sibling);
                 return;
             }
-            if (Tag == TAG_enumerator && Info->mType == NULL) Info->mType = sParentObject;
+            if (Tag == TAG_enumerator && Info->mType == NULL) Info->mType = get_dwarf_object(sCache, sParentObject);
 #if ENABLE_DWARF_LAZY_LOAD
             if (sCache->mFile->lock_cnt == 0 && Sibling != 0 && sDebugSection->size >= 0x40000) {
                 switch (Tag) {
@@ -657,10 +661,10 @@ static void read_object_info(U2_T Tag, U2_T Attr, U2_T Form) {
             Info->mFlags |= DOIF_children_loaded;
             if (Sibling != 0 || HasChildren) {
                 U8_T SiblingPos = Sibling;
-                ObjectInfo * Parent = sParentObject;
-                ObjectInfo * PrevSibling = sPrevSibling;
-                sParentObject = Info;
-                sPrevSibling = NULL;
+                U4_T Parent = sParentObject;
+                U4_T PrevSibling = sPrevSibling;
+                sParentObject = InfoIndex;
+                sPrevSibling = 0;
                 for (;;) {
                     if (SiblingPos > 0 && dio_GetPos() >= SiblingPos) break;
                     if (!dio_ReadEntry(read_object_info, 0)) break;
@@ -933,8 +937,8 @@ static void read_object_refs(ELF_Section * Section) {
                 sCompUnit = obj->mCompUnit;
                 sUnitDesc = sCompUnit->mDesc;
                 sDebugSection = sUnitDesc.mSection;
-                sParentObject = NULL;
-                sPrevSibling = NULL;
+                sParentObject = 0;
+                sPrevSibling = 0;
                 dio_EnterSection(&sCompUnit->mDesc, sDebugSection, obj->mID - sDebugSection->addr);
                 if (set_trap(&trap)) {
                     dio_ReadEntry(read_object_info, 0);
@@ -974,14 +978,16 @@ static void read_object_refs(ELF_Section * Section) {
                     if (ref.obj->mFlags & DOIF_abstract_origin) {
                         if ((ref.obj->mTag == TAG_variable && (ref.obj->mFlags & DOIF_external)) ||
                                 ref.obj->mTag == TAG_subprogram ||
-                                (ref.obj->mTag == TAG_formal_parameter && ref.obj->mParent != NULL && ref.obj->mParent->mTag == TAG_subprogram))
+                                (ref.obj->mTag == TAG_formal_parameter && ref.obj->mParent != 0 &&
+                                    get_dwarf_loaded_parent(ref.obj)->mTag == TAG_subprogram))
                             ref.org->mDefinition = ref.obj;
                     }
                     if (ref.obj->mFlags & DOIF_external) {
                         ObjectInfo * cls = ref.org;
-                        while (cls->mParent != NULL &&
-                            (cls->mParent->mTag == TAG_class_type || cls->mParent->mTag == TAG_structure_type)) {
-                            cls = cls->mParent;
+                        ObjectInfo * parent = get_dwarf_loaded_parent(cls);
+                        while (parent != NULL && (parent->mTag == TAG_class_type || parent->mTag == TAG_structure_type)) {
+                            cls = parent;
+                            parent = get_dwarf_loaded_parent(cls);
                         }
                         cls->mFlags |= DOIF_external;
                     }
@@ -1070,6 +1076,308 @@ static void add_object_addr_ranges(ObjectInfo * info) {
     }
 }
 
+#if ENABLE_DWARF_PREPASS
+
+/*
+ * Pre-pass over debug sections of a big file, done by worker threads before the file is parsed.
+ * The workers fault in the mapped section pages, parse the abbreviation table and the address ranges table.
+ * DIE decoding is not done by the workers - the DWARF reader state is global and not thread safe.
+ */
+
+#define PREPASS_CHUNK_SIZE  (4 * 1024 * 1024)
+#define PREPASS_PAGE_SIZE   4096
+
+#define PREPASS_TOUCH       0
+#define PREPASS_ABBREV      1
+#define PREPASS_ARANGES     2
+
+typedef struct PrepassARangeSet {
+    U8_T mUnitOffs;
+    unsigned mPos;
+    unsigned mCnt;
+} PrepassARangeSet;
+
+typedef struct PrepassRequest {
+    AsyncReqInfo mReq;
+    struct DWARFPrepass * mPrepass;
+    struct PrepassRequest * mNext;
+    ELF_Section * mSection;
+    int mType;
+    int mError;
+    U8_T mOffs;
+    U8_T mSize;
+    struct DIO_AbbrevSet ** mAbbrevTable;
+    PrepassARangeSet * mSets;
+    unsigned mSetsCnt;
+    unsigned mSetsMax;
+    U8_T * mRanges;
+    unsigned mRangesCnt;
+    unsigned mRangesMax;
+} PrepassRequest;
+
+typedef struct DWARFPrepass {
+    LINK mLink;
+    ELF_File * mFile;
+    AbstractCache mCache;
+    PrepassRequest * mRequests;
+    unsigned mPending;
+} DWARFPrepass;
+
+#define link2prepass(x) ((DWARFPrepass *)((char *)(x) - offsetof(DWARFPrepass, mLink)))
+
+static LINK sPrepassList = TCF_LIST_INIT(sPrepassList);
+static DWARFPrepass * sPrepass = NULL;
+
+static void free_prepass(DWARFPrepass * p);
+
+static int prepass_read(PrepassRequest * r, U8_T * pos, unsigned size, U8_T * res) {
+    U1_T * data = (U1_T *)r->mSection->data;
+    int big_endian = r->mSection->file->big_endian;
+    U8_T x = 0;
+    unsigned i;
+    if (*pos + size > r->mSection->size) return -1;
+    for (i = 0; i < size; i++) {
+        U8_T b = data[*pos + (big_endian ? i : size - i - 1)];
+        x = (x << 8) | b;
+    }
+    *pos += size;
+    *res = x;
+    return 0;
+}
+
+static int prepass_read_aranges(PrepassRequest * r) {
+    /* Same as the .debug_aranges parser in load_addr_ranges(), but without relocations and exceptions */
+    U8_T pos = 0;
+    U8_T sec_size = r->mSection->size;
+    while (pos < sec_size) {
+        int dwarf64 = 0;
+        U8_T size = 0;
+        U8_T next = 0;
+        U8_T version = 0;
+        if (prepass_read(r, &pos, 4, &size) < 0) return -1;
+        if (size == 0xffffffffu) {
+            dwarf64 = 1;
+            if (prepass_read(r, &pos, 8, &size) < 0) return -1;
+        }
+        next = pos + size;
+        if (prepass_read(r, &pos, 2, &version) < 0) return -1;
+        if (version == 2) {
+            PrepassARangeSet * set = NULL;
+            U8_T unit_offs = 0;
+            U8_T addr_size = 0;
+            U8_T segm_size = 0;
+            if (prepass_read(r, &pos, dwarf64 ? 8 : 4, &unit_offs) < 0) return -1;
+            if (prepass_read(r, &pos, 1, &addr_size) < 0) return -1;
+            if (prepass_read(r, &pos, 1, &segm_size) < 0) return -1;
+            if (segm_size != 0) return -1;
+            if (addr_size != 2 && addr_size != 4 && addr_size != 8) return -1;
+            if (r->mSetsCnt >= r->mSetsMax) {
+                r->mSetsMax = r->mSetsMax == 0 ? 64 : r->mSetsMax * 2;
+                r->mSets = (PrepassARangeSet *)loc_realloc(r->mSets, sizeof(PrepassARangeSet) * r->mSetsMax);
+            }
+            set = r->mSets + r->mSetsCnt++;
+            set->mUnitOffs = unit_offs;
+            set->mPos = r->mRangesCnt;
+            set->mCnt = 0;
+            while (pos % (addr_size * 2) != 0) pos++;
+            for (;;) {
+                U8_T addr = 0;
+                U8_T size = 0;
+                if (prepass_read(r, &pos, (unsigned)addr_size, &addr) < 0) return -1;
+                if (prepass_read(r, &pos, (unsigned)addr_size, &size) < 0) return -1;
+                if (addr == 0 && size == 0 && pos + addr_size * 2 > next) break;
+                if (size == 0) continue;
+                if (r->mRangesCnt + 2 > r->mRangesMax) {
+                    r->mRangesMax = r->mRangesMax == 0 ? 256 : r->mRangesMax * 2;
+                    r->mRanges = (U8_T *)loc_realloc(r->mRanges, sizeof(U8_T) * r->mRangesMax);
+                }
+                r->mRanges[r->mRangesCnt++] = addr;
+                r->mRanges[r->mRangesCnt++] = size;
+                set->mCnt++;
+            }
+        }
+        pos = next;
+    }
+    return 0;
+}
+
+static int prepass_worker(void * args) {
+    PrepassRequest * r = (PrepassRequest *)args;
+    switch (r->mType) {
+    case PREPASS_TOUCH:
+        {
+            volatile U1_T * data = (U1_T *)r->mSection->data + r->mOffs;
+            U8_T pos;
+            for (pos = 0; pos < r->mSize; pos += PREPASS_PAGE_SIZE) (void)data[pos];
+        }
+        break;
+    case PREPASS_ABBREV:
+        r->mAbbrevTable = dio_ParseAbbrevTable(r->mSection);
+        if (r->mAbbrevTable == NULL) r->mError = 1;
+        break;
+    case PREPASS_ARANGES:
+        if (prepass_read_aranges(r) < 0) r->mError = 1;
+        break;
+    }
+    return 0;
+}
+
+static void prepass_done(void * args) {
+    PrepassRequest * r = (PrepassRequest *)((AsyncReqInfo *)args)->client_data;
+    DWARFPrepass * p = r->mPrepass;
+    assert(p->mPending > 0);
+    if (--p->mPending > 0) return;
+    assert(p->mFile->lock_cnt > 0);
+    p->mFile->lock_cnt--;
+    trace(LOG_ELF, "DWARF pre-pass done: %s", p->mFile->name);
+    if (p->mFile->dwarf_dt_cache != NULL) {
+        /* The file was loaded synchronously, the results are not needed */
+        cache_notify(&p->mCache);
+        free_prepass(p);
+        return;
+    }
+    /* Note: waiting clients load the file and dispose the pre-pass */
+    cache_notify(&p->mCache);
+}
+
+static void post_prepass_request(DWARFPrepass * p, ELF_Section * sec, int type, U8_T offs, U8_T size) {
+    PrepassRequest * r = (PrepassRequest *)loc_alloc_zero(sizeof(PrepassRequest));
+    r->mPrepass = p;
+    r->mSection = sec;
+    r->mType = type;
+    r->mOffs = offs;
+    r->mSize = size;
+    r->mNext = p->mRequests;
+    p->mRequests = r;
+    r->mReq.type = AsyncReqUser;
+    r->mReq.done = prepass_done;
+    r->mReq.client_data = r;
+    r->mReq.u.user.func = prepass_worker;
+    r->mReq.u.user.data = r;
+    p->mPending++;
+    async_req_post(&r->mReq);
+}
+
+static int is_prepass_section(ELF_Section * sec) {
+    static const char * names[] = {
+        ".debug_info", ".debug_types", ".debug_abbrev", ".debug_str", ".debug_line_str",
+        ".debug_str_offsets", ".debug_addr", ".debug_aranges", ".debug_ranges", ".debug_rnglists",
+        ".debug_line", ".debug", ".line", NULL
+    };
+    unsigned i;
+    if (sec->size == 0) return 0;
+    if (sec->name == NULL) return 0;
+    if (sec->type == SHT_NOBITS) return 0;
+    for (i = 0; names[i] != NULL; i++) {
+        if (strcmp(sec->name, names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static DWARFPrepass * find_prepass(ELF_File * file) {
+    LINK * l;
+    for (l = sPrepassList.next; l != &sPrepassList; l = l->next) {
+        DWARFPrepass * p = link2prepass(l);
+        if (p->mFile == file) return p;
+    }
+    return NULL;
+}
+
+static DWARFPrepass * start_prepass(ELF_File * file) {
+    unsigned idx;
+    U8_T info_size = 0;
+    unsigned abbrev_cnt = 0;
+    DWARFPrepass * p = NULL;
+
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        ELF_Section * sec = file->sections + idx;
+        if (!is_prepass_section(sec)) continue;
+        if (strcmp(sec->name, ".debug_info") == 0 || strcmp(sec->name, ".debug_types") == 0) info_size += sec->size;
+        if (strcmp(sec->name, ".debug_abbrev") == 0) abbrev_cnt++;
+    }
+    if (info_size < DWARF_PREPASS_MIN_SIZE) return NULL;
+
+    p = (DWARFPrepass *)loc_alloc_zero(sizeof(DWARFPrepass));
+    p->mFile = file;
+    list_add_last(&p->mLink, &sPrepassList);
+    /* Sections are loaded by the dispatch thread: big sections are mapped, small ones are read */
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        ELF_Section * sec = file->sections + idx;
+        if (!is_prepass_section(sec)) continue;
+        if (elf_load(sec) < 0) continue;
+        if (sec->mmap_addr != NULL) {
+            U8_T offs = 0;
+            while (offs < sec->size) {
+                U8_T size = sec->size - offs;
+                if (size > PREPASS_CHUNK_SIZE) size = PREPASS_CHUNK_SIZE;
+                post_prepass_request(p, sec, PREPASS_TOUCH, offs, size);
+                offs += size;
+            }
+        }
+        if (abbrev_cnt == 1 && strcmp(sec->name, ".debug_abbrev") == 0) {
+            post_prepass_request(p, sec, PREPASS_ABBREV, 0, sec->size);
+        }
+        else if (sec->relocate == NULL && strcmp(sec->name, ".debug_aranges") == 0) {
+            post_prepass_request(p, sec, PREPASS_ARANGES, 0, sec->size);
+        }
+    }
+    if (p->mPending > 0) {
+        file->lock_cnt++;
+        trace(LOG_ELF, "DWARF pre-pass started: %s, %u requests", file->name, p->mPending);
+    }
+    return p;
+}
+
+static void free_prepass(DWARFPrepass * p) {
+    assert(p->mPending == 0);
+    if (sPrepass == p) sPrepass = NULL;
+    list_remove(&p->mLink);
+    cache_dispose(&p->mCache);
+    while (p->mRequests != NULL) {
+        PrepassRequest * r = p->mRequests;
+        p->mRequests = r->mNext;
+        if (r->mAbbrevTable != NULL) dio_FreeAbbrevTable(r->mAbbrevTable);
+        loc_free(r->mSets);
+        loc_free(r->mRanges);
+        loc_free(r);
+    }
+    loc_free(p);
+}
+
+static void use_prepass_abbrev_table(void) {
+    PrepassRequest * r;
+    if (sPrepass == NULL) return;
+    for (r = sPrepass->mRequests; r != NULL; r = r->mNext) {
+        if (r->mType != PREPASS_ABBREV || r->mError) continue;
+        dio_SetAbbrevTable(sCache->mFile, r->mSection, r->mAbbrevTable);
+        r->mAbbrevTable = NULL;
+    }
+}
+
+static int add_prepass_addr_ranges(ELF_Section * sec, ELF_Section * debug_info) {
+    PrepassRequest * r;
+    unsigned i, j;
+    if (sPrepass == NULL) return 0;
+    for (r = sPrepass->mRequests; r != NULL; r = r->mNext) {
+        if (r->mType == PREPASS_ARANGES && r->mSection == sec) break;
+    }
+    if (r == NULL || r->mError) return 0;
+    sCompUnit = NULL;
+    for (i = 0; i < r->mSetsCnt; i++) {
+        PrepassARangeSet * set = r->mSets + i;
+        sCompUnit = find_comp_unit(debug_info, (ContextAddress)set->mUnitOffs);
+        if (sCompUnit == NULL) str_exception(ERR_INV_DWARF, "invalid .debug_aranges section");
+        sCompUnit->mObject->mFlags |= DOIF_aranges;
+        for (j = 0; j < set->mCnt; j++) {
+            U8_T * range = r->mRanges + (set->mPos + j * 2);
+            add_addr_range(NULL, sCompUnit, (ContextAddress)range[0], (ContextAddress)range[1]);
+        }
+    }
+    return 1;
+}
+
+#endif /* ENABLE_DWARF_PREPASS */
+
 static void load_addr_ranges(ELF_Section * debug_info) {
     Trap trap;
     unsigned idx;
@@ -1081,6 +1389,9 @@ static void load_addr_ranges(ELF_Section * debug_info) {
         if (sec->size == 0) continue;
         if (sec->name == NULL) continue;
         if (strcmp(sec->name, ".debug_aranges") == 0) {
+#if ENABLE_DWARF_PREPASS
+            if (add_prepass_addr_ranges(sec, debug_info)) continue;
+#endif
             sCompUnit = NULL;
             dio_EnterSection(NULL, sec, 0);
             if (set_trap(&trap)) {
@@ -1155,11 +1466,11 @@ static void load_addr_ranges(ELF_Section * debug_info) {
                 assert(info->mFlags & DOIF_children_loaded);
                 while (obj != NULL) {
                     if (obj->mFlags & DOIF_low_pc) add_object_addr_ranges(obj);
-                    obj = obj->mSibling;
+                    obj = get_dwarf_sibling(obj);
                 }
             }
 
-            info = info->mSibling;
+            info = get_dwarf_sibling(info);
         }
     }
     if (sCache->mAddrRangesCnt > 1) {
@@ -1216,9 +1527,9 @@ static int cmp_pub_objects(ObjectInfo * x, ObjectInfo * y) {
         DOIF_const_value;
 
     if ((x->mFlags & flags) != (y->mFlags & flags)) return 0;
-    if (x->mParent != y->mParent) {
-        ObjectInfo * px = x->mParent;
-        ObjectInfo * py = y->mParent;
+    if (get_dwarf_loaded_parent(x) != get_dwarf_loaded_parent(y)) {
+        ObjectInfo * px = get_dwarf_loaded_parent(x);
+        ObjectInfo * py = get_dwarf_loaded_parent(y);
         for (;;) {
             if (px == NULL || py == NULL) return 0;
             if (px->mTag != py->mTag) return 0;
@@ -1227,8 +1538,8 @@ static int cmp_pub_objects(ObjectInfo * x, ObjectInfo * y) {
                 if (px->mName == NULL || py->mName == NULL) return 0;
                 if (strcmp(px->mName, py->mName) != 0) return 0;
             }
-            px = px->mParent;
-            py = py->mParent;
+            px = get_dwarf_loaded_parent(px);
+            py = get_dwarf_loaded_parent(py);
         }
     }
     switch (x->mTag) {
@@ -1329,13 +1640,28 @@ static void add_namespace(PubNamesTable * tbl, ObjectInfo * ns) {
                 if ((n->mFlags & DOIF_pub_mark) == 0 && n->mName != NULL) {
                     add_pub_name(tbl, n);
                 }
-                n = n->mSibling;
+                n = get_dwarf_sibling(n);
             }
         }
         if (obj->mTag == TAG_namespace) {
             add_namespace(tbl, obj);
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
+    }
+}
+
+static void add_declarations(PubNamesTable * tbl, ObjectInfo * ns) {
+    /* Name indices do not list declarations, add them now to keep index misses authoritative */
+    ObjectInfo * obj = get_dwarf_children(ns);
+    while (obj != NULL) {
+        if ((obj->mFlags & (DOIF_pub_mark | DOIF_declaration)) == DOIF_declaration &&
+                obj->mDefinition == NULL && obj->mName != NULL) {
+            add_pub_name(tbl, obj);
+        }
+        if (obj->mTag == TAG_namespace) {
+            add_declarations(tbl, obj);
+        }
+        obj = get_dwarf_sibling(obj);
     }
 }
 
@@ -1343,20 +1669,507 @@ static void create_pub_names(unsigned idx) {
     ObjectInfo * unit = sCache->mObjectHashTable[idx].mCompUnits;
     PubNamesTable * tbl = &sCache->mPubNames;
     while (unit != NULL) {
-        add_namespace(tbl, unit);
+        if (!unit->mCompUnit->mPubNamesDeferred) add_namespace(tbl, unit);
+        else add_declarations(tbl, unit);
         if ((unit->mFlags & DOIF_pub_mark) == 0 && unit->mName != NULL) {
             add_pub_name(tbl, unit);
         }
-        unit = unit->mSibling;
+        unit = get_dwarf_sibling(unit);
+    }
+}
+
+#if ENABLE_DWARF_NAME_INDEX
+
+#define IDX_compile_unit    1
+#define IDX_type_unit       2
+
+typedef struct GdbIndexHeader {
+    U4_T mVersion;
+    U4_T mCUList;
+    U4_T mTUList;
+    U4_T mAddrArea;
+    U4_T mSymbols;
+    U4_T mConstPool;
+} GdbIndexHeader;
+
+typedef struct DebugNamesHeader {
+    U8_T mNext;
+    unsigned mOffsSize;
+    U2_T mVersion;
+    U4_T mCUCnt;
+    U4_T mLocalTUCnt;
+    U4_T mBucketCnt;
+    U4_T mNameCnt;
+    U8_T mCUList;
+    U8_T mLocalTUList;
+    U8_T mBuckets;
+    U8_T mHashes;
+    U8_T mStrOffs;
+    U8_T mEntryOffs;
+    U8_T mAbbrevs;
+    U8_T mEntries;
+} DebugNamesHeader;
+
+static ELF_Section * sIndexSection;
+static ELF_Section * sIndexInfo;
+static ELF_Section * sIndexTypes;
+static ELF_Section * sIndexStr;
+static int sIndexBigEndian;
+
+static ELF_Section * find_index_section(ELF_File * file, const char * name) {
+    unsigned idx;
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        ELF_Section * sec = file->sections + idx;
+        if (sec->size == 0) continue;
+        if (sec->name == NULL) continue;
+        if (sec->type == SHT_NOBITS) continue;
+        if (strcmp(sec->name, name) == 0) return sec;
+    }
+    return NULL;
+}
+
+static int is_gdb_index(ELF_Section * sec) {
+    return strcmp(sec->name, ".gdb_index") == 0;
+}
+
+static void enter_name_index(DWARFCache * cache, ELF_Section * sec) {
+    ELF_File * file = cache->mFile;
+    if (elf_load(sec) < 0) exception(errno);
+    sIndexSection = sec;
+    sIndexInfo = find_index_section(file, ".debug_info");
+    sIndexTypes = find_index_section(file, ".debug_types");
+    sIndexStr = find_index_section(file, ".debug_str");
+    if (sIndexStr != NULL && elf_load(sIndexStr) < 0) exception(errno);
+    /* .gdb_index is always little-endian, .debug_names has the target byte order */
+    sIndexBigEndian = !is_gdb_index(sec) && file->big_endian;
+}
+
+static U8_T read_index_value(U8_T pos, unsigned size) {
+    U1_T * p = (U1_T *)sIndexSection->data + pos;
+    U8_T v = 0;
+    unsigned i;
+    if (pos + size > sIndexSection->size || pos + size < pos) str_fmt_exception(ERR_INV_DWARF,
+        "Invalid offset in %s section", sIndexSection->name);
+    for (i = 0; i < size; i++) {
+        if (sIndexBigEndian) v = (v << 8) | p[i];
+        else v |= (U8_T)p[i] << (i * 8);
+    }
+    return v;
+}
+
+static U8_T read_index_uleb(U8_T * pos) {
+    U8_T v = 0;
+    unsigned i = 0;
+    for (;;) {
+        U1_T n = (U1_T)read_index_value((*pos)++, 1);
+        if (i < 64) v |= (U8_T)(n & 0x7fu) << i;
+        if ((n & 0x80u) == 0) break;
+        i += 7;
+    }
+    return v;
+}
+
+static int cmp_index_string(ELF_Section * sec, U8_T offs, const char * name) {
+    size_t len = strlen(name);
+    if (sec == NULL || offs >= sec->size || sec->size - offs <= len) return 0;
+    return memcmp((char *)sec->data + offs, name, len + 1) == 0;
+}
+
+static CompUnit * find_index_unit(DWARFCache * cache, ELF_Section * sec, U8_T offs) {
+    ObjectHashTable * tbl = NULL;
+    unsigned l = 0;
+    unsigned h = 0;
+    if (sec == NULL) return NULL;
+    tbl = cache->mObjectHashTable + sec->index;
+    h = tbl->mCompUnitsIndexSize;
+    while (l < h) {
+        unsigned k = (l + h) / 2;
+        CompUnit * unit = tbl->mCompUnitsIndex[k];
+        if (unit->mDesc.mUnitOffs < offs) l = k + 1;
+        else if (unit->mDesc.mUnitOffs > offs) h = k;
+        else return unit;
+    }
+    return NULL;
+}
+
+static void defer_unit_pub_names(DWARFCache * cache, CompUnit * unit) {
+    if (unit == NULL || unit->mPubNamesDeferred) return;
+    unit->mPubNamesDeferred = 1;
+    cache->mPubNamesDeferredCnt++;
+}
+
+static void load_unit_pub_names(DWARFCache * cache, CompUnit * unit) {
+    if (unit == NULL || !unit->mPubNamesDeferred) return;
+    unit->mPubNamesDeferred = 0;
+    cache->mPubNamesDeferredCnt--;
+    add_namespace(&cache->mPubNames, unit->mObject);
+}
+
+static void load_all_pub_names(DWARFCache * cache) {
+    unsigned idx;
+    for (idx = 1; idx < cache->mFile->section_cnt && cache->mPubNamesDeferredCnt > 0; idx++) {
+        ObjectInfo * unit = cache->mObjectHashTable[idx].mCompUnits;
+        while (unit != NULL) {
+            load_unit_pub_names(cache, unit->mCompUnit);
+            unit = get_dwarf_sibling(unit);
+        }
     }
+    cache->mNameIndex = NULL;
 }
 
+static int read_gdb_index_header(GdbIndexHeader * h) {
+    h->mVersion = (U4_T)read_index_value(0, 4);
+    /* Versions before 7 don't have symbol kinds and use different hash function */
+    if (h->mVersion < 7 || h->mVersion > 9) return 0;
+    h->mCUList = (U4_T)read_index_value(4, 4);
+    h->mTUList = (U4_T)read_index_value(8, 4);
+    h->mAddrArea = (U4_T)read_index_value(12, 4);
+    h->mSymbols = (U4_T)read_index_value(16, 4);
+    h->mConstPool = (U4_T)read_index_value(h->mVersion >= 9 ? 24 : 20, 4);
+    if (h->mCUList > h->mTUList || h->mTUList > h->mAddrArea || h->mAddrArea > h->mSymbols ||
+            h->mSymbols > h->mConstPool || h->mConstPool > sIndexSection->size) {
+        str_exception(ERR_INV_DWARF, "Invalid .gdb_index section header");
+    }
+    return 1;
+}
+
+static CompUnit * get_gdb_index_unit(DWARFCache * cache, GdbIndexHeader * h, U4_T n) {
+    U4_T cu_cnt = (h->mTUList - h->mCUList) / 16;
+    U4_T tu_cnt = (h->mAddrArea - h->mTUList) / 24;
+    if (n < cu_cnt) return find_index_unit(cache, sIndexInfo, read_index_value(h->mCUList + (U8_T)n * 16, 8));
+    n -= cu_cnt;
+    if (n < tu_cnt) return find_index_unit(cache, sIndexTypes, read_index_value(h->mTUList + (U8_T)n * 24, 8));
+    return NULL;
+}
+
+static U4_T calc_gdb_index_hash(const char * s) {
+    U4_T h = 0;
+    while (*s) h = h * 67 + (U4_T)tolower((unsigned char)*s++) - 113;
+    return h;
+}
+
+static void find_gdb_index_name(DWARFCache * cache, const char * name) {
+    GdbIndexHeader h;
+    U4_T size = 0;
+    U4_T hash = calc_gdb_index_hash(name);
+    U4_T step = 0;
+    U4_T i = 0;
+    U4_T n = 0;
+
+    if (!read_gdb_index_header(&h)) return;
+    size = (h.mConstPool - h.mSymbols) / 8;
+    if (size == 0 || (size & (size - 1)) != 0) str_exception(ERR_INV_DWARF, "Invalid .gdb_index symbol table size");
+    i = hash & (size - 1);
+    step = ((hash * 17) & (size - 1)) | 1;
+    for (n = 0; n < size; n++) {
+        U4_T name_offs = (U4_T)read_index_value(h.mSymbols + (U8_T)i * 8, 4);
+        U4_T vec_offs = (U4_T)read_index_value(h.mSymbols + (U8_T)i * 8 + 4, 4);
+        if (name_offs == 0 && vec_offs == 0) break;
+        if (cmp_index_string(sIndexSection, (U8_T)h.mConstPool + name_offs, name)) {
+            U8_T pos = (U8_T)h.mConstPool + vec_offs;
+            U4_T cnt = (U4_T)read_index_value(pos, 4);
+            U4_T j;
+            for (j = 0; j < cnt; j++) {
+                U4_T v = (U4_T)read_index_value(pos + 4 + (U8_T)j * 4, 4);
+                load_unit_pub_names(cache, get_gdb_index_unit(cache, &h, v & 0xffffffu));
+            }
+            break;
+        }
+        i = (i + step) & (size - 1);
+    }
+}
+
+static void read_debug_names_header(U8_T pos, DebugNamesHeader * h) {
+    U8_T size = read_index_value(pos, 4);
+    U4_T foreign_tu_cnt = 0;
+    U4_T abbrev_size = 0;
+    U4_T aug_size = 0;
+    memset(h, 0, sizeof(DebugNamesHeader));
+    h->mOffsSize = 4;
+    pos += 4;
+    if (size == 0xffffffffu) {
+        size = read_index_value(pos, 8);
+        h->mOffsSize = 8;
+        pos += 8;
+    }
+    h->mNext = pos + size;
+    if (h->mNext > sIndexSection->size || h->mNext < pos) str_exception(ERR_INV_DWARF, "Invalid .debug_names unit size");
+    h->mVersion = (U2_T)read_index_value(pos, 2);
+    if (h->mVersion != 5) return;
+    pos += 4;
+    h->mCUCnt = (U4_T)read_index_value(pos, 4);
+    h->mLocalTUCnt = (U4_T)read_index_value(pos + 4, 4);
+    foreign_tu_cnt = (U4_T)read_index_value(pos + 8, 4);
+    h->mBucketCnt = (U4_T)read_index_value(pos + 12, 4);
+    h->mNameCnt = (U4_T)read_index_value(pos + 16, 4);
+    abbrev_size = (U4_T)read_index_value(pos + 20, 4);
+    aug_size = (U4_T)read_index_value(pos + 24, 4);
+    pos += 28 + ((aug_size + 3) & ~3u);
+    h->mCUList = pos;
+    pos += (U8_T)h->mCUCnt * h->mOffsSize;
+    h->mLocalTUList = pos;
+    pos += (U8_T)h->mLocalTUCnt * h->mOffsSize;
+    pos += (U8_T)foreign_tu_cnt * 8;
+    h->mBuckets = pos;
+    pos += (U8_T)h->mBucketCnt * 4;
+    h->mHashes = pos;
+    if (h->mBucketCnt > 0) pos += (U8_T)h->mNameCnt * 4;
+    h->mStrOffs = pos;
+    pos += (U8_T)h->mNameCnt * h->mOffsSize;
+    h->mEntryOffs = pos;
+    pos += (U8_T)h->mNameCnt * h->mOffsSize;
+    h->mAbbrevs = pos;
+    pos += abbrev_size;
+    h->mEntries = pos;
+    if (pos > h->mNext) str_exception(ERR_INV_DWARF, "Invalid .debug_names section header");
+}
+
+static U8_T find_debug_names_abbrev(DebugNamesHeader * h, U8_T code) {
+    U8_T pos = h->mAbbrevs;
+    while (pos < h->mEntries) {
+        U8_T n = read_index_uleb(&pos);
+        if (n == 0) break;
+        read_index_uleb(&pos); /* Tag */
+        if (n == code) return pos;
+        for (;;) {
+            U8_T idx = read_index_uleb(&pos);
+            U8_T form = read_index_uleb(&pos);
+            if (idx == 0 && form == 0) break;
+        }
+    }
+    str_exception(ERR_INV_DWARF, "Invalid .debug_names abbreviation code");
+    return 0;
+}
+
+static U8_T read_debug_names_attr(U8_T * pos, U8_T form) {
+    unsigned size = 0;
+    U8_T v = 0;
+    switch (form) {
+    case FORM_FLAG_PRESENT:
+        return 1;
+    case FORM_UDATA:
+    case FORM_SDATA:
+    case FORM_REF_UDATA:
+        return read_index_uleb(pos);
+    case FORM_FLAG:
+    case FORM_DATA1:
+    case FORM_REF1:
+        size = 1;
+        break;
+    case FORM_DATA2:
+    case FORM_REF2:
+        size = 2;
+        break;
+    case FORM_DATA4:
+    case FORM_REF4:
+        size = 4;
+        break;
+    case FORM_DATA8:
+    case FORM_REF8:
+    case FORM_REF_SIG8:
+        size = 8;
+        break;
+    default:
+        str_exception(ERR_INV_DWARF, "Unsupported .debug_names attribute form");
+    }
+    v = read_index_value(*pos, size);
+    *pos += size;
+    return v;
+}
+
+static void load_debug_names_entries(DWARFCache * cache, DebugNamesHeader * h, U4_T n) {
+    U8_T pos = h->mEntries + read_index_value(h->mEntryOffs + (U8_T)n * h->mOffsSize, h->mOffsSize);
+    for (;;) {
+        U8_T code = read_index_uleb(&pos);
+        U8_T abbr = 0;
+        U8_T cu = 0;
+        U8_T tu = 0;
+        int has_tu = 0;
+        if (code == 0) break;
+        abbr = find_debug_names_abbrev(h, code);
+        for (;;) {
+            U8_T idx = read_index_uleb(&abbr);
+            U8_T form = read_index_uleb(&abbr);
+            U8_T v = 0;
+            if (idx == 0 && form == 0) break;
+            v = read_debug_names_attr(&pos, form);
+            if (idx == IDX_compile_unit) cu = v;
+            if (idx == IDX_type_unit) {
+                tu = v;
+                has_tu = 1;
+            }
+        }
+        if (has_tu) {
+            /* Foreign type units are in split DWARF files, not supported */
+            if (tu >= h->mLocalTUCnt) continue;
+            load_unit_pub_names(cache, find_index_unit(cache, sIndexInfo,
+                read_index_value(h->mLocalTUList + tu * h->mOffsSize, h->mOffsSize)));
+        }
+        else if (cu < h->mCUCnt) {
+            load_unit_pub_names(cache, find_index_unit(cache, sIndexInfo,
+                read_index_value(h->mCUList + cu * h->mOffsSize, h->mOffsSize)));
+        }
+    }
+}
+
+static U4_T calc_debug_names_hash(const char * s) {
+    /* DJB hash of case folded name */
+    U4_T h = 5381;
+    while (*s) h = h * 33 + (U4_T)tolower((unsigned char)*s++);
+    return h;
+}
+
+static void find_debug_names_name(DWARFCache * cache, const char * name) {
+    U4_T hash = calc_debug_names_hash(name);
+    U8_T pos = 0;
+    while (pos + 4 <= sIndexSection->size) {
+        DebugNamesHeader h;
+        read_debug_names_header(pos, &h);
+        pos = h.mNext;
+        if (h.mVersion != 5) continue;
+        if (h.mBucketCnt > 0) {
+            U4_T b = hash % h.mBucketCnt;
+            U4_T i = (U4_T)read_index_value(h.mBuckets + (U8_T)b * 4, 4);
+            while (i > 0 && i <= h.mNameCnt) {
+                U4_T x = (U4_T)read_index_value(h.mHashes + (U8_T)(i - 1) * 4, 4);
+                if (x % h.mBucketCnt != b) break;
+                if (x == hash && cmp_index_string(sIndexStr,
+                        read_index_value(h.mStrOffs + (U8_T)(i - 1) * h.mOffsSize, h.mOffsSize), name)) {
+                    load_debug_names_entries(cache, &h, i - 1);
+                }
+                i++;
+            }
+        }
+        else {
+            U4_T i;
+            for (i = 0; i < h.mNameCnt; i++) {
+                if (cmp_index_string(sIndexStr,
+                        read_index_value(h.mStrOffs + (U8_T)i * h.mOffsSize, h.mOffsSize), name)) {
+                    load_debug_names_entries(cache, &h, i);
+                }
+            }
+        }
+    }
+}
+
+static void load_name_index(void) {
+    ELF_Section * sec = find_index_section(sCache->mFile, ".debug_names");
+    if (sec == NULL) sec = find_index_section(sCache->mFile, ".gdb_index");
+    if (sec == NULL) return;
+    enter_name_index(sCache, sec);
+    if (is_gdb_index(sec)) {
+        GdbIndexHeader h;
+        U4_T n;
+        if (!read_gdb_index_header(&h)) {
+            trace(LOG_ELF, "Unsupported .gdb_index version %u", (unsigned)h.mVersion);
+            return;
+        }
+        for (n = 0; n < (h.mTUList - h.mCUList) / 16 + (h.mAddrArea - h.mTUList) / 24; n++) {
+            defer_unit_pub_names(sCache, get_gdb_index_unit(sCache, &h, n));
+        }
+    }
+    else {
+        U8_T pos = 0;
+        if (sIndexStr == NULL) return;
+        while (pos + 4 <= sec->size) {
+            DebugNamesHeader h;
+            U4_T n;
+            read_debug_names_header(pos, &h);
+            pos = h.mNext;
+            if (h.mVersion != 5) continue;
+            for (n = 0; n < h.mCUCnt; n++) {
+                defer_unit_pub_names(sCache, find_index_unit(sCache, sIndexInfo,
+                    read_index_value(h.mCUList + (U8_T)n * h.mOffsSize, h.mOffsSize)));
+            }
+            for (n = 0; n < h.mLocalTUCnt; n++) {
+                defer_unit_pub_names(sCache, find_index_unit(sCache, sIndexInfo,
+                    read_index_value(h.mLocalTUList + (U8_T)n * h.mOffsSize, h.mOffsSize)));
+            }
+        }
+    }
+    if (sCache->mPubNamesDeferredCnt > 0) sCache->mNameIndex = sec;
+}
+
+static void cancel_name_index(void) {
+    unsigned idx;
+    for (idx = 1; idx < sCache->mFile->section_cnt; idx++) {
+        ObjectInfo * unit = sCache->mObjectHashTable[idx].mCompUnits;
+        while (unit != NULL) {
+            unit->mCompUnit->mPubNamesDeferred = 0;
+            unit = get_dwarf_sibling(unit);
+        }
+    }
+    sCache->mPubNamesDeferredCnt = 0;
+    sCache->mNameIndex = NULL;
+}
+
+#if ENABLE_DwarfDiskCache
+static void use_disk_cache_name_index(void) {
+    /* Public names of units are loaded on demand using the name index of the disk cache */
+    unsigned idx;
+    for (idx = 1; idx < sCache->mFile->section_cnt; idx++) {
+        ObjectInfo * unit = sCache->mObjectHashTable[idx].mCompUnits;
+        while (unit != NULL) {
+            defer_unit_pub_names(sCache, unit->mCompUnit);
+            unit = get_dwarf_sibling(unit);
+        }
+    }
+}
+#endif
+
+static char * get_qualified_name(ObjectInfo * ns, const char * name) {
+    /* Names in .gdb_index are qualified by enclosing namespaces */
+    const char * ns_name = NULL;
+    char * prefix = NULL;
+    char * res = NULL;
+    if (ns == NULL || ns->mTag != TAG_namespace) return (char *)name;
+    ns_name = ns->mName != NULL ? ns->mName : "(anonymous namespace)";
+    prefix = get_qualified_name(get_dwarf_parent(ns), ns_name);
+    res = (char *)tmp_alloc(strlen(prefix) + strlen(name) + 3);
+    sprintf(res, "%s::%s", prefix, name);
+    return res;
+}
+
+void load_dwarf_pub_names(DWARFCache * cache, ObjectInfo * ns, const char * name) {
+    Trap trap;
+    if (cache->mPubNamesDeferredCnt == 0) return;
+    if (name == NULL) {
+        load_all_pub_names(cache);
+        return;
+    }
+    if (cache->mNameIndex == NULL) {
+#if ENABLE_DwarfDiskCache
+        dwarf_disk_cache_find_name(cache, calc_symbol_name_hash(name), load_unit_pub_names);
+#endif
+        return;
+    }
+    if (set_trap(&trap)) {
+        enter_name_index(cache, cache->mNameIndex);
+        if (is_gdb_index(cache->mNameIndex)) find_gdb_index_name(cache, get_qualified_name(ns, name));
+        else find_debug_names_name(cache, name);
+        clear_trap(&trap);
+    }
+    else {
+        trace(LOG_ELF, "Ignoring broken name index section %s: %s.",
+            cache->mNameIndex->name, errno_to_str(trap.error));
+        load_all_pub_names(cache);
+    }
+    sIndexSection = NULL;
+}
+
+#else
+
+void load_dwarf_pub_names(DWARFCache * cache, ObjectInfo * ns, const char * name) {
+}
+
+#endif /* ENABLE_DWARF_NAME_INDEX */
+
 static void allocate_obj_hash(ELF_Section * sec) {
     ObjectHashTable * HashTable = sCache->mObjectHashTable + sec->index;
     assert(HashTable->mObjectHash == NULL);
     HashTable->mObjectHashSize = (unsigned)(sec->size / 53);
     if (HashTable->mObjectHashSize < 251) HashTable->mObjectHashSize = 251;
-    HashTable->mObjectHash = (ObjectInfo **)loc_alloc_zero(sizeof(ObjectInfo *) * HashTable->mObjectHashSize);
+    HashTable->mObjectHash = (U4_T *)loc_alloc_zero(sizeof(U4_T) * HashTable->mObjectHashSize);
 }
 
 static int unit_id_comparator(const void * x1, const void * x2) {
@@ -1373,8 +2186,8 @@ static void load_debug_info_section(ELF_Section * sec) {
 
     sObjRefsCnt = 0;
     sDebugSection = sec;
-    sParentObject = NULL;
-    sPrevSibling = NULL;
+    sParentObject = 0;
+    sPrevSibling = 0;
     allocate_obj_hash(sec);
     dio_EnterSection(NULL, sec, 0);
     if (set_trap(&trap)) {
@@ -1394,8 +2207,8 @@ static void load_debug_info_section(ELF_Section * sec) {
     dio_ExitSection();
     assert(sDebugSection == sec);
     sDebugSection = NULL;
-    sParentObject = NULL;
-    sPrevSibling = NULL;
+    sParentObject = 0;
+    sPrevSibling = 0;
     sCompUnit = NULL;
     if (HashTable->mCompUnitsIndexSize > 0) {
         unsigned i = 0;
@@ -1404,7 +2217,7 @@ static void load_debug_info_section(ELF_Section * sec) {
         while (unit != NULL) {
             assert(unit->mTag == TAG_compile_unit || unit->mTag == TAG_partial_unit || unit->mTag == TAG_type_unit);
             HashTable->mCompUnitsIndex[i++] = unit->mCompUnit;
-            unit = unit->mSibling;
+            unit = get_dwarf_sibling(unit);
         }
         assert(HashTable->mCompUnitsIndexSize == i);
         qsort(HashTable->mCompUnitsIndex, HashTable->mCompUnitsIndexSize, sizeof(CompUnit *), unit_id_comparator);
@@ -1516,6 +2329,9 @@ static void load_debug_sections(void) {
     if (debug_info != NULL) {
         Trap trap;
         PubNamesTable * tbl = &sCache->mPubNames;
+#if ENABLE_DwarfDiskCache
+        int disk_cache = 0;
+#endif
         tbl->mHashSize = tbl->mMax = (unsigned)(debug_info->size / 151) + 16;
         tbl->mHash = (unsigned *)loc_alloc_zero(sizeof(unsigned) * tbl->mHashSize);
         tbl->mNext = (PubNamesInfo *)loc_alloc(sizeof(PubNamesInfo) * tbl->mMax);
@@ -1537,10 +2353,36 @@ static void load_debug_sections(void) {
             memset(tbl->mHash, 0, sizeof(unsigned) * tbl->mHashSize);
             tbl->mCnt = 1;
         }
+#if ENABLE_DWARF_NAME_INDEX
+        if (set_trap(&trap)) {
+            load_name_index();
+            clear_trap(&trap);
+        }
+        else {
+            trace(LOG_ELF, "Ignoring broken name index section: %s.", errno_to_str(errno));
+            cancel_name_index();
+        }
+        sIndexSection = NULL;
+#endif
+#if ENABLE_DwarfDiskCache
+        disk_cache = dwarf_disk_cache_open(sCache);
+#if ENABLE_DWARF_NAME_INDEX
+        if (disk_cache && sCache->mNameIndex == NULL) use_disk_cache_name_index();
+#endif
+#endif
         for (idx = 1; idx < file->section_cnt; idx++) {
             create_pub_names(idx);
         }
+#if ENABLE_DwarfDiskCache
+        if (disk_cache) {
+            dwarf_disk_cache_load_addr_ranges(sCache);
+            return;
+        }
+#endif
         load_addr_ranges(debug_info);
+#if ENABLE_DwarfDiskCache
+        dwarf_disk_cache_save(sCache);
+#endif
     }
 }
 
@@ -1558,8 +2400,8 @@ ObjectInfo * get_dwarf_children(ObjectInfo * obj) {
         U8_T end_pos = sCompUnit->mDesc.mUnitOffs + sCompUnit->mDesc.mUnitSize;
         if (obj->mSibling != NULL) end_pos = obj->mSibling->mID - sDebugSection->addr;
         dio_ReadEntry(NULL, (U2_T)0xffffu);
-        sParentObject = obj;
-        sPrevSibling = NULL;
+        sParentObject = find_object_index(sCache, sDebugSection, obj->mID);
+        sPrevSibling = 0;
         while (dio_GetPos() < end_pos) {
             if (!dio_ReadEntry(read_object_info, 0)) break;
         }
@@ -1572,8 +2414,8 @@ ObjectInfo * get_dwarf_children(ObjectInfo * obj) {
     }
     dio_ExitSection();
     sDebugSection = NULL;
-    sParentObject = NULL;
-    sPrevSibling = NULL;
+    sParentObject = 0;
+    sPrevSibling = 0;
     sCompUnit = NULL;
     if (trap.error) exception(trap.error);
     read_object_refs(obj->mCompUnit->mDesc.mSection);
@@ -1583,20 +2425,21 @@ ObjectInfo * get_dwarf_children(ObjectInfo * obj) {
 
 ObjectInfo * get_dwarf_parent(ObjectInfo * obj) {
     ObjectInfo * x;
-    if (obj->mParent != NULL) return obj->mParent;
+    if (obj->mParent != 0) return get_dwarf_link(obj, obj->mParent);
     if (obj->mTag == TAG_compile_unit) return NULL;
     if (obj->mTag == TAG_partial_unit) return NULL;
     if (obj->mTag == TAG_type_unit) return NULL;
     x = get_dwarf_children(obj->mCompUnit->mObject);
     while (x != NULL && x->mID < obj->mID) {
-        if (x->mSibling == NULL || x->mSibling->mID > obj->mID) {
+        ObjectInfo * y = get_dwarf_sibling(x);
+        if (y == NULL || y->mID > obj->mID) {
             x = get_dwarf_children(x);
         }
         else {
-            x = x->mSibling;
+            x = y;
         }
     }
-    return obj->mParent;
+    return get_dwarf_link(obj, obj->mParent);
 }
 #endif
 
@@ -1672,38 +2515,38 @@ void read_dwarf_object_property(Context * Ctx, int Frame, ObjectInfo * Obj, U2_T
         }
         else if (Obj->mTag == TAG_index_range) {
             if (Attr == AT_lower_bound) {
-                switch (Obj->u.mRange.mFmt) {
+                switch (Obj->u.mRange->mFmt) {
                 case FMT_FT_C_C:
                 case FMT_FT_C_X:
                 case FMT_UT_C_C:
                 case FMT_UT_C_X:
-                    Value->mValue = Obj->u.mRange.mLow.mValue;
+                    Value->mValue = Obj->u.mRange->mLow.mValue;
                     return;
                 case FMT_FT_X_C:
                 case FMT_FT_X_X:
                 case FMT_UT_X_C:
                 case FMT_UT_X_X:
                     Value->mForm = FORM_BLOCK2;
-                    Value->mAddr = Obj->u.mRange.mLow.mExpr.mAddr;
-                    Value->mSize = Obj->u.mRange.mLow.mExpr.mSize;
+                    Value->mAddr = Obj->u.mRange->mLow.mExpr.mAddr;
+                    Value->mSize = Obj->u.mRange->mLow.mExpr.mSize;
                     return;
                 }
             }
             if (Attr == AT_upper_bound) {
-                switch (Obj->u.mRange.mFmt) {
+                switch (Obj->u.mRange->mFmt) {
                 case FMT_FT_C_C:
                 case FMT_FT_X_C:
                 case FMT_UT_C_C:
                 case FMT_UT_X_C:
-                    Value->mValue = Obj->u.mRange.mHigh.mValue;
+                    Value->mValue = Obj->u.mRange->mHigh.mValue;
                     return;
                 case FMT_FT_C_X:
                 case FMT_FT_X_X:
                 case FMT_UT_C_X:
                 case FMT_UT_X_X:
                     Value->mForm = FORM_BLOCK2;
-                    Value->mAddr = Obj->u.mRange.mHigh.mExpr.mAddr;
-                    Value->mSize = Obj->u.mRange.mHigh.mExpr.mSize;
+                    Value->mAddr = Obj->u.mRange->mHigh.mExpr.mAddr;
+                    Value->mSize = Obj->u.mRange->mHigh.mExpr.mSize;
                     return;
                 }
             }
@@ -1817,7 +2660,7 @@ void read_dwarf_object_property(Context * Ctx, int Frame, ObjectInfo * Obj, U2_T
         if (errno) str_exception(errno, "Cannot get object run-time address");
         break;
     default:
-        if (Attr == AT_data_member_location && Obj->mTag == TAG_member && Obj->mParent->mTag == TAG_union_type) {
+        if (Attr == AT_data_member_location && Obj->mTag == TAG_member && get_dwarf_loaded_parent(Obj)->mTag == TAG_union_type) {
             Value->mForm = FORM_UDATA;
             Value->mValue = 0;
             break;
@@ -1867,7 +2710,7 @@ void read_dwarf_object_property(Context * Ctx, int Frame, ObjectInfo * Obj, U2_T
                             ok = 0;
                         }
                     }
-                    c = c->mSibling;
+                    c = get_dwarf_sibling(c);
                 }
                 if (ok) {
                     Value->mForm = FORM_UDATA;
@@ -1968,29 +2811,43 @@ static void free_unit_cache(CompUnit * Unit) {
     Unit->mStates = NULL;
     Unit->mStatesMax = 0;
     Unit->mStatesIndex = NULL;
+
+    loc_free(Unit->mFileNameHash);
+    Unit->mFileNameHash = NULL;
+    Unit->mFileNameHashCnt = 0;
+    Unit->mFileNameHashLoaded = 0;
 }
 
 static void free_dwarf_cache(ELF_File * file) {
     DWARFCache * Cache = (DWARFCache *)file->dwarf_dt_cache;
+#if ENABLE_DWARF_PREPASS
+    DWARFPrepass * prepass = find_prepass(file);
+    if (prepass != NULL) free_prepass(prepass);
+#endif
     if (Cache != NULL) {
         unsigned i;
         assert(Cache->magic == DWARF_CACHE_MAGIC);
+#if ENABLE_DwarfDiskCache
+        dwarf_disk_cache_close(Cache);
+#endif
         Cache->magic = 0;
         for (i = 0; i < file->section_cnt; i++) {
             ObjectHashTable * Table = Cache->mObjectHashTable + i;
             while (Table->mCompUnits != NULL) {
                 CompUnit * Unit = Table->mCompUnits->mCompUnit;
-                Table->mCompUnits = Table->mCompUnits->mSibling;
+                Table->mCompUnits = get_dwarf_sibling(Table->mCompUnits);
                 free_unit_cache(Unit);
                 loc_free(Unit);
             }
             loc_free(Table->mObjectHash);
             loc_free(Table->mCompUnitsIndex);
         }
-        while (Cache->mObjectList != NULL) {
-            ObjectArray * Buf = Cache->mObjectList;
-            Cache->mObjectList = Buf->mNext;
-            loc_free(Buf);
+        for (i = 0; i < Cache->mObjectChunksCnt; i++) loc_free(Cache->mObjectChunks[i]);
+        loc_free(Cache->mObjectChunks);
+        while (Cache->mIndexRanges != NULL) {
+            IndexRangeInfo * range = Cache->mIndexRanges;
+            Cache->mIndexRanges = range->mNext;
+            loc_free(range);
         }
         while (Cache->mFrameInfo != NULL) {
             FrameInfoIndex * idx = Cache->mFrameInfo;
@@ -2013,24 +2870,48 @@ DWARFCache * get_dwarf_cache(ELF_File * file) {
     DWARFCache * Cache = (DWARFCache *)file->dwarf_dt_cache;
     if (Cache == NULL) {
         Trap trap;
+#if ENABLE_DWARF_PREPASS
+        DWARFPrepass * prepass = NULL;
+#endif
         if (!sCloseListenerOK) {
             elf_add_close_listener(free_dwarf_cache);
             sCloseListenerOK = 1;
         }
+#if ENABLE_DWARF_PREPASS
+        /* Cache clients wait for the pre-pass instead of blocking the dispatch thread */
+        prepass = find_prepass(file);
+        if (cache_transaction_id() != 0) {
+            if (prepass == NULL) prepass = start_prepass(file);
+            if (prepass != NULL && prepass->mPending > 0) cache_wait(&prepass->mCache);
+        }
+        else if (prepass != NULL && prepass->mPending > 0) {
+            /* Not a cache client, load synchronously, the pre-pass is disposed when done */
+            prepass = NULL;
+        }
+#endif
         if (file->dwz_file_name != NULL) {
-            file->dwz_file = elf_open(file->dwz_file_name);
+            /* The call is repeated if the DWZ file pre-pass is pending, lock the file only once */
             if (file->dwz_file == NULL) {
-                str_exception(errno, "Cannot open DWZ file");
+                ELF_File * dwz_file = elf_open(file->dwz_file_name);
+                if (dwz_file == NULL) {
+                    str_exception(errno, "Cannot open DWZ file");
+                }
+                dwz_file->lock_cnt++;
+                file->dwz_file = dwz_file;
             }
-            file->dwz_file->lock_cnt++;
             get_dwarf_cache(file->dwz_file);
         }
         sCache = Cache = (DWARFCache *)(file->dwarf_dt_cache = loc_alloc_zero(sizeof(DWARFCache)));
         sCache->magic = DWARF_CACHE_MAGIC;
         sCache->mFile = file;
-        sCache->mObjectArrayPos = OBJECT_ARRAY_SIZE;
         sCache->mObjectHashTable = (ObjectHashTable *)loc_alloc_zero(sizeof(ObjectHashTable) * file->section_cnt);
+#if ENABLE_DWARF_PREPASS
+        sPrepass = prepass;
+#endif
         if (set_trap(&trap)) {
+#if ENABLE_DWARF_PREPASS
+            use_prepass_abbrev_table();
+#endif
             dio_LoadAbbrevTable(file);
             load_debug_sections();
             clear_trap(&trap);
@@ -2038,6 +2919,9 @@ DWARFCache * get_dwarf_cache(ELF_File * file) {
         else {
             sCache->mErrorReport = get_error_report(trap.error);
         }
+#if ENABLE_DWARF_PREPASS
+        if (prepass != NULL) free_prepass(prepass);
+#endif
         sCache = NULL;
     }
     if (Cache->mErrorReport) exception(set_error_report_errno(Cache->mErrorReport));
@@ -2383,6 +3267,93 @@ void load_line_numbers(CompUnit * Unit) {
     }
 }
 
+static int file_name_hash_comparator(const void * x1, const void * x2) {
+    unsigned h1 = *(const unsigned *)x1;
+    unsigned h2 = *(const unsigned *)x2;
+    if (h1 < h2) return -1;
+    if (h1 > h2) return +1;
+    return 0;
+}
+
+static void add_file_name_hash(CompUnit * Unit, unsigned * Max, const char * Name) {
+    if (Unit->mFileNameHashCnt >= *Max) {
+        *Max = *Max == 0 ? 16 : *Max * 2;
+        Unit->mFileNameHash = (unsigned *)loc_realloc(Unit->mFileNameHash, sizeof(unsigned) * *Max);
+    }
+    Unit->mFileNameHash[Unit->mFileNameHashCnt++] = calc_file_name_hash(Name);
+}
+
+static void load_file_name_hashes(CompUnit * Unit, ELF_Section * LineInfoSection) {
+    Trap trap;
+    unsigned max = 0;
+    add_file_name_hash(Unit, &max, Unit->mObject->mName);
+    if (Unit->mDesc.mVersion <= 1) return;
+    if (elf_load(LineInfoSection)) exception(errno);
+    dio_EnterSection(&Unit->mDesc, LineInfoSection, Unit->mLineInfoOffs);
+    if (set_trap(&trap)) {
+        U2_T version = 0;
+        U1_T opcode_base = 0;
+        int dwarf64 = 0;
+        U8_T unit_size = dio_ReadU4();
+        if (unit_size == 0xffffffffu) {
+            unit_size = dio_ReadU8();
+            dwarf64 = 1;
+        }
+        version = dio_ReadU2();
+        if (version < 2 || version > 4) str_exception(ERR_INV_DWARF, "Invalid line number info version");
+        if (dwarf64) dio_ReadU8();
+        else dio_ReadU4();
+        dio_Skip(version >= 4 ? 5 : 4);
+        opcode_base = dio_ReadU1();
+        if (opcode_base > 1) dio_Skip(opcode_base - 1);
+        /* Skip directory names */
+        while (dio_ReadString() != NULL) {}
+        /* Read source file names */
+        for (;;) {
+            char * Name = dio_ReadString();
+            if (Name == NULL) break;
+            add_file_name_hash(Unit, &max, Name);
+            dio_ReadULEB128();
+            dio_ReadULEB128();
+            dio_ReadULEB128();
+        }
+        dio_ExitSection();
+        clear_trap(&trap);
+    }
+    else {
+        dio_ExitSection();
+        loc_free(Unit->mFileNameHash);
+        Unit->mFileNameHash = NULL;
+        Unit->mFileNameHashCnt = 0;
+        exception(trap.error);
+    }
+}
+
+int has_line_file_name_hash(CompUnit * Unit, unsigned Hash) {
+    DWARFCache * Cache = (DWARFCache *)Unit->mFile->dwarf_dt_cache;
+    ELF_Section * LineInfoSection = Unit->mLineInfoSection;
+    if (LineInfoSection == NULL) LineInfoSection = Unit->mDesc.mVersion <= 1 ? Cache->mDebugLineV1 : Cache->mDebugLineV2;
+    if (LineInfoSection == NULL) return 0;
+    if (Unit->mLineInfoLoaded) {
+        /* File table is complete, including files added by DW_LNE_define_file */
+        U4_T i;
+        for (i = 0; i < Unit->mFilesCnt; i++) {
+            if (Unit->mFiles[i].mNameHash == Hash) return 1;
+        }
+        return 0;
+    }
+#if ENABLE_DwarfDiskCache
+    if (!Unit->mFileNameHashLoaded) dwarf_disk_cache_load_file_names(Cache, Unit);
+#endif
+    if (!Unit->mFileNameHashLoaded) {
+        load_file_name_hashes(Unit, LineInfoSection);
+        qsort(Unit->mFileNameHash, Unit->mFileNameHashCnt, sizeof(unsigned), file_name_hash_comparator);
+        Unit->mFileNameHashLoaded = 1;
+    }
+    return bsearch(&Hash, Unit->mFileNameHash, Unit->mFileNameHashCnt,
+        sizeof(unsigned), file_name_hash_comparator) != NULL;
+}
+
 UnitAddressRange * find_comp_unit_addr_range(DWARFCache * cache, ELF_Section * section,
                                              ContextAddress addr_min, ContextAddress addr_max) {
     unsigned l = 0;
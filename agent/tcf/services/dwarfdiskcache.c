@@ -0,0 +1,623 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Wind River Systems, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Wind River Systems - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements persistent on-disk cache of DWARF indices.
+ *
+ * A cache file contains a header, followed by arrays of fixed size records:
+ * units, address ranges, public names, and file name hashes of units.
+ * Units are stored in the order of DWARF sections and unit IDs, other records refer to units by index.
+ * Public names are stored as name hashes, sorted by hash.
+ * The file is written to a temporary file and renamed, so readers never see a partially written file.
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_DwarfDiskCache
+
+#include <assert.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tcf/framework/exceptions.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/trace.h>
+#include <tcf/services/dwarf.h>
+#include <tcf/services/dwarfdiskcache.h>
+
+#define CACHE_FILE_MAGIC    0x58444654
+#define CACHE_FILE_VERSION  2
+#define CACHE_FILE_SUFFIX   ".dwx"
+#define MAX_BUILD_ID_SIZE   64
+#define NO_FILE_NAMES       0xffffffffu
+
+typedef struct CacheFileHeader {
+    U4_T magic;
+    U4_T version;
+    U4_T header_size;
+    U4_T build_id_size;
+    U1_T build_id[MAX_BUILD_ID_SIZE];
+    I8_T mtime;
+    I8_T size;
+    U4_T section_cnt;
+    U4_T units_cnt;
+    U4_T ranges_cnt;
+    U4_T ranges_relocatable;
+    U8_T ranges_max_size;
+    U4_T names_cnt;
+    U4_T hashes_cnt;
+} CacheFileHeader;
+
+typedef struct CacheFileUnit {
+    U8_T unit_id;
+    U4_T section;
+    U4_T hashes_cnt;        /* NO_FILE_NAMES if file names of the unit are not cached */
+    U8_T hashes_pos;
+} CacheFileUnit;
+
+typedef struct CacheFileRange {
+    U8_T addr;
+    U8_T size;
+    U4_T section;
+    U4_T unit;
+} CacheFileRange;
+
+typedef struct CacheFileName {
+    U4_T hash;
+    U4_T unit;
+} CacheFileName;
+
+struct DWARFDiskCache {
+    char * file_name;
+    CacheFileHeader key;
+    void * data;
+    size_t size;
+    const CacheFileHeader * hdr;
+    const CacheFileUnit * units;
+    const CacheFileRange * ranges;
+    const CacheFileName * names;
+    const U4_T * hashes;
+    CompUnit ** unit_ptrs;
+};
+
+typedef struct NameBuffer {
+    CacheFileName * buf;
+    unsigned cnt;
+    unsigned max;
+} NameBuffer;
+
+static char * cache_dir = NULL;
+static uint64_t cache_max_size = DWARF_DISK_CACHE_MAX_SIZE;
+
+void set_dwarf_disk_cache(const char * dir, uint64_t max_size) {
+    loc_free(cache_dir);
+    cache_dir = NULL;
+    cache_max_size = max_size ? max_size : DWARF_DISK_CACHE_MAX_SIZE;
+    if (dir == NULL || *dir == 0) return;
+    if (mkdir(dir, S_IRWXU) < 0 && errno != EEXIST) {
+        trace(LOG_ALWAYS, "Cannot create DWARF cache directory %s: %s", dir, errno_to_str(errno));
+        return;
+    }
+    cache_dir = loc_strdup(dir);
+}
+
+static size_t get_build_id(ELF_File * file, U1_T * buf) {
+    unsigned idx;
+    for (idx = 1; idx < file->section_cnt; idx++) {
+        ELF_Section * sec = file->sections + idx;
+        U8_T offs = 0;
+        if (sec->size == 0) continue;
+        if (sec->type != SHT_NOTE) continue;
+        if (elf_load(sec) < 0) return 0;
+        while (offs + 12 <= sec->size) {
+            U4_T name_sz = *(U4_T *)((U1_T *)sec->data + offs);
+            U4_T desc_sz = *(U4_T *)((U1_T *)sec->data + offs + 4);
+            U4_T type = *(U4_T *)((U1_T *)sec->data + offs + 8);
+            const char * name = NULL;
+            if (file->byte_swap) {
+                SWAP(name_sz);
+                SWAP(desc_sz);
+                SWAP(type);
+            }
+            offs += 12;
+            name = (const char *)sec->data + offs;
+            offs += (name_sz + 3) & ~3u;
+            if (offs + desc_sz > sec->size) break;
+            if (type == 3 && name_sz == 4 && strcmp(name, "GNU") == 0) {
+                if (desc_sz == 0 || desc_sz > MAX_BUILD_ID_SIZE) return 0;
+                memcpy(buf, (U1_T *)sec->data + offs, desc_sz);
+                return desc_sz;
+            }
+            offs += (desc_sz + 3) & ~3u;
+        }
+    }
+    return 0;
+}
+
+static DWARFDiskCache * create_disk_cache(ELF_File * file) {
+    /* Return NULL if the file cannot be cached */
+    DWARFDiskCache * dc = NULL;
+    CacheFileHeader key;
+    char fnm[FILE_PATH_SIZE];
+    size_t pos = 0;
+    size_t i;
+
+    memset(&key, 0, sizeof(key));
+    key.build_id_size = (U4_T)get_build_id(file, key.build_id);
+    if (key.build_id_size == 0) return NULL;
+    key.magic = CACHE_FILE_MAGIC;
+    key.version = CACHE_FILE_VERSION;
+    key.header_size = sizeof(CacheFileHeader);
+    key.mtime = file->mtime;
+    key.size = file->size;
+    key.section_cnt = file->section_cnt;
+    pos = snprintf(fnm, sizeof(fnm), "%s/", cache_dir);
+    for (i = 0; i < key.build_id_size && pos + 3 < sizeof(fnm); i++) {
+        pos += snprintf(fnm + pos, sizeof(fnm) - pos, "%02x", key.build_id[i]);
+    }
+    snprintf(fnm + pos, sizeof(fnm) - pos, "%s", CACHE_FILE_SUFFIX);
+    dc = (DWARFDiskCache *)loc_alloc_zero(sizeof(DWARFDiskCache));
+    dc->file_name = loc_strdup(fnm);
+    dc->key = key;
+    return dc;
+}
+
+static int unit_record_comparator(const void * x, const void * y) {
+    const CacheFileUnit * ux = (const CacheFileUnit *)x;
+    const CacheFileUnit * uy = (const CacheFileUnit *)y;
+    if (ux->section < uy->section) return -1;
+    if (ux->section > uy->section) return +1;
+    if (ux->unit_id < uy->unit_id) return -1;
+    if (ux->unit_id > uy->unit_id) return +1;
+    return 0;
+}
+
+static int name_record_comparator(const void * x, const void * y) {
+    const CacheFileName * nx = (const CacheFileName *)x;
+    const CacheFileName * ny = (const CacheFileName *)y;
+    if (nx->hash < ny->hash) return -1;
+    if (nx->hash > ny->hash) return +1;
+    if (nx->unit < ny->unit) return -1;
+    if (nx->unit > ny->unit) return +1;
+    return 0;
+}
+
+static int find_unit_record(const CacheFileUnit * units, U4_T units_cnt, CompUnit * unit) {
+    CacheFileUnit key;
+    const CacheFileUnit * rec = NULL;
+    memset(&key, 0, sizeof(key));
+    key.unit_id = unit->mObject->mID;
+    key.section = unit->mDesc.mSection->index;
+    rec = (const CacheFileUnit *)bsearch(&key, units, units_cnt, sizeof(CacheFileUnit), unit_record_comparator);
+    if (rec == NULL) return -1;
+    return (int)(rec - units);
+}
+
+static unsigned get_units_cnt(DWARFCache * cache) {
+    unsigned cnt = 0;
+    unsigned idx;
+    for (idx = 1; idx < cache->mFile->section_cnt; idx++) {
+        cnt += cache->mObjectHashTable[idx].mCompUnitsIndexSize;
+    }
+    return cnt;
+}
+
+static int check_cache_file(DWARFDiskCache * dc, DWARFCache * cache) {
+    const CacheFileHeader * hdr = (const CacheFileHeader *)dc->data;
+    const CacheFileHeader * key = &dc->key;
+    U8_T size = sizeof(CacheFileHeader);
+    unsigned idx;
+    U4_T i = 0;
+
+    if (dc->size < sizeof(CacheFileHeader)) return 0;
+    if (hdr->magic != key->magic || hdr->version != key->version || hdr->header_size != key->header_size) return 0;
+    if (hdr->build_id_size != key->build_id_size || memcmp(hdr->build_id, key->build_id, key->build_id_size) != 0) return 0;
+    if (hdr->mtime != key->mtime || hdr->size != key->size || hdr->section_cnt != key->section_cnt) return 0;
+    size += (U8_T)hdr->units_cnt * sizeof(CacheFileUnit);
+    size += (U8_T)hdr->ranges_cnt * sizeof(CacheFileRange);
+    size += (U8_T)hdr->names_cnt * sizeof(CacheFileName);
+    size += (U8_T)hdr->hashes_cnt * sizeof(U4_T);
+    if (size != dc->size) return 0;
+
+    dc->hdr = hdr;
+    dc->units = (const CacheFileUnit *)(hdr + 1);
+    dc->ranges = (const CacheFileRange *)(dc->units + hdr->units_cnt);
+    dc->names = (const CacheFileName *)(dc->ranges + hdr->ranges_cnt);
+    dc->hashes = (const U4_T *)(dc->names + hdr->names_cnt);
+
+    /* Units must be same as units of the DWARF cache */
+    if (hdr->units_cnt != get_units_cnt(cache)) return 0;
+    dc->unit_ptrs = (CompUnit **)loc_alloc(sizeof(CompUnit *) * (hdr->units_cnt + 1));
+    for (idx = 1; idx < cache->mFile->section_cnt; idx++) {
+        ObjectHashTable * tbl = cache->mObjectHashTable + idx;
+        unsigned k;
+        for (k = 0; k < tbl->mCompUnitsIndexSize; k++) {
+            CompUnit * unit = tbl->mCompUnitsIndex[k];
+            const CacheFileUnit * rec = dc->units + i;
+            if (rec->section != idx || rec->unit_id != unit->mObject->mID) return 0;
+            if (rec->hashes_cnt != NO_FILE_NAMES && (rec->hashes_pos > hdr->hashes_cnt ||
+                    rec->hashes_cnt > hdr->hashes_cnt - rec->hashes_pos)) return 0;
+            dc->unit_ptrs[i++] = unit;
+        }
+    }
+    for (i = 0; i < hdr->ranges_cnt; i++) {
+        const CacheFileRange * r = dc->ranges + i;
+        if (r->unit >= hdr->units_cnt || r->section >= hdr->section_cnt) return 0;
+    }
+    for (i = 0; i < hdr->names_cnt; i++) {
+        const CacheFileName * n = dc->names + i;
+        if (n->unit >= hdr->units_cnt) return 0;
+        if (i > 0 && name_record_comparator(n - 1, n) >= 0) return 0;
+    }
+    return 1;
+}
+
+static void unmap_cache_file(DWARFDiskCache * dc) {
+    if (dc->data != NULL) munmap(dc->data, dc->size);
+    loc_free(dc->unit_ptrs);
+    dc->data = NULL;
+    dc->size = 0;
+    dc->hdr = NULL;
+    dc->units = NULL;
+    dc->ranges = NULL;
+    dc->names = NULL;
+    dc->hashes = NULL;
+    dc->unit_ptrs = NULL;
+}
+
+int dwarf_disk_cache_open(DWARFCache * cache) {
+    DWARFDiskCache * dc = NULL;
+    struct stat st;
+    void * data = NULL;
+    int fd = -1;
+
+    assert(cache->mDiskCache == NULL);
+    if (cache_dir == NULL) return 0;
+    dc = cache->mDiskCache = create_disk_cache(cache->mFile);
+    if (dc == NULL) return 0;
+    fd = open(dc->file_name, O_RDONLY | O_BINARY);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 || (U8_T)st.st_size != (size_t)st.st_size) {
+        close(fd);
+        return 0;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 0;
+    dc->data = data;
+    dc->size = (size_t)st.st_size;
+    if (!check_cache_file(dc, cache)) {
+        trace(LOG_ELF, "Ignoring invalid or stale DWARF cache file %s", dc->file_name);
+        unmap_cache_file(dc);
+        return 0;
+    }
+    /* Update modification time, it is used to evict least recently used files */
+    utime(dc->file_name, NULL);
+    trace(LOG_ELF, "DWARF index loaded from cache %s", dc->file_name);
+    return 1;
+}
+
+void dwarf_disk_cache_load_addr_ranges(DWARFCache * cache) {
+    DWARFDiskCache * dc = cache->mDiskCache;
+    const CacheFileHeader * hdr = dc->hdr;
+    UnitAddressRange * addr_ranges = NULL;
+    U4_T i;
+
+    assert(dc->data != NULL);
+    assert(cache->mAddrRanges == NULL);
+    if (hdr->ranges_cnt > 0) {
+        addr_ranges = (UnitAddressRange *)loc_alloc(sizeof(UnitAddressRange) * hdr->ranges_cnt);
+        for (i = 0; i < hdr->ranges_cnt; i++) {
+            const CacheFileRange * x = dc->ranges + i;
+            UnitAddressRange * y = addr_ranges + i;
+            y->mUnit = dc->unit_ptrs[x->unit];
+            y->mSection = x->section;
+            y->mAddr = (ContextAddress)x->addr;
+            y->mSize = (ContextAddress)x->size;
+        }
+    }
+    cache->mAddrRanges = addr_ranges;
+    cache->mAddrRangesCnt = cache->mAddrRangesMax = hdr->ranges_cnt;
+    cache->mAddrRangesMaxSize = (ContextAddress)hdr->ranges_max_size;
+    cache->mAddrRangesRelocatable = hdr->ranges_relocatable != 0;
+}
+
+void dwarf_disk_cache_find_name(DWARFCache * cache, unsigned hash, void (*func)(DWARFCache *, CompUnit *)) {
+    DWARFDiskCache * dc = cache->mDiskCache;
+    U4_T l = 0;
+    U4_T h = 0;
+
+    if (dc == NULL || dc->data == NULL) return;
+    h = dc->hdr->names_cnt;
+    while (l < h) {
+        U4_T k = (l + h) / 2;
+        if (dc->names[k].hash < (U4_T)hash) l = k + 1;
+        else h = k;
+    }
+    while (l < dc->hdr->names_cnt && dc->names[l].hash == (U4_T)hash) {
+        func(cache, dc->unit_ptrs[dc->names[l].unit]);
+        l++;
+    }
+}
+
+void dwarf_disk_cache_load_file_names(DWARFCache * cache, CompUnit * unit) {
+    DWARFDiskCache * dc = cache->mDiskCache;
+    const CacheFileUnit * rec = NULL;
+    int i;
+
+    if (dc == NULL || dc->data == NULL) return;
+    i = find_unit_record(dc->units, dc->hdr->units_cnt, unit);
+    if (i < 0) return;
+    rec = dc->units + i;
+    if (rec->hashes_cnt == NO_FILE_NAMES) return;
+    assert(unit->mFileNameHash == NULL);
+    unit->mFileNameHash = (unsigned *)loc_alloc(sizeof(unsigned) * (rec->hashes_cnt + 1));
+    for (i = 0; i < (int)rec->hashes_cnt; i++) unit->mFileNameHash[i] = dc->hashes[rec->hashes_pos + i];
+    unit->mFileNameHashCnt = rec->hashes_cnt;
+    unit->mFileNameHashLoaded = 1;
+}
+
+typedef struct CacheFileInfo {
+    char * name;
+    time_t mtime;
+    uint64_t size;
+} CacheFileInfo;
+
+static int cache_file_comparator(const void * x, const void * y) {
+    const CacheFileInfo * fx = (const CacheFileInfo *)x;
+    const CacheFileInfo * fy = (const CacheFileInfo *)y;
+    if (fx->mtime < fy->mtime) return -1;
+    if (fx->mtime > fy->mtime) return +1;
+    return 0;
+}
+
+static void evict_cache_files(void) {
+    DIR * dir = opendir(cache_dir);
+    CacheFileInfo * files = NULL;
+    unsigned files_cnt = 0;
+    unsigned files_max = 0;
+    uint64_t total = 0;
+    struct dirent * ent;
+    unsigned i;
+
+    if (dir == NULL) return;
+    while ((ent = readdir(dir)) != NULL) {
+        char fnm[FILE_PATH_SIZE];
+        size_t len = strlen(ent->d_name);
+        struct stat st;
+        if (len <= strlen(CACHE_FILE_SUFFIX)) continue;
+        if (strcmp(ent->d_name + len - strlen(CACHE_FILE_SUFFIX), CACHE_FILE_SUFFIX) != 0) continue;
+        snprintf(fnm, sizeof(fnm), "%s/%s", cache_dir, ent->d_name);
+        if (stat(fnm, &st) < 0 || !S_ISREG(st.st_mode)) continue;
+        if (files_cnt >= files_max) {
+            files_max = files_max == 0 ? 16 : files_max * 2;
+            files = (CacheFileInfo *)loc_realloc(files, sizeof(CacheFileInfo) * files_max);
+        }
+        files[files_cnt].name = loc_strdup(fnm);
+        files[files_cnt].mtime = st.st_mtime;
+        files[files_cnt].size = (uint64_t)st.st_size;
+        total += files[files_cnt].size;
+        files_cnt++;
+    }
+    closedir(dir);
+    if (total > cache_max_size) {
+        qsort(files, files_cnt, sizeof(CacheFileInfo), cache_file_comparator);
+        for (i = 0; i < files_cnt && total > cache_max_size; i++) {
+            if (unlink(files[i].name) < 0) continue;
+            trace(LOG_ELF, "DWARF cache file %s removed, cache size limit exceeded", files[i].name);
+            total -= files[i].size;
+        }
+    }
+    for (i = 0; i < files_cnt; i++) loc_free(files[i].name);
+    loc_free(files);
+}
+
+static int write_data(int fd, const void * buf, size_t size) {
+    const U1_T * p = (const U1_T *)buf;
+    while (size > 0) {
+        ssize_t wr = write(fd, p, size);
+        if (wr < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += wr;
+        size -= wr;
+    }
+    return 0;
+}
+
+static void add_name(NameBuffer * nb, const char * name, U4_T unit) {
+    if (nb->cnt >= nb->max) {
+        nb->max = nb->max == 0 ? 256 : nb->max * 2;
+        nb->buf = (CacheFileName *)loc_realloc(nb->buf, sizeof(CacheFileName) * nb->max);
+    }
+    nb->buf[nb->cnt].hash = calc_symbol_name_hash(name);
+    nb->buf[nb->cnt].unit = unit;
+    nb->cnt++;
+}
+
+static void add_namespace_names(NameBuffer * nb, const CacheFileUnit * units, U4_T units_cnt, U4_T unit, ObjectInfo * ns) {
+    /* Same objects as public names of the unit, see add_namespace() in dwarfcache.c.
+     * Only children that are already loaded are visited, saving the cache never reads debug info. */
+    ObjectInfo * obj = (ns->mFlags & DOIF_children_loaded) ? ns->mChildren : NULL;
+    while (obj != NULL) {
+        if (obj->mName != NULL) {
+            add_name(nb, obj->mName, unit);
+            if (obj->mDefinition != NULL && obj->mDefinition->mCompUnit != obj->mCompUnit) {
+                /* The public name is the definition, it can be in another unit */
+                int i = find_unit_record(units, units_cnt, obj->mDefinition->mCompUnit);
+                if (i >= 0) add_name(nb, obj->mName, (U4_T)i);
+            }
+        }
+        if (obj->mTag == TAG_enumeration_type || obj->mTag == TAG_namespace) {
+            add_namespace_names(nb, units, units_cnt, unit, obj);
+        }
+        obj = obj->mSibling;
+    }
+}
+
+void dwarf_disk_cache_save(DWARFCache * cache) {
+    DWARFDiskCache * dc = cache->mDiskCache;
+    char tmp[FILE_PATH_SIZE + 16];
+    CacheFileHeader hdr;
+    CacheFileUnit * units = NULL;
+    CompUnit ** unit_ptrs = NULL;
+    CacheFileRange * ranges = NULL;
+    NameBuffer names;
+    U4_T * hashes = NULL;
+    U4_T hashes_max = 0;
+    int error = 0;
+    int fd = -1;
+    unsigned idx;
+    U4_T i;
+
+    if (dc == NULL) return;
+    hdr = dc->key;
+    memset(&names, 0, sizeof(names));
+
+    /* Units, sorted by section and ID */
+    hdr.units_cnt = get_units_cnt(cache);
+    units = (CacheFileUnit *)loc_alloc_zero(sizeof(CacheFileUnit) * (hdr.units_cnt + 1));
+    unit_ptrs = (CompUnit **)loc_alloc(sizeof(CompUnit *) * (hdr.units_cnt + 1));
+    i = 0;
+    for (idx = 1; idx < cache->mFile->section_cnt; idx++) {
+        ObjectHashTable * tbl = cache->mObjectHashTable + idx;
+        unsigned k;
+        for (k = 0; k < tbl->mCompUnitsIndexSize; k++) {
+            CompUnit * unit = tbl->mCompUnitsIndex[k];
+            CacheFileUnit * rec = units + i;
+            const unsigned * src = NULL;
+            U4_T cnt = NO_FILE_NAMES;
+            rec->unit_id = unit->mObject->mID;
+            rec->section = idx;
+            if (unit->mFileNameHashLoaded) {
+                src = unit->mFileNameHash;
+                cnt = unit->mFileNameHashCnt;
+            }
+            else if (dc->data != NULL && dc->units[i].hashes_cnt != NO_FILE_NAMES) {
+                /* Keep file names that were cached before, the unit set is same */
+                src = dc->hashes + dc->units[i].hashes_pos;
+                cnt = dc->units[i].hashes_cnt;
+            }
+            rec->hashes_cnt = cnt;
+            rec->hashes_pos = hdr.hashes_cnt;
+            if (cnt != NO_FILE_NAMES) {
+                U4_T j;
+                if (hdr.hashes_cnt + cnt > hashes_max) {
+                    hashes_max = (hdr.hashes_cnt + cnt) * 2;
+                    hashes = (U4_T *)loc_realloc(hashes, sizeof(U4_T) * hashes_max);
+                }
+                for (j = 0; j < cnt; j++) hashes[hdr.hashes_cnt++] = src[j];
+            }
+            unit_ptrs[i++] = unit;
+        }
+    }
+    assert(i == hdr.units_cnt);
+
+    /* Public names */
+    for (i = 0; i < hdr.units_cnt; i++) {
+        add_namespace_names(&names, units, hdr.units_cnt, i, unit_ptrs[i]->mObject);
+        if (unit_ptrs[i]->mObject->mName != NULL) add_name(&names, unit_ptrs[i]->mObject->mName, i);
+    }
+    if (names.cnt > 1) {
+        U4_T j = 0;
+        qsort(names.buf, names.cnt, sizeof(CacheFileName), name_record_comparator);
+        for (i = 1; i < names.cnt; i++) {
+            if (name_record_comparator(names.buf + j, names.buf + i) != 0) names.buf[++j] = names.buf[i];
+        }
+        names.cnt = j + 1;
+    }
+    hdr.names_cnt = names.cnt;
+
+    /* Address ranges */
+    hdr.ranges_cnt = cache->mAddrRangesCnt;
+    hdr.ranges_relocatable = cache->mAddrRangesRelocatable;
+    hdr.ranges_max_size = cache->mAddrRangesMaxSize;
+    ranges = (CacheFileRange *)loc_alloc_zero(sizeof(CacheFileRange) * (hdr.ranges_cnt + 1));
+    for (i = 0; i < hdr.ranges_cnt; i++) {
+        UnitAddressRange * r = cache->mAddrRanges + i;
+        int n = find_unit_record(units, hdr.units_cnt, r->mUnit);
+        if (n < 0) {
+            /* Range of a unit of another file, e.g. DWZ file, cannot be cached */
+            error = ERR_OTHER;
+            break;
+        }
+        ranges[i].addr = r->mAddr;
+        ranges[i].size = r->mSize;
+        ranges[i].section = r->mSection;
+        ranges[i].unit = (U4_T)n;
+    }
+
+    if (!error) {
+        snprintf(tmp, sizeof(tmp), "%s.%d", dc->file_name, (int)getpid());
+        fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
+        if (fd < 0) error = errno;
+        if (!error && write_data(fd, &hdr, sizeof(hdr)) < 0) error = errno;
+        if (!error && write_data(fd, units, sizeof(CacheFileUnit) * hdr.units_cnt) < 0) error = errno;
+        if (!error && write_data(fd, ranges, sizeof(CacheFileRange) * hdr.ranges_cnt) < 0) error = errno;
+        if (!error && write_data(fd, names.buf, sizeof(CacheFileName) * hdr.names_cnt) < 0) error = errno;
+        if (!error && write_data(fd, hashes, sizeof(U4_T) * hdr.hashes_cnt) < 0) error = errno;
+        if (fd >= 0 && close(fd) < 0 && !error) error = errno;
+        if (!error && rename(tmp, dc->file_name) < 0) error = errno;
+        if (error) {
+            trace(LOG_ALWAYS, "Cannot write DWARF cache file %s: %s", dc->file_name, errno_to_str(error));
+            if (fd >= 0) unlink(tmp);
+        }
+        else {
+            trace(LOG_ELF, "DWARF index saved to cache %s", dc->file_name);
+            evict_cache_files();
+        }
+    }
+    loc_free(units);
+    loc_free(unit_ptrs);
+    loc_free(ranges);
+    loc_free(names.buf);
+    loc_free(hashes);
+}
+
+void dwarf_disk_cache_close(DWARFCache * cache) {
+    DWARFDiskCache * dc = cache->mDiskCache;
+    int update = 0;
+
+    if (dc == NULL) return;
+    if (!cache->mFile->mtime_changed && cache->mErrorReport == NULL) {
+        /* Update the file if line info headers of more units were read */
+        U4_T i = 0;
+        unsigned idx;
+        for (idx = 1; idx < cache->mFile->section_cnt && !update; idx++) {
+            ObjectHashTable * tbl = cache->mObjectHashTable + idx;
+            unsigned k;
+            for (k = 0; k < tbl->mCompUnitsIndexSize; k++, i++) {
+                if (!tbl->mCompUnitsIndex[k]->mFileNameHashLoaded) continue;
+                if (dc->data != NULL && dc->units[i].hashes_cnt != NO_FILE_NAMES) continue;
+                update = 1;
+                break;
+            }
+        }
+    }
+    if (update) dwarf_disk_cache_save(cache);
+    unmap_cache_file(dc);
+    loc_free(dc->file_name);
+    loc_free(dc);
+    cache->mDiskCache = NULL;
+}
+
+#endif /* ENABLE_DwarfDiskCache */
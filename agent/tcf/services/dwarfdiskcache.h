@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Wind River Systems, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Wind River Systems - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements persistent on-disk cache of DWARF indices.
+ *
+ * The cache keeps data that is expensive to compute from debug sections:
+ * the unit address ranges table, the public name to unit index, and file names of unit line number tables.
+ * Cache files are keyed by ELF build ID, and validated by the ELF file modification time and size.
+ * A cache file stays mapped into memory while the DWARF cache is in use.
+ * The cache is disabled until a cache directory is set.
+ */
+#ifndef D_dwarfdiskcache
+#define D_dwarfdiskcache
+
+#include <tcf/config.h>
+
+#if ENABLE_DwarfDiskCache
+
+#include <tcf/services/dwarfcache.h>
+
+#ifndef DWARF_DISK_CACHE_MAX_SIZE
+#  define DWARF_DISK_CACHE_MAX_SIZE (256 * 1024 * 1024)
+#endif
+
+/*
+ * Set cache directory and max total size of cache files in bytes, 0 means default size.
+ * The directory is created if it does not exist. NULL directory name disables the cache.
+ */
+extern void set_dwarf_disk_cache(const char * dir, uint64_t max_size);
+
+/*
+ * Map the cache file of a DWARF cache, compilation units of the cache must be already read.
+ * Return 1 and set cache->mDiskCache if the file exists and matches the ELF file, otherwise return 0.
+ */
+extern int dwarf_disk_cache_open(DWARFCache * cache);
+
+/*
+ * Restore the unit address ranges table from the mapped cache file.
+ */
+extern void dwarf_disk_cache_load_addr_ranges(DWARFCache * cache);
+
+/*
+ * Call 'func' for every compilation unit that has a public name with given hash, see calc_symbol_name_hash().
+ * Hash collisions can report more units than necessary, but never less.
+ */
+extern void dwarf_disk_cache_find_name(DWARFCache * cache, unsigned hash, void (*func)(DWARFCache *, CompUnit *));
+
+/*
+ * Restore sorted file name hashes of a compilation unit from the mapped cache file.
+ * If the file has them, unit->mFileNameHashLoaded is set.
+ */
+extern void dwarf_disk_cache_load_file_names(DWARFCache * cache, CompUnit * unit);
+
+/*
+ * Save indices of a DWARF cache to the disk cache. File name hashes are saved for units that have them loaded.
+ * Errors are logged and ignored.
+ */
+extern void dwarf_disk_cache_save(DWARFCache * cache);
+
+/*
+ * Unmap the cache file of a DWARF cache. If more unit file names were loaded since the file was written,
+ * the file is updated first.
+ */
+extern void dwarf_disk_cache_close(DWARFCache * cache);
+
+#endif /* ENABLE_DwarfDiskCache */
+
+#endif /* D_dwarfdiskcache */
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <tcf/framework/exceptions.h>
 #include <tcf/framework/myalloc.h>
+#include <tcf/framework/link.h>
 #include <tcf/framework/trace.h>
 #include <tcf/services/dwarf.h>
 #include <tcf/services/dwarfio.h>
@@ -105,6 +106,7 @@ typedef struct StackFrameRules {
     ELF_Section * loc_section;
     U8_T location;
     int return_address_register;
+    int no_cache;
 } StackFrameRules;
 
 static StackFrameRegisters frame_regs;
@@ -573,15 +575,30 @@ static LocationExpressionCommand * add_command(int op) {
     return cmd;
 }
 
-static void add_command_sequence(StackFrameRegisterLocation ** ptr, RegisterDefinition * reg) {
+static void set_command_sequence(StackFrameRegisterLocation ** ptr, RegisterDefinition * reg,
+                                 LocationExpressionCommand * cmds, unsigned cmds_cnt) {
     StackFrameRegisterLocation * seq = *ptr;
-    if (seq == NULL || seq->cmds_max < trace_cmds_cnt) {
-        *ptr = seq = (StackFrameRegisterLocation *)loc_realloc(seq, sizeof(StackFrameRegisterLocation) + (trace_cmds_cnt - 1) * sizeof(LocationExpressionCommand));
-        seq->cmds_max = trace_cmds_cnt;
+    if (seq == NULL || seq->cmds_max < cmds_cnt) {
+        *ptr = seq = (StackFrameRegisterLocation *)loc_realloc(seq, sizeof(StackFrameRegisterLocation) + (cmds_cnt - 1) * sizeof(LocationExpressionCommand));
+        seq->cmds_max = cmds_cnt;
     }
     seq->reg = reg;
-    seq->cmds_cnt = trace_cmds_cnt;
-    memcpy(seq->cmds, trace_cmds, trace_cmds_cnt * sizeof(LocationExpressionCommand));
+    seq->cmds_cnt = cmds_cnt;
+    memcpy(seq->cmds, cmds, cmds_cnt * sizeof(LocationExpressionCommand));
+}
+
+static void add_command_sequence(StackFrameRegisterLocation ** ptr, RegisterDefinition * reg) {
+    set_command_sequence(ptr, reg, trace_cmds, trace_cmds_cnt);
+}
+
+static void reserve_trace_regs(int cnt) {
+    if (cnt > trace_regs_max) {
+        int i;
+        int max = trace_regs_max;
+        while (trace_regs_max < cnt) trace_regs_max += 16;
+        dwarf_stack_trace_regs = (StackFrameRegisterLocation **)loc_realloc(dwarf_stack_trace_regs, trace_regs_max * sizeof(StackFrameRegisterLocation *));
+        for (i = max; i < trace_regs_max; i++) dwarf_stack_trace_regs[i] = NULL;
+    }
 }
 
 static void add_dwarf_expression_commands(U8_T cmds_offs, U4_T cmds_size) {
@@ -598,6 +615,8 @@ static void add_dwarf_expression_commands(U8_T cmds_offs, U4_T cmds_size) {
                     rules.ctx, rules.section->file, section, (ContextAddress)lt_addr);
                 if (errno) str_exception(errno, "Cannot get object run-time address");
                 add_command(SFT_CMD_NUMBER)->args.num = rt_addr;
+                /* Run-time address depends on the memory map, don't cache the commands */
+                rules.no_cache = 1;
             }
             break;
         case OP_deref:
@@ -872,12 +891,7 @@ static void generate_register_commands(RegisterRules * reg, RegisterDefinition *
         add_command(SFT_CMD_NUMBER)->args.num = 0xfffffffe;
         add_command(SFT_CMD_AND);
     }
-    if (dwarf_stack_trace_regs_cnt >= trace_regs_max) {
-        int i;
-        trace_regs_max += 16;
-        dwarf_stack_trace_regs = (StackFrameRegisterLocation **)loc_realloc(dwarf_stack_trace_regs, trace_regs_max * sizeof(StackFrameRegisterLocation *));
-        for (i = dwarf_stack_trace_regs_cnt; i < trace_regs_max; i++) dwarf_stack_trace_regs[i] = NULL;
-    }
+    reserve_trace_regs(dwarf_stack_trace_regs_cnt + 1);
     if (trace_cmds_cnt == 0) return;
     add_command_sequence(dwarf_stack_trace_regs + dwarf_stack_trace_regs_cnt++, dst_reg_def);
 }
@@ -1178,6 +1192,176 @@ static void read_frame_fde(U8_T IP, U8_T fde_pos) {
     dio_ExitSection();
 }
 
+#if DWARF_FRAME_CACHE_SIZE > 0
+
+#define FRAME_CACHE_HASH_SIZE 511
+
+typedef struct FrameCacheRow {
+    struct FrameCacheRow * next;
+    U8_T addr;
+    U8_T size;
+    int regs_cnt;
+    /* Commands to calculate frame address, followed by register commands */
+    StackFrameRegisterLocation * seqs[1];
+} FrameCacheRow;
+
+typedef struct FrameCacheEntry {
+    LINK link_lru;
+    struct FrameCacheEntry * next;
+    ELF_Section * section;
+    U8_T fde_pos;
+    Context * mem;
+    RegisterDefinition * reg_defs;
+    FrameCacheRow * rows;
+    unsigned rows_cnt;
+} FrameCacheEntry;
+
+#define lru2entry(A) ((FrameCacheEntry *)((char *)(A) - offsetof(FrameCacheEntry, link_lru)))
+
+static FrameCacheEntry * frame_cache_hash[FRAME_CACHE_HASH_SIZE];
+static LINK frame_cache_lru = TCF_LIST_INIT(frame_cache_lru);
+static unsigned frame_cache_rows_cnt = 0;
+
+static unsigned frame_cache_hash_index(ELF_Section * section, U8_T fde_pos) {
+    return (unsigned)(((uintptr_t)section >> 4) + fde_pos) % FRAME_CACHE_HASH_SIZE;
+}
+
+static void free_frame_cache_entry(FrameCacheEntry * e) {
+    FrameCacheEntry ** p = frame_cache_hash + frame_cache_hash_index(e->section, e->fde_pos);
+    while (*p != e) p = &(*p)->next;
+    *p = e->next;
+    list_remove(&e->link_lru);
+    while (e->rows != NULL) {
+        int i;
+        FrameCacheRow * r = e->rows;
+        e->rows = r->next;
+        for (i = 0; i <= r->regs_cnt; i++) loc_free(r->seqs[i]);
+        loc_free(r);
+    }
+    frame_cache_rows_cnt -= e->rows_cnt;
+    loc_free(e);
+}
+
+static void flush_frame_cache(ELF_File * file, Context * mem) {
+    LINK * l = frame_cache_lru.next;
+    while (l != &frame_cache_lru) {
+        FrameCacheEntry * e = lru2entry(l);
+        l = l->next;
+        if (e->section->file == file || e->mem == mem) free_frame_cache_entry(e);
+    }
+}
+
+static void frame_cache_elf_closed(ELF_File * file) {
+    flush_frame_cache(file, NULL);
+}
+
+static void frame_cache_context_disposed(Context * ctx, void * args) {
+    flush_frame_cache(NULL, ctx);
+}
+
+static FrameCacheEntry * find_frame_cache_entry(U8_T fde_pos, int add) {
+    static int inited = 0;
+    FrameCacheEntry * e = NULL;
+    unsigned h = frame_cache_hash_index(rules.section, fde_pos);
+    Context * mem = context_get_group(rules.ctx, CONTEXT_GROUP_PROCESS);
+    RegisterDefinition * reg_defs = get_reg_definitions(rules.ctx);
+
+    for (e = frame_cache_hash[h]; e != NULL; e = e->next) {
+        if (e->section != rules.section) continue;
+        if (e->fde_pos != fde_pos) continue;
+        if (e->mem != mem) continue;
+        if (e->reg_defs != reg_defs) continue;
+        list_remove(&e->link_lru);
+        list_add_first(&e->link_lru, &frame_cache_lru);
+        return e;
+    }
+    if (!add) return NULL;
+    if (!inited) {
+        static ContextEventListener listener = {
+            NULL,
+            NULL,
+            NULL,
+            NULL,
+            NULL,
+            frame_cache_context_disposed
+        };
+        add_context_event_listener(&listener, NULL);
+        elf_add_close_listener(frame_cache_elf_closed);
+        inited = 1;
+    }
+    e = (FrameCacheEntry *)loc_alloc_zero(sizeof(FrameCacheEntry));
+    e->section = rules.section;
+    e->fde_pos = fde_pos;
+    e->mem = mem;
+    e->reg_defs = reg_defs;
+    e->next = frame_cache_hash[h];
+    frame_cache_hash[h] = e;
+    list_add_first(&e->link_lru, &frame_cache_lru);
+    return e;
+}
+
+static int get_cached_frame_rules(U8_T IP, U8_T fde_pos) {
+    int i;
+    FrameCacheRow * r = NULL;
+    FrameCacheEntry * e = find_frame_cache_entry(fde_pos, 0);
+
+    if (e == NULL) return 0;
+    for (r = e->rows; r != NULL; r = r->next) {
+        if (IP >= r->addr && IP - r->addr < r->size) break;
+    }
+    if (r == NULL) return 0;
+    set_command_sequence(&dwarf_stack_trace_fp, NULL, r->seqs[0]->cmds, r->seqs[0]->cmds_cnt);
+    reserve_trace_regs(r->regs_cnt);
+    for (i = 0; i < r->regs_cnt; i++) {
+        StackFrameRegisterLocation * seq = r->seqs[i + 1];
+        set_command_sequence(dwarf_stack_trace_regs + i, seq->reg, seq->cmds, seq->cmds_cnt);
+    }
+    dwarf_stack_trace_regs_cnt = r->regs_cnt;
+    dwarf_stack_trace_addr = r->addr;
+    dwarf_stack_trace_size = r->size;
+    return 1;
+}
+
+static void add_cached_frame_rules(U8_T fde_pos) {
+    int i;
+    FrameCacheRow * r = NULL;
+    FrameCacheEntry * e = NULL;
+
+    if (rules.no_cache) return;
+    if (dwarf_stack_trace_fp->cmds_cnt == 0 || dwarf_stack_trace_size == 0) return;
+    e = find_frame_cache_entry(fde_pos, 1);
+    r = (FrameCacheRow *)loc_alloc_zero(sizeof(FrameCacheRow) + dwarf_stack_trace_regs_cnt * sizeof(StackFrameRegisterLocation *));
+    r->addr = dwarf_stack_trace_addr;
+    r->size = dwarf_stack_trace_size;
+    r->regs_cnt = dwarf_stack_trace_regs_cnt;
+    set_command_sequence(r->seqs, NULL, dwarf_stack_trace_fp->cmds, dwarf_stack_trace_fp->cmds_cnt);
+    for (i = 0; i < r->regs_cnt; i++) {
+        StackFrameRegisterLocation * seq = dwarf_stack_trace_regs[i];
+        set_command_sequence(r->seqs + i + 1, seq->reg, seq->cmds, seq->cmds_cnt);
+    }
+    r->next = e->rows;
+    e->rows = r;
+    e->rows_cnt++;
+    frame_cache_rows_cnt++;
+    while (frame_cache_rows_cnt > DWARF_FRAME_CACHE_SIZE) {
+        FrameCacheEntry * x = lru2entry(frame_cache_lru.prev);
+        if (x == e) break;
+        free_frame_cache_entry(x);
+    }
+}
+
+#endif /* DWARF_FRAME_CACHE_SIZE > 0 */
+
+static void read_frame_fde_rules(U8_T IP, U8_T fde_pos) {
+#if DWARF_FRAME_CACHE_SIZE > 0
+    if (get_cached_frame_rules(IP, fde_pos)) return;
+    read_frame_fde(IP, fde_pos);
+    add_cached_frame_rules(fde_pos);
+#else
+    read_frame_fde(IP, fde_pos);
+#endif
+}
+
 static int cmp_frame_info_ranges(const void * x, const void * y) {
     FrameInfoRange * rx = (FrameInfoRange *)x;
     FrameInfoRange * ry = (FrameInfoRange *)y;
@@ -1302,14 +1486,14 @@ static void read_frame_info_section(Context * ctx, ELF_Section * text_section,
             h = k;
         }
         else if (range->mAddr + range->mSize < range->mAddr) {
-            read_frame_fde(IP, range->mOffset);
+            read_frame_fde_rules(IP, range->mOffset);
             return;
         }
         else if (range->mAddr + range->mSize <= IP) {
             l = k + 1;
         }
         else {
-            read_frame_fde(IP, range->mOffset);
+            read_frame_fde_rules(IP, range->mOffset);
             return;
         }
     }
@@ -29,6 +29,11 @@
 #include <tcf/services/dwarfcache.h>
 #include <tcf/services/symbols.h>
 
+#ifndef DWARF_FRAME_CACHE_SIZE
+/* Max number of frame info table rows kept in the cache of generated stack tracing commands, 0 disables the cache */
+#  define DWARF_FRAME_CACHE_SIZE 4096
+#endif
+
 /*
  * Lookup stack tracing information in ELF file, in .debug_frame and .eh_frame sections.
  *
@@ -40,6 +45,9 @@
  * In case of error reading frame data, the function throws an exception.
  *
  * 'ip' is link-time instruction address.
+ *
+ * Generated commands are cached per FDE and frame info table row, so repeated lookups
+ * of same code don't re-run CFA instructions, see DWARF_FRAME_CACHE_SIZE.
  */
 extern void get_dwarf_stack_frame_info(Context * ctx, ELF_File * file, ELF_Section * sec, U8_T ip);
 
@@ -78,25 +78,10 @@ static U8_T sDataLen;
 static DIO_UnitDescriptor * sUnit;
 
 static void dio_CloseELF(ELF_File * File) {
-    U4_T n, m;
     DIO_Cache * Cache = (DIO_Cache *)File->dwarf_io_cache;
 
     if (Cache == NULL) return;
-    if (Cache->mAbbrevTable != NULL) {
-        for (n = 0; n < ABBREV_TABLE_SIZE; n++) {
-            DIO_AbbrevSet * Set = Cache->mAbbrevTable[n];
-            while (Set != NULL) {
-                DIO_AbbrevSet * Next = Set->mNext;
-                for (m = 0; m < Set->mSize; m++) {
-                    loc_free(Set->mTable[m]);
-                }
-                loc_free(Set->mTable);
-                loc_free(Set);
-                Set = Next;
-            }
-        }
-        loc_free(Cache->mAbbrevTable);
-    }
+    if (Cache->mAbbrevTable != NULL) dio_FreeAbbrevTable(Cache->mAbbrevTable);
     loc_free(Cache);
     File->dwarf_io_cache = NULL;
 }
@@ -659,36 +644,43 @@ void dio_ReadUnit(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack) {
 
 #define dio_AbbrevTableHash(Offset) (((unsigned)(Offset)) / 16 % ABBREV_TABLE_SIZE)
 
-void dio_LoadAbbrevTable(ELF_File * File) {
-    U4_T ID;
+static int dio_ReadAbbrevULEB128(U1_T * Data, U8_T Size, U8_T * Pos, U4_T * Res) {
+    U4_T Val = 0;
+    int i = 0;
+    for (;; i += 7) {
+        U1_T n = 0;
+        if (*Pos >= Size) return -1;
+        n = Data[(*Pos)++];
+        if (i < 32) Val |= (U4_T)(n & 0x7Fu) << i;
+        if ((n & 0x80) == 0) break;
+    }
+    *Res = Val;
+    return 0;
+}
+
+DIO_AbbrevSet ** dio_ParseAbbrevTable(ELF_Section * Section) {
+    /* Does not use the reader state and does not throw exceptions, so it can run on a worker thread */
+    U1_T * Data = (U1_T *)Section->data;
+    U8_T Size = Section->data != NULL ? Section->size : 0;
+    U8_T Pos = 0;
     U8_T TableOffset = 0;
-    ELF_Section * Section = NULL;
-    static U2_T * AttrBuf = NULL;
-    static U4_T AttrBufSize = 0;
-    static DIO_Abbreviation ** AbbrevBuf = NULL;
-    static U4_T AbbrevBufSize = 0;
+    U2_T * AttrBuf = NULL;
+    U4_T AttrBufSize = 0;
+    DIO_Abbreviation ** AbbrevBuf = NULL;
+    U4_T AbbrevBufSize = 0;
     U4_T AbbrevBufPos = 0;
-    DIO_Cache * Cache = dio_GetCache(File);
-
-    if (Cache->mAbbrevTable != NULL) return;
-    Cache->mAbbrevTable = (DIO_AbbrevSet **)loc_alloc_zero(sizeof(DIO_AbbrevSet *) * ABBREV_TABLE_SIZE);
+    int Error = 0;
+    DIO_AbbrevSet ** Table = (DIO_AbbrevSet **)loc_alloc_zero(sizeof(DIO_AbbrevSet *) * ABBREV_TABLE_SIZE);
 
-    for (ID = 1; ID < File->section_cnt; ID++) {
-        if (strcmp(File->sections[ID].name, ".debug_abbrev") == 0) {
-            if (Section != NULL) {
-                str_exception(ERR_INV_DWARF, "More then one .debug_abbrev section in a file");
-            }
-            Section = File->sections + ID;
-        }
-    }
-    if (Section == NULL) return;
-    Cache->mAbbrevSectionAddr = Section->addr;
-    dio_EnterSection(NULL, Section, 0);
-    for (;;) {
+    while (Pos < Size && !Error) {
         U4_T AttrPos = 0;
-        U2_T Tag = 0;
+        U4_T Tag = 0;
         U1_T Children = 0;
-        U4_T ID = dio_ReadULEB128();
+        U4_T ID = 0;
+        if (dio_ReadAbbrevULEB128(Data, Size, &Pos, &ID) < 0) {
+            Error = 1;
+            break;
+        }
         if (ID == 0) {
             /* End of compilation unit */
             U4_T Hash = dio_AbbrevTableHash(TableOffset);
@@ -696,42 +688,51 @@ void dio_LoadAbbrevTable(ELF_File * File) {
             AbbrevSet->mOffset = TableOffset;
             AbbrevSet->mTable = (DIO_Abbreviation **)loc_alloc(sizeof(DIO_Abbreviation *) * AbbrevBufPos);
             AbbrevSet->mSize = AbbrevBufPos;
-            AbbrevSet->mNext = Cache->mAbbrevTable[Hash];
-            Cache->mAbbrevTable[Hash] = AbbrevSet;
-            memcpy(AbbrevSet->mTable, AbbrevBuf, sizeof(DIO_Abbreviation *) * AbbrevBufPos);
-            memset(AbbrevBuf, 0, sizeof(DIO_Abbreviation *) * AbbrevBufPos);
+            AbbrevSet->mNext = Table[Hash];
+            Table[Hash] = AbbrevSet;
+            if (AbbrevBufPos > 0) {
+                memcpy(AbbrevSet->mTable, AbbrevBuf, sizeof(DIO_Abbreviation *) * AbbrevBufPos);
+                memset(AbbrevBuf, 0, sizeof(DIO_Abbreviation *) * AbbrevBufPos);
+            }
             AbbrevBufPos = 0;
-            if (sDataPos >= Section->size) break;
-            TableOffset = sDataPos;
+            TableOffset = Pos;
             continue;
         }
-        if (ID >= 0x1000000) str_exception(ERR_INV_DWARF, "Invalid abbreviation table");
+        if (ID >= 0x1000000) {
+            Error = 1;
+            break;
+        }
         if (ID >= AbbrevBufPos) {
-            U4_T Pos = AbbrevBufPos;
             AbbrevBufPos = ID + 1;
             if (AbbrevBufPos > AbbrevBufSize) {
-                U4_T Size = AbbrevBufSize;
+                U4_T BufSize = AbbrevBufSize;
                 AbbrevBufSize = AbbrevBufPos + 128;
                 AbbrevBuf = (DIO_Abbreviation **)loc_realloc(AbbrevBuf, sizeof(DIO_Abbreviation *) * AbbrevBufSize);
-                memset(AbbrevBuf + Size, 0, sizeof(DIO_Abbreviation *) * (AbbrevBufSize - Size));
-            }
-            while (Pos < AbbrevBufPos) {
-                loc_free(AbbrevBuf[Pos]);
-                AbbrevBuf[Pos] = NULL;
-                Pos++;
+                memset(AbbrevBuf + BufSize, 0, sizeof(DIO_Abbreviation *) * (AbbrevBufSize - BufSize));
             }
         }
-        Tag = (U2_T)dio_ReadULEB128();
-        Children = (U2_T)dio_ReadU1() != 0;
+        if (dio_ReadAbbrevULEB128(Data, Size, &Pos, &Tag) < 0 || Pos >= Size) {
+            Error = 1;
+            break;
+        }
+        Children = Data[Pos++] != 0;
         for (;;) {
-            U4_T Attr = dio_ReadULEB128();
-            U4_T Form = dio_ReadULEB128();
-            if (Attr >= 0x10000 || Form >= 0x10000) str_exception(ERR_INV_DWARF, "Invalid abbreviation table");
+            U4_T Attr = 0;
+            U4_T Form = 0;
+            if (dio_ReadAbbrevULEB128(Data, Size, &Pos, &Attr) < 0 ||
+                    dio_ReadAbbrevULEB128(Data, Size, &Pos, &Form) < 0 ||
+                    Attr >= 0x10000 || Form >= 0x10000) {
+                Error = 1;
+                break;
+            }
             if (Attr == 0 && Form == 0) {
                 DIO_Abbreviation * Abbr;
-                if (AbbrevBuf[ID] != NULL) str_exception(ERR_INV_DWARF, "Invalid abbreviation table");
+                if (AbbrevBuf[ID] != NULL) {
+                    Error = 1;
+                    break;
+                }
                 Abbr = (DIO_Abbreviation *)loc_alloc_zero(sizeof(DIO_Abbreviation) - sizeof(U2_T) * 2 + sizeof(U2_T) * AttrPos);
-                Abbr->mTag = Tag;
+                Abbr->mTag = (U2_T)Tag;
                 Abbr->mChildren = Children;
                 Abbr->mAttrLen = AttrPos;
                 memcpy(Abbr->mAttrs, AttrBuf, sizeof(U2_T) * AttrPos);
@@ -746,8 +747,71 @@ void dio_LoadAbbrevTable(ELF_File * File) {
             AttrBuf[AttrPos++] = (U2_T)Form;
         }
     }
-    assert(AbbrevBufPos == 0);
-    dio_ExitSection();
+    /* Section must end with a complete abbreviation set */
+    if (AbbrevBufPos > 0) Error = 1;
+    if (Error) {
+        U4_T n;
+        for (n = 0; n < AbbrevBufPos; n++) loc_free(AbbrevBuf[n]);
+        dio_FreeAbbrevTable(Table);
+        Table = NULL;
+    }
+    loc_free(AbbrevBuf);
+    loc_free(AttrBuf);
+    return Table;
+}
+
+void dio_FreeAbbrevTable(DIO_AbbrevSet ** Table) {
+    U4_T n, m;
+    for (n = 0; n < ABBREV_TABLE_SIZE; n++) {
+        DIO_AbbrevSet * Set = Table[n];
+        while (Set != NULL) {
+            DIO_AbbrevSet * Next = Set->mNext;
+            for (m = 0; m < Set->mSize; m++) {
+                loc_free(Set->mTable[m]);
+            }
+            loc_free(Set->mTable);
+            loc_free(Set);
+            Set = Next;
+        }
+    }
+    loc_free(Table);
+}
+
+void dio_SetAbbrevTable(ELF_File * File, ELF_Section * Section, DIO_AbbrevSet ** Table) {
+    DIO_Cache * Cache = dio_GetCache(File);
+
+    if (Cache->mAbbrevTable != NULL) {
+        dio_FreeAbbrevTable(Table);
+        return;
+    }
+    Cache->mAbbrevTable = Table;
+    if (Section != NULL) Cache->mAbbrevSectionAddr = Section->addr;
+}
+
+void dio_LoadAbbrevTable(ELF_File * File) {
+    U4_T ID;
+    ELF_Section * Section = NULL;
+    DIO_AbbrevSet ** Table = NULL;
+    DIO_Cache * Cache = dio_GetCache(File);
+
+    if (Cache->mAbbrevTable != NULL) return;
+
+    for (ID = 1; ID < File->section_cnt; ID++) {
+        if (strcmp(File->sections[ID].name, ".debug_abbrev") == 0) {
+            if (Section != NULL) {
+                str_exception(ERR_INV_DWARF, "More then one .debug_abbrev section in a file");
+            }
+            Section = File->sections + ID;
+        }
+    }
+    if (Section == NULL) {
+        Cache->mAbbrevTable = (DIO_AbbrevSet **)loc_alloc_zero(sizeof(DIO_AbbrevSet *) * ABBREV_TABLE_SIZE);
+        return;
+    }
+    if (elf_load(Section) < 0) exception(errno);
+    Table = dio_ParseAbbrevTable(Section);
+    if (Table == NULL) str_exception(ERR_INV_DWARF, "Invalid abbreviation table");
+    dio_SetAbbrevTable(File, Section, Table);
 }
 
 static void dio_FindAbbrevTable(void) {
@@ -95,6 +95,19 @@ extern int dio_ReadEntry(DIO_EntryCallBack CallBack, U2_T Attr);
 
 extern void dio_LoadAbbrevTable(ELF_File * File);
 
+struct DIO_AbbrevSet;
+
+/*
+ * Parse loaded .debug_abbrev section into a new abbreviation table.
+ * The function is reentrant and can be called by a worker thread.
+ * Return NULL if the section data is invalid.
+ */
+extern struct DIO_AbbrevSet ** dio_ParseAbbrevTable(ELF_Section * Section);
+extern void dio_FreeAbbrevTable(struct DIO_AbbrevSet ** Table);
+
+/* Set abbreviation table of a file, the table is disposed if the file already has one */
+extern void dio_SetAbbrevTable(ELF_File * File, ELF_Section * Section, struct DIO_AbbrevSet ** Table);
+
 extern void dio_ChkFlag(U2_T Form);
 extern void dio_ChkRef(U2_T Form);
 extern void dio_ChkAddr(U2_T Form);
@@ -49,6 +49,8 @@
 #include <tcf/services/memoryservice.h>
 #include <tcf/services/breakpoints.h>
 #include <tcf/services/registers.h>
+#include <tcf/services/memorymap.h>
+#include <tcf/services/pathmap.h>
 #include <tcf/services/expressions.h>
 #include <tcf/main/test.h>
 
@@ -167,6 +169,64 @@ static ExpressionIdentifierCallBack ** id_callbacks = NULL;
 static int id_callback_max = 0;
 static int id_callback_cnt = 0;
 
+#ifndef COMPILED_EXPRESSION_SCOPES
+#  define COMPILED_EXPRESSION_SCOPES 4
+#endif
+
+/* Cached result of find_symbol_by_name() */
+typedef struct CompiledSymbol {
+    char * name;
+    char * id;              /* First symbol ID, NULL if the name is not found */
+    int unique;             /* 1 if the name is resolved to a single symbol */
+} CompiledSymbol;
+
+typedef struct CompiledScope {
+    Context * ctx;
+    int frame;
+    uint64_t pc;
+    unsigned generation;
+    CompiledSymbol * syms;
+    unsigned syms_cnt;
+    unsigned syms_max;
+} CompiledScope;
+
+#ifndef COMPILED_EXPRESSION_STACK
+#  define COMPILED_EXPRESSION_STACK 16
+#endif
+
+/* Operation codes of compiled expression program */
+#define CP_CONST    1       /* Push numeric literal */
+#define CP_NAME     2       /* Push value of an identifier */
+#define CP_UNARY    3       /* Apply unary operator to top of the stack */
+#define CP_BINARY   4       /* Apply binary operator to two values on top of the stack */
+#define CP_AND      5       /* Jump if top of the stack is false */
+#define CP_OR       6       /* Jump if top of the stack is true */
+
+typedef struct CompiledOp {
+    int code;
+    int sy;                 /* Operator token */
+    int pos;                /* Text position where the parser would do the operation, for error messages */
+    unsigned jump;          /* CP_AND, CP_OR: index of the operation after right operand */
+    Value val;              /* CP_CONST: literal value, the value buffer is owned by the program */
+    int val_flags;          /* CP_CONST: literal suffix flags */
+    char * name;            /* CP_NAME: identifier */
+} CompiledOp;
+
+struct CompiledExpression {
+    char * text;
+    CompiledOp * prog;      /* Postfix program, NULL if the expression is evaluated by the parser */
+    unsigned prog_cnt;
+    unsigned prog_max;
+    CompiledScope scopes[COMPILED_EXPRESSION_SCOPES];
+    unsigned scope_pos;
+};
+
+/* Scope of compiled expression being evaluated, NULL if not compiled */
+static CompiledScope * expression_scope = NULL;
+
+/* Incremented when resolved symbols can become invalid */
+static unsigned compiled_generation = 1;
+
 static void ini_value(Value * v) {
     memset(v, 0, sizeof(Value));
     v->ctx = expression_context;
@@ -1171,6 +1231,38 @@ static unsigned flag_count(SYM_FLAGS flags) {
 }
 #endif /* ENABLE_Symbols */
 
+#if ENABLE_Symbols
+static CompiledSymbol * find_compiled_symbol(const char * name) {
+    unsigned i;
+    if (expression_scope == NULL) return NULL;
+    for (i = 0; i < expression_scope->syms_cnt; i++) {
+        CompiledSymbol * cs = expression_scope->syms + i;
+        if (strcmp(cs->name, name) == 0) return cs;
+    }
+    return NULL;
+}
+
+static void add_compiled_symbol(const char * name, Symbol * sym, int unique) {
+    CompiledSymbol * cs = NULL;
+    if (expression_scope == NULL) return;
+    cs = find_compiled_symbol(name);
+    if (cs == NULL) {
+        if (expression_scope->syms_cnt >= expression_scope->syms_max) {
+            expression_scope->syms_max += 8;
+            expression_scope->syms = (CompiledSymbol *)loc_realloc(expression_scope->syms,
+                sizeof(CompiledSymbol) * expression_scope->syms_max);
+        }
+        cs = expression_scope->syms + expression_scope->syms_cnt++;
+        cs->name = loc_strdup(name);
+    }
+    else {
+        loc_free(cs->id);
+    }
+    cs->id = sym != NULL ? loc_strdup(symbol2id(sym)) : NULL;
+    cs->unique = unique;
+}
+#endif
+
 static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Value * v) {
     ini_value(v);
     if (scope == NULL) {
@@ -1209,9 +1301,18 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
 #if ENABLE_Symbols
     {
         Symbol * sym = NULL;
+        CompiledSymbol * cs = NULL;
         int n = 0;
 
-        if (scope != NULL) {
+        if (scope == NULL) cs = find_compiled_symbol(name);
+        if (cs != NULL && cs->id == NULL) {
+            n = -1;
+            errno = ERR_SYM_NOT_FOUND;
+        }
+        else if (cs != NULL && cs->unique && id2symbol(cs->id, &sym) >= 0) {
+            return sym2value(mode, sym, v);
+        }
+        else if (scope != NULL) {
             int scope_class = 0;
             Symbol * scope_sym = scope->sym;
             if (scope->type != NULL) {
@@ -1230,6 +1331,7 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
 
         if (n < 0) {
             if (get_error_code(errno) != ERR_SYM_NOT_FOUND) error(errno, "Cannot read symbol data");
+            if (scope == NULL) add_compiled_symbol(name, NULL, 0);
         }
         else {
             unsigned cnt = 0;
@@ -1264,6 +1366,7 @@ static int identifier(int mode, Value * scope, char * name, SYM_FLAGS flags, Val
                 sym_flags = nxt_flags;
                 sym = list[i];
             }
+            if (scope == NULL) add_compiled_symbol(name, list[0], cnt == 1);
             sym_class = sym2value(mode, sym, v);
             if (cnt > 1) v->sym_list = list;
             return sym_class;
@@ -1961,9 +2064,17 @@ static int get_std_type(const char * name, int type_class, Symbol ** type, size_
     Symbol * sym = NULL;
     int sym_class = 0;
     ContextAddress sym_size = 0;
-    if (find_symbol_by_name(expression_context,
-        expression_frame, expression_addr, name, &sym) < 0) return 0;
-    if (sym == NULL) return 0;
+    CompiledSymbol * cs = find_compiled_symbol(name);
+    if (cs != NULL && cs->id == NULL) return 0;
+    if (cs == NULL || id2symbol(cs->id, &sym) < 0) {
+        if (find_symbol_by_name(expression_context,
+            expression_frame, expression_addr, name, &sym) < 0) {
+            if (get_error_code(errno) == ERR_SYM_NOT_FOUND) add_compiled_symbol(name, NULL, 0);
+            return 0;
+        }
+        if (sym == NULL) return 0;
+        add_compiled_symbol(name, sym, 0);
+    }
     if (get_symbol_class(sym, &sym_class) < 0 || sym_class != SYM_CLASS_TYPE) return 0;
     if (type_class != TYPE_CLASS_UNKNOWN) {
         int sym_type_class = TYPE_CLASS_UNKNOWN;
@@ -2008,88 +2119,98 @@ static void set_complex_type(Value * v) {
 
 static void expression(int mode, Value * v);
 
-static void primary_expression(int mode, Value * v) {
-    if (text_sy == '(') {
-        next_sy();
-        for (;;) {
-            expression(mode, v);
-            if (text_sy != ',') break;
-            next_sy();
-        }
-        if (text_sy != ')') error(ERR_INV_EXPRESSION, "Missing ')'");
-        next_sy();
-    }
-    else if (text_sy == SY_VAL) {
-        int flags = text_val_flags;
-        *v = text_val;
-        next_sy();
 #if ENABLE_Symbols
-        if (v->type_class == TYPE_CLASS_INTEGER || v->type_class == TYPE_CLASS_CARDINAL) {
-            size_t size = 0;
-            uint64_t n = to_uns(MODE_NORMAL, v);
-            if (flags & VAL_FLAG_C) {
+/* Set C type of a numeric literal according to its value and suffix flags */
+static void set_literal_type(Value * v, int flags) {
+    if (v->type_class == TYPE_CLASS_INTEGER || v->type_class == TYPE_CLASS_CARDINAL) {
+        size_t size = 0;
+        uint64_t n = to_uns(MODE_NORMAL, v);
+        if (flags & VAL_FLAG_C) {
+            Symbol * type = NULL;
+            if (get_std_type(flags & VAL_FLAG_L ? "wchar_t" : "char", TYPE_CLASS_UNKNOWN, &type, &size)) {
+                uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
+                if (n <= m) {
+                    v->type = type;
+                    get_symbol_type_class(type, &v->type_class);
+                }
+            }
+        }
+        else {
+            if ((flags & (VAL_FLAG_L | VAL_FLAG_U)) == 0) {
                 Symbol * type = NULL;
-                if (get_std_type(flags & VAL_FLAG_L ? "wchar_t" : "char", TYPE_CLASS_UNKNOWN, &type, &size)) {
+                if (get_std_type("int", TYPE_CLASS_INTEGER, &type, &size)) {
                     uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
                     if (n <= m) {
                         v->type = type;
-                        get_symbol_type_class(type, &v->type_class);
+                        v->type_class = TYPE_CLASS_INTEGER;
                     }
                 }
             }
-            else {
-                if ((flags & (VAL_FLAG_L | VAL_FLAG_U)) == 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("int", TYPE_CLASS_INTEGER, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_INTEGER;
-                        }
-                    }
-                }
-                if (v->type == NULL && (flags & VAL_FLAG_L) == 0 &&
-                        (flags & (VAL_FLAG_X | VAL_FLAG_U)) != 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_CARDINAL;
-                        }
+            if (v->type == NULL && (flags & VAL_FLAG_L) == 0 &&
+                    (flags & (VAL_FLAG_X | VAL_FLAG_U)) != 0) {
+                Symbol * type = NULL;
+                if (get_std_type("unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
+                    uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
+                    if (n <= m) {
+                        v->type = type;
+                        v->type_class = TYPE_CLASS_CARDINAL;
                     }
                 }
-                if (v->type == NULL && (flags & VAL_FLAG_U) == 0) {
-                    Symbol * type = NULL;
-                    if (get_std_type("long int", TYPE_CLASS_INTEGER, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_INTEGER;
-                        }
+            }
+            if (v->type == NULL && (flags & VAL_FLAG_U) == 0) {
+                Symbol * type = NULL;
+                if (get_std_type("long int", TYPE_CLASS_INTEGER, &type, &size)) {
+                    uint64_t m = ((uint64_t)1 << (size * 8 - 1)) - 1;
+                    if (n <= m) {
+                        v->type = type;
+                        v->type_class = TYPE_CLASS_INTEGER;
                     }
                 }
-                if (v->type == NULL) {
-                    Symbol * type = NULL;
-                    if (get_std_type("long unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
-                        uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
-                        if (n <= m) {
-                            v->type = type;
-                            v->type_class = TYPE_CLASS_CARDINAL;
-                        }
+            }
+            if (v->type == NULL) {
+                Symbol * type = NULL;
+                if (get_std_type("long unsigned int", TYPE_CLASS_CARDINAL, &type, &size)) {
+                    uint64_t m = ((uint64_t)1 << (size * 8)) - 1;
+                    if (n <= m) {
+                        v->type = type;
+                        v->type_class = TYPE_CLASS_CARDINAL;
                     }
                 }
             }
-            if (v->type != NULL && size != v->size) set_int_value(v, size, n);
         }
-        else if (v->type_class == TYPE_CLASS_REAL) {
-            size_t size = 0;
-            Symbol * type = NULL;
-            const char * name = flags & VAL_FLAG_F ? "float" : "double";
-            if (get_std_type(name, TYPE_CLASS_REAL, &type, &size)) {
-                v->type = type;
-                if (size != v->size) set_fp_value(v, size, to_double(MODE_NORMAL, v));
-            }
+        if (v->type != NULL && size != v->size) set_int_value(v, size, n);
+    }
+    else if (v->type_class == TYPE_CLASS_REAL) {
+        size_t size = 0;
+        Symbol * type = NULL;
+        const char * name = flags & VAL_FLAG_F ? "float" : "double";
+        if (get_std_type(name, TYPE_CLASS_REAL, &type, &size)) {
+            v->type = type;
+            if (size != v->size) set_fp_value(v, size, to_double(MODE_NORMAL, v));
+        }
+    }
+}
+#endif
+
+static void primary_expression(int mode, Value * v) {
+    if (text_sy == '(') {
+        next_sy();
+        for (;;) {
+            expression(mode, v);
+            if (text_sy != ',') break;
+            next_sy();
+        }
+        if (text_sy != ')') error(ERR_INV_EXPRESSION, "Missing ')'");
+        next_sy();
+    }
+    else if (text_sy == SY_VAL) {
+        int flags = text_val_flags;
+        *v = text_val;
+        next_sy();
+#if ENABLE_Symbols
+        if (v->type_class == TYPE_CLASS_INTEGER || v->type_class == TYPE_CLASS_CARDINAL ||
+                v->type_class == TYPE_CLASS_REAL) {
+            set_literal_type(v, flags);
         }
         else if (v->type_class == TYPE_CLASS_ARRAY && (flags & VAL_FLAG_S) != 0) {
             if (text_sy == SY_SCOPE) {
@@ -3009,6 +3130,58 @@ static void set_bool_value(Value * v, uint64_t n) {
     set_int_value(v, size, n);
 }
 
+static void op_neg(int mode, Value * v) {
+    if (!is_number(v)) {
+        error(ERR_INV_EXPRESSION, "Numeric types expected");
+    }
+    else if (v->type_class == TYPE_CLASS_REAL) {
+        set_fp_value(v, (size_t)v->size, -to_double(mode, v));
+    }
+    else if (is_real_number(v)) {
+        double n = -to_double(mode, v);
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_REAL;
+        set_fp_value(v, sizeof(double), n);
+        set_fp_type(v);
+    }
+    else if (v->type_class == TYPE_CLASS_COMPLEX) {
+        set_complex_value(v, (size_t)v->size, -to_r_double(mode, v), -to_i_double(mode, v));
+    }
+    else if (v->type_class != TYPE_CLASS_CARDINAL) {
+        int64_t value = -to_int(mode, v);
+        if (v->type_class == TYPE_CLASS_INTEGER) {
+            set_int_value(v, (size_t)v->size, value);
+        }
+        else {
+            v->type_class = TYPE_CLASS_INTEGER;
+            set_int_value(v, context_word_size(expression_context), value);
+            v->type = NULL;
+        }
+    }
+    assert(!v->remote);
+}
+
+static void op_not(int mode, Value * v) {
+    if (!is_whole_number(v)) {
+        error(ERR_INV_EXPRESSION, "Integral types expected");
+    }
+    else {
+        set_bool_value(v, !to_int(mode, v));
+    }
+    assert(!v->remote);
+}
+
+static void op_inv(int mode, Value * v) {
+    if (!is_whole_number(v)) {
+        error(ERR_INV_EXPRESSION, "Integral types expected");
+    }
+    else {
+        int64_t value = ~to_int(mode, v);
+        set_int_value(v, (size_t)v->size, value);
+    }
+    assert(!v->remote);
+}
+
 /* Note: lazy_unary_expression() does not set v->size if v->sym != NULL */
 static void lazy_unary_expression(int mode, Value * v) {
     switch (text_sy) {
@@ -3033,49 +3206,12 @@ static void lazy_unary_expression(int mode, Value * v) {
     case '-':
         next_sy();
         unary_expression(mode, v);
-        if (mode != MODE_SKIP) {
-            if (!is_number(v)) {
-                error(ERR_INV_EXPRESSION, "Numeric types expected");
-            }
-            else if (v->type_class == TYPE_CLASS_REAL) {
-                set_fp_value(v, (size_t)v->size, -to_double(mode, v));
-            }
-            else if (is_real_number(v)) {
-                double n = -to_double(mode, v);
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_REAL;
-                set_fp_value(v, sizeof(double), n);
-                set_fp_type(v);
-            }
-            else if (v->type_class == TYPE_CLASS_COMPLEX) {
-                set_complex_value(v, (size_t)v->size, -to_r_double(mode, v), -to_i_double(mode, v));
-            }
-            else if (v->type_class != TYPE_CLASS_CARDINAL) {
-                int64_t value = -to_int(mode, v);
-                if (v->type_class == TYPE_CLASS_INTEGER) {
-                    set_int_value(v, (size_t)v->size, value);
-                }
-                else {
-                    v->type_class = TYPE_CLASS_INTEGER;
-                    set_int_value(v, context_word_size(expression_context), value);
-                    v->type = NULL;
-                }
-            }
-            assert(!v->remote);
-        }
+        if (mode != MODE_SKIP) op_neg(mode, v);
         break;
     case '!':
         next_sy();
         unary_expression(mode, v);
-        if (mode != MODE_SKIP) {
-            if (!is_whole_number(v)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            else {
-                set_bool_value(v, !to_int(mode, v));
-            }
-            assert(!v->remote);
-        }
+        if (mode != MODE_SKIP) op_not(mode, v);
         break;
     case '~':
         next_sy();
@@ -3094,16 +3230,7 @@ static void lazy_unary_expression(int mode, Value * v) {
         }
 #endif
         unary_expression(mode, v);
-        if (mode != MODE_SKIP) {
-            if (!is_whole_number(v)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            else {
-                int64_t value = ~to_int(mode, v);
-                set_int_value(v, (size_t)v->size, value);
-            }
-            assert(!v->remote);
-        }
+        if (mode != MODE_SKIP) op_inv(mode, v);
         break;
 #if ENABLE_Symbols
     case '(':
@@ -3301,6 +3428,93 @@ static void pm_expression(int mode, Value * v) {
 #endif
 }
 
+static void op_mul(int mode, int sy, Value * v, Value * x) {
+    if (!is_number(v) || !is_number(x)) {
+        error(ERR_INV_EXPRESSION, "Numeric types expected");
+    }
+    else if (v->type_class == TYPE_CLASS_COMPLEX || x->type_class == TYPE_CLASS_COMPLEX) {
+        double r_value = 0;
+        double i_value = 0;
+        if (mode == MODE_NORMAL) {
+            double d = 0;
+            switch (sy) {
+            case '*':
+                r_value =
+                    to_r_double(mode, v) * to_r_double(mode, x) -
+                    to_i_double(mode, v) * to_i_double(mode, x);
+                i_value =
+                    to_r_double(mode, v) * to_i_double(mode, x) +
+                    to_i_double(mode, v) * to_r_double(mode, x);
+                break;
+            case '/':
+                d =
+                    to_r_double(mode, x) * to_r_double(mode, x) +
+                    to_i_double(mode, x) * to_i_double(mode, x);
+                r_value =
+                    (to_r_double(mode, v) * to_r_double(mode, x) +
+                    to_i_double(mode, v) * to_i_double(mode, x)) / d;
+                i_value =
+                    (to_i_double(mode, v) * to_r_double(mode, x) -
+                    to_r_double(mode, v) * to_i_double(mode, x)) / d;
+                break;
+            default:
+                error(ERR_INV_EXPRESSION, "Invalid type");
+            }
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_COMPLEX;
+        set_complex_value(v, sizeof(double) * 2, r_value, i_value);
+        set_complex_type(v);
+    }
+    else if (is_real_number(v) || is_real_number(x)) {
+        double value = 0;
+        if (mode == MODE_NORMAL) {
+            switch (sy) {
+            case '*': value = to_double(mode, v) * to_double(mode, x); break;
+            case '/': value = to_double(mode, v) / to_double(mode, x); break;
+            default: error(ERR_INV_EXPRESSION, "Invalid type");
+            }
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_REAL;
+        set_fp_value(v, sizeof(double), value);
+        set_fp_type(v);
+    }
+    else if (v->type_class == TYPE_CLASS_CARDINAL || x->type_class == TYPE_CLASS_CARDINAL) {
+        uint64_t value = 0;
+        if (mode == MODE_NORMAL) {
+            uint64_t a = to_uns(mode, v);
+            uint64_t b = to_uns(mode, x);
+            if (sy != '*' && b == 0) error(ERR_INV_EXPRESSION, "Dividing by zero");
+            switch (sy) {
+            case '*': value = a * b; break;
+            case '/': value = a / b; break;
+            case '%': value = a % b; break;
+            }
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_CARDINAL;
+        set_int_value(v, sizeof(uint64_t), value);
+    }
+    else {
+        int64_t value = 0;
+        if (mode == MODE_NORMAL) {
+            int64_t a = to_int(mode, v);
+            int64_t b = to_int(mode, x);
+            if (sy != '*' && b == 0) error(ERR_INV_EXPRESSION, "Dividing by zero");
+            switch (sy) {
+            case '*': value = a * b; break;
+            case '/': value = a / b; break;
+            case '%': value = a % b; break;
+            }
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_INTEGER;
+        set_int_value(v, sizeof(int64_t), value);
+    }
+    v->constant = v->constant && x->constant;
+}
+
 static void multiplicative_expression(int mode, Value * v) {
     pm_expression(mode, v);
     while (text_sy == '*' || text_sy == '/' || text_sy == '%') {
@@ -3308,93 +3522,132 @@ static void multiplicative_expression(int mode, Value * v) {
         int sy = text_sy;
         next_sy();
         pm_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            if (!is_number(v) || !is_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Numeric types expected");
-            }
-            else if (v->type_class == TYPE_CLASS_COMPLEX || x.type_class == TYPE_CLASS_COMPLEX) {
-                double r_value = 0;
-                double i_value = 0;
-                if (mode == MODE_NORMAL) {
-                    double d = 0;
-                    switch (sy) {
-                    case '*':
-                        r_value =
-                            to_r_double(mode, v) * to_r_double(mode, &x) -
-                            to_i_double(mode, v) * to_i_double(mode, &x);
-                        i_value =
-                            to_r_double(mode, v) * to_i_double(mode, &x) +
-                            to_i_double(mode, v) * to_r_double(mode, &x);
-                        break;
-                    case '/':
-                        d =
-                            to_r_double(mode, &x) * to_r_double(mode, &x) +
-                            to_i_double(mode, &x) * to_i_double(mode, &x);
-                        r_value =
-                            (to_r_double(mode, v) * to_r_double(mode, &x) +
-                            to_i_double(mode, v) * to_i_double(mode, &x)) / d;
-                        i_value =
-                            (to_i_double(mode, v) * to_r_double(mode, &x) -
-                            to_r_double(mode, v) * to_i_double(mode, &x)) / d;
-                        break;
-                    default:
-                        error(ERR_INV_EXPRESSION, "Invalid type");
-                    }
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_COMPLEX;
-                set_complex_value(v, sizeof(double) * 2, r_value, i_value);
-                set_complex_type(v);
-            }
-            else if (is_real_number(v) || is_real_number(&x)) {
-                double value = 0;
-                if (mode == MODE_NORMAL) {
-                    switch (sy) {
-                    case '*': value = to_double(mode, v) * to_double(mode, &x); break;
-                    case '/': value = to_double(mode, v) / to_double(mode, &x); break;
-                    default: error(ERR_INV_EXPRESSION, "Invalid type");
-                    }
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_REAL;
-                set_fp_value(v, sizeof(double), value);
-                set_fp_type(v);
-            }
-            else if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                uint64_t value = 0;
-                if (mode == MODE_NORMAL) {
-                    uint64_t a = to_uns(mode, v);
-                    uint64_t b = to_uns(mode, &x);
-                    if (sy != '*' && b == 0) error(ERR_INV_EXPRESSION, "Dividing by zero");
-                    switch (sy) {
-                    case '*': value = a * b; break;
-                    case '/': value = a / b; break;
-                    case '%': value = a % b; break;
-                    }
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_CARDINAL;
-                set_int_value(v, sizeof(uint64_t), value);
+        if (mode != MODE_SKIP) op_mul(mode, sy, v, &x);
+    }
+}
+
+static void op_add(int mode, int sy, Value * v, Value * x) {
+    if (v->function) {
+        v->type_class = TYPE_CLASS_CARDINAL;
+        v->type = NULL;
+    }
+    if (x->function) {
+        x->type_class = TYPE_CLASS_CARDINAL;
+        x->type = NULL;
+    }
+    if (sy == '+' && v->type_class == TYPE_CLASS_ARRAY && x->type_class == TYPE_CLASS_ARRAY) {
+        if (mode == MODE_TYPE) {
+            v->remote = 0;
+            v->size = 0;
+            v->value = tmp_alloc_zero((size_t)v->size);
+        }
+        else {
+            char * value;
+            load_value(v);
+            load_value(x);
+            v->size = strlen((char *)v->value) + strlen((char *)x->value) + 1;
+            value = (char *)tmp_alloc((size_t)v->size);
+            strcpy(value, (const char *)(v->value));
+            strcat(value, (const char *)(x->value));
+            v->value = value;
+        }
+        v->type = NULL;
+    }
+#if ENABLE_Symbols
+    else if ((v->type_class == TYPE_CLASS_POINTER || v->type_class == TYPE_CLASS_ARRAY) && is_number(x)) {
+        uint64_t value = 0;
+        Symbol * base = NULL;
+        ContextAddress size = 0;
+        if (v->type == NULL || get_symbol_base_type(v->type, &base) < 0 ||
+            base == NULL || get_symbol_size(base, &size) < 0 || size == 0) {
+            error(ERR_INV_EXPRESSION, "Unknown pointer base type size");
+        }
+        switch (sy) {
+        case '+': value = to_uns(mode, v) + to_uns(mode, x) * size; break;
+        case '-': value = to_uns(mode, v) - to_uns(mode, x) * size; break;
+        }
+        if (v->type_class == TYPE_CLASS_ARRAY) {
+            if (get_array_symbol(base, 0, &v->type) < 0 ||
+                get_symbol_size(v->type, &v->size) < 0) {
+                error(errno, "Cannot cast to pointer");
             }
-            else {
-                int64_t value = 0;
-                if (mode == MODE_NORMAL) {
-                    int64_t a = to_int(mode, v);
-                    int64_t b = to_int(mode, &x);
-                    if (sy != '*' && b == 0) error(ERR_INV_EXPRESSION, "Dividing by zero");
-                    switch (sy) {
-                    case '*': value = a * b; break;
-                    case '/': value = a / b; break;
-                    case '%': value = a % b; break;
-                    }
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_INTEGER;
-                set_int_value(v, sizeof(int64_t), value);
+            v->type_class = TYPE_CLASS_POINTER;
+        }
+        set_int_value(v, (size_t)v->size, value);
+    }
+    else if (is_number(v) && (x->type_class == TYPE_CLASS_POINTER || x->type_class == TYPE_CLASS_ARRAY) && sy == '+') {
+        uint64_t value = 0;
+        Symbol * base = NULL;
+        ContextAddress size = 0;
+        if (x->type == NULL || get_symbol_base_type(x->type, &base) < 0 ||
+            base == NULL || get_symbol_size(base, &size) < 0 || size == 0) {
+            error(ERR_INV_EXPRESSION, "Unknown pointer base type size");
+        }
+        value = to_uns(mode, x) + to_uns(mode, v) * size;
+        v->type = x->type;
+        if (x->type_class == TYPE_CLASS_ARRAY) {
+            if (get_array_symbol(base, 0, &v->type) < 0 ||
+                get_symbol_size(v->type, &v->size) < 0) {
+                error(errno, "Cannot cast to pointer");
             }
-            v->constant = v->constant && x.constant;
         }
+        v->type_class = TYPE_CLASS_POINTER;
+        set_int_value(v, (size_t)x->size, value);
+    }
+#endif
+    else if (!is_number(v) || !is_number(x)) {
+        error(ERR_INV_EXPRESSION, "Numeric types expected");
+    }
+    else if (v->type_class == TYPE_CLASS_COMPLEX || x->type_class == TYPE_CLASS_COMPLEX) {
+        double r_value = 0;
+        double i_value = 0;
+        switch (sy) {
+        case '+':
+            r_value = to_r_double(mode, v) + to_r_double(mode, x);
+            i_value = to_i_double(mode, v) + to_i_double(mode, x);
+            break;
+        case '-':
+            r_value = to_r_double(mode, v) - to_r_double(mode, x);
+            i_value = to_i_double(mode, v) - to_i_double(mode, x);
+            break;
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_COMPLEX;
+        set_complex_value(v, sizeof(double) * 2, r_value, i_value);
+        set_complex_type(v);
+    }
+    else if (is_real_number(v) || is_real_number(x)) {
+        double value = 0;
+        switch (sy) {
+        case '+': value = to_double(mode, v) + to_double(mode, x); break;
+        case '-': value = to_double(mode, v) - to_double(mode, x); break;
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_REAL;
+        set_fp_value(v, sizeof(double), value);
+        set_fp_type(v);
     }
+    else if (v->type_class == TYPE_CLASS_CARDINAL || x->type_class == TYPE_CLASS_CARDINAL) {
+        uint64_t value = 0;
+        switch (sy) {
+        case '+': value = to_uns(mode, v) + to_uns(mode, x); break;
+        case '-': value = to_uns(mode, v) - to_uns(mode, x); break;
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_CARDINAL;
+        set_int_value(v, sizeof(uint64_t), value);
+    }
+    else {
+        int64_t value = 0;
+        switch (sy) {
+        case '+': value = to_int(mode, v) + to_int(mode, x); break;
+        case '-': value = to_int(mode, v) - to_int(mode, x); break;
+        }
+        v->type = NULL;
+        v->type_class = TYPE_CLASS_INTEGER;
+        set_int_value(v, sizeof(int64_t), value);
+    }
+    v->constant = v->constant && x->constant;
 }
 
 static void additive_expression(int mode, Value * v) {
@@ -3404,130 +3657,48 @@ static void additive_expression(int mode, Value * v) {
         int sy = text_sy;
         next_sy();
         multiplicative_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            if (v->function) {
-                v->type_class = TYPE_CLASS_CARDINAL;
-                v->type = NULL;
-            }
-            if (x.function) {
-                x.type_class = TYPE_CLASS_CARDINAL;
-                x.type = NULL;
-            }
-            if (sy == '+' && v->type_class == TYPE_CLASS_ARRAY && x.type_class == TYPE_CLASS_ARRAY) {
-                if (mode == MODE_TYPE) {
-                    v->remote = 0;
-                    v->size = 0;
-                    v->value = tmp_alloc_zero((size_t)v->size);
-                }
-                else {
-                    char * value;
-                    load_value(v);
-                    load_value(&x);
-                    v->size = strlen((char *)v->value) + strlen((char *)x.value) + 1;
-                    value = (char *)tmp_alloc((size_t)v->size);
-                    strcpy(value, (const char *)(v->value));
-                    strcat(value, (const char *)(x.value));
-                    v->value = value;
-                }
-                v->type = NULL;
-            }
-#if ENABLE_Symbols
-            else if ((v->type_class == TYPE_CLASS_POINTER || v->type_class == TYPE_CLASS_ARRAY) && is_number(&x)) {
-                uint64_t value = 0;
-                Symbol * base = NULL;
-                ContextAddress size = 0;
-                if (v->type == NULL || get_symbol_base_type(v->type, &base) < 0 ||
-                    base == NULL || get_symbol_size(base, &size) < 0 || size == 0) {
-                    error(ERR_INV_EXPRESSION, "Unknown pointer base type size");
-                }
-                switch (sy) {
-                case '+': value = to_uns(mode, v) + to_uns(mode, &x) * size; break;
-                case '-': value = to_uns(mode, v) - to_uns(mode, &x) * size; break;
-                }
-                if (v->type_class == TYPE_CLASS_ARRAY) {
-                    if (get_array_symbol(base, 0, &v->type) < 0 ||
-                        get_symbol_size(v->type, &v->size) < 0) {
-                        error(errno, "Cannot cast to pointer");
-                    }
-                    v->type_class = TYPE_CLASS_POINTER;
-                }
-                set_int_value(v, (size_t)v->size, value);
-            }
-            else if (is_number(v) && (x.type_class == TYPE_CLASS_POINTER || x.type_class == TYPE_CLASS_ARRAY) && sy == '+') {
-                uint64_t value = 0;
-                Symbol * base = NULL;
-                ContextAddress size = 0;
-                if (x.type == NULL || get_symbol_base_type(x.type, &base) < 0 ||
-                    base == NULL || get_symbol_size(base, &size) < 0 || size == 0) {
-                    error(ERR_INV_EXPRESSION, "Unknown pointer base type size");
-                }
-                value = to_uns(mode, &x) + to_uns(mode, v) * size;
-                v->type = x.type;
-                if (x.type_class == TYPE_CLASS_ARRAY) {
-                    if (get_array_symbol(base, 0, &v->type) < 0 ||
-                        get_symbol_size(v->type, &v->size) < 0) {
-                        error(errno, "Cannot cast to pointer");
-                    }
-                }
-                v->type_class = TYPE_CLASS_POINTER;
-                set_int_value(v, (size_t)x.size, value);
+        if (mode != MODE_SKIP) op_add(mode, sy, v, &x);
+    }
+}
+
+static void op_shift(int mode, int sy, Value * v, Value * x) {
+    uint64_t value = 0;
+    if (!is_whole_number(v) || !is_whole_number(x)) {
+        error(ERR_INV_EXPRESSION, "Integral types expected");
+    }
+    if (x->type_class != TYPE_CLASS_CARDINAL && to_int(mode, x) < 0) {
+        if (v->type_class == TYPE_CLASS_CARDINAL) {
+            switch (sy) {
+            case SY_SHL: value = to_uns(mode, v) >> -to_int(mode, x); break;
+            case SY_SHR: value = to_uns(mode, v) << -to_int(mode, x); break;
             }
-#endif
-            else if (!is_number(v) || !is_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Numeric types expected");
-            }
-            else if (v->type_class == TYPE_CLASS_COMPLEX || x.type_class == TYPE_CLASS_COMPLEX) {
-                double r_value = 0;
-                double i_value = 0;
-                switch (sy) {
-                case '+':
-                    r_value = to_r_double(mode, v) + to_r_double(mode, &x);
-                    i_value = to_i_double(mode, v) + to_i_double(mode, &x);
-                    break;
-                case '-':
-                    r_value = to_r_double(mode, v) - to_r_double(mode, &x);
-                    i_value = to_i_double(mode, v) - to_i_double(mode, &x);
-                    break;
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_COMPLEX;
-                set_complex_value(v, sizeof(double) * 2, r_value, i_value);
-                set_complex_type(v);
-            }
-            else if (is_real_number(v) || is_real_number(&x)) {
-                double value = 0;
-                switch (sy) {
-                case '+': value = to_double(mode, v) + to_double(mode, &x); break;
-                case '-': value = to_double(mode, v) - to_double(mode, &x); break;
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_REAL;
-                set_fp_value(v, sizeof(double), value);
-                set_fp_type(v);
+        }
+        else {
+            switch (sy) {
+            case SY_SHL: value = to_int(mode, v) >> -to_int(mode, x); break;
+            case SY_SHR: value = to_int(mode, v) << -to_int(mode, x); break;
             }
-            else if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                uint64_t value = 0;
-                switch (sy) {
-                case '+': value = to_uns(mode, v) + to_uns(mode, &x); break;
-                case '-': value = to_uns(mode, v) - to_uns(mode, &x); break;
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_CARDINAL;
-                set_int_value(v, sizeof(uint64_t), value);
+            v->type_class = TYPE_CLASS_INTEGER;
+        }
+    }
+    else {
+        if (v->type_class == TYPE_CLASS_CARDINAL) {
+            switch (sy) {
+            case SY_SHL: value = to_uns(mode, v) << to_uns(mode, x); break;
+            case SY_SHR: value = to_uns(mode, v) >> to_uns(mode, x); break;
             }
-            else {
-                int64_t value = 0;
-                switch (sy) {
-                case '+': value = to_int(mode, v) + to_int(mode, &x); break;
-                case '-': value = to_int(mode, v) - to_int(mode, &x); break;
-                }
-                v->type = NULL;
-                v->type_class = TYPE_CLASS_INTEGER;
-                set_int_value(v, sizeof(int64_t), value);
+        }
+        else {
+            switch (sy) {
+            case SY_SHL: value = to_int(mode, v) << to_uns(mode, x); break;
+            case SY_SHR: value = to_int(mode, v) >> to_uns(mode, x); break;
             }
-            v->constant = v->constant && x.constant;
+            v->type_class = TYPE_CLASS_INTEGER;
         }
     }
+    v->type = NULL;
+    v->constant = v->constant && x->constant;
+    set_int_value(v, sizeof(uint64_t), value);
 }
 
 static void shift_expression(int mode, Value * v) {
@@ -3537,46 +3708,51 @@ static void shift_expression(int mode, Value * v) {
         int sy = text_sy;
         next_sy();
         additive_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            uint64_t value = 0;
-            if (!is_whole_number(v) || !is_whole_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            if (x.type_class != TYPE_CLASS_CARDINAL && to_int(mode, &x) < 0) {
-                if (v->type_class == TYPE_CLASS_CARDINAL) {
-                    switch (sy) {
-                    case SY_SHL: value = to_uns(mode, v) >> -to_int(mode, &x); break;
-                    case SY_SHR: value = to_uns(mode, v) << -to_int(mode, &x); break;
-                    }
-                }
-                else {
-                    switch (sy) {
-                    case SY_SHL: value = to_int(mode, v) >> -to_int(mode, &x); break;
-                    case SY_SHR: value = to_int(mode, v) << -to_int(mode, &x); break;
-                    }
-                    v->type_class = TYPE_CLASS_INTEGER;
-                }
-            }
-            else {
-                if (v->type_class == TYPE_CLASS_CARDINAL) {
-                    switch (sy) {
-                    case SY_SHL: value = to_uns(mode, v) << to_uns(mode, &x); break;
-                    case SY_SHR: value = to_uns(mode, v) >> to_uns(mode, &x); break;
-                    }
-                }
-                else {
-                    switch (sy) {
-                    case SY_SHL: value = to_int(mode, v) << to_uns(mode, &x); break;
-                    case SY_SHR: value = to_int(mode, v) >> to_uns(mode, &x); break;
-                    }
-                    v->type_class = TYPE_CLASS_INTEGER;
-                }
-            }
-            v->type = NULL;
-            v->constant = v->constant && x.constant;
-            set_int_value(v, sizeof(uint64_t), value);
+        if (mode != MODE_SKIP) op_shift(mode, sy, v, &x);
+    }
+}
+
+static void op_rel(int mode, int sy, Value * v, Value * x) {
+    uint32_t value = 0;
+    if (v->type_class == TYPE_CLASS_ARRAY && x->type_class == TYPE_CLASS_ARRAY) {
+        int n = 0;
+        load_value(v);
+        load_value(x);
+        n = strcmp((char *)v->value, (char *)x->value);
+        switch (sy) {
+        case '<': value = n < 0; break;
+        case '>': value = n > 0; break;
+        case SY_LEQ: value = n <= 0; break;
+        case SY_GEQ: value = n >= 0; break;
+        }
+    }
+    else if (is_real_number(v) || is_real_number(x)) {
+        switch (sy) {
+        case '<': value = to_double(mode, v) < to_double(mode, x); break;
+        case '>': value = to_double(mode, v) > to_double(mode, x); break;
+        case SY_LEQ: value = to_double(mode, v) <= to_double(mode, x); break;
+        case SY_GEQ: value = to_double(mode, v) >= to_double(mode, x); break;
+        }
+    }
+    else if (v->type_class == TYPE_CLASS_CARDINAL || x->type_class == TYPE_CLASS_CARDINAL) {
+        switch (sy) {
+        case '<': value = to_uns(mode, v) < to_uns(mode, x); break;
+        case '>': value = to_uns(mode, v) > to_uns(mode, x); break;
+        case SY_LEQ: value = to_uns(mode, v) <= to_uns(mode, x); break;
+        case SY_GEQ: value = to_uns(mode, v) >= to_uns(mode, x); break;
+        }
+    }
+    else {
+        switch (sy) {
+        case '<': value = to_int(mode, v) < to_int(mode, x); break;
+        case '>': value = to_int(mode, v) > to_int(mode, x); break;
+        case SY_LEQ: value = to_int(mode, v) <= to_int(mode, x); break;
+        case SY_GEQ: value = to_int(mode, v) >= to_int(mode, x); break;
         }
     }
+    if (mode != MODE_NORMAL) value = 0;
+    v->constant = v->constant && x->constant;
+    set_bool_value(v, value);
 }
 
 static void relational_expression(int mode, Value * v) {
@@ -3586,49 +3762,32 @@ static void relational_expression(int mode, Value * v) {
         int sy = text_sy;
         next_sy();
         shift_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            uint32_t value = 0;
-            if (v->type_class == TYPE_CLASS_ARRAY && x.type_class == TYPE_CLASS_ARRAY) {
-                int n = 0;
-                load_value(v);
-                load_value(&x);
-                n = strcmp((char *)v->value, (char *)x.value);
-                switch (sy) {
-                case '<': value = n < 0; break;
-                case '>': value = n > 0; break;
-                case SY_LEQ: value = n <= 0; break;
-                case SY_GEQ: value = n >= 0; break;
-                }
-            }
-            else if (is_real_number(v) || is_real_number(&x)) {
-                switch (sy) {
-                case '<': value = to_double(mode, v) < to_double(mode, &x); break;
-                case '>': value = to_double(mode, v) > to_double(mode, &x); break;
-                case SY_LEQ: value = to_double(mode, v) <= to_double(mode, &x); break;
-                case SY_GEQ: value = to_double(mode, v) >= to_double(mode, &x); break;
-                }
-            }
-            else if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                switch (sy) {
-                case '<': value = to_uns(mode, v) < to_uns(mode, &x); break;
-                case '>': value = to_uns(mode, v) > to_uns(mode, &x); break;
-                case SY_LEQ: value = to_uns(mode, v) <= to_uns(mode, &x); break;
-                case SY_GEQ: value = to_uns(mode, v) >= to_uns(mode, &x); break;
-                }
-            }
-            else {
-                switch (sy) {
-                case '<': value = to_int(mode, v) < to_int(mode, &x); break;
-                case '>': value = to_int(mode, v) > to_int(mode, &x); break;
-                case SY_LEQ: value = to_int(mode, v) <= to_int(mode, &x); break;
-                case SY_GEQ: value = to_int(mode, v) >= to_int(mode, &x); break;
-                }
-            }
-            if (mode != MODE_NORMAL) value = 0;
-            v->constant = v->constant && x.constant;
-            set_bool_value(v, value);
-        }
+        if (mode != MODE_SKIP) op_rel(mode, sy, v, &x);
+    }
+}
+
+static void op_equ(int mode, int sy, Value * v, Value * x) {
+    uint32_t value = 0;
+    if (v->type_class == TYPE_CLASS_ARRAY && x->type_class == TYPE_CLASS_ARRAY) {
+        load_value(v);
+        load_value(x);
+        value = strcmp((char *)v->value, (char *)x->value) == 0;
+    }
+    else if (v->type_class == TYPE_CLASS_COMPLEX || x->type_class == TYPE_CLASS_COMPLEX) {
+        value =
+            to_r_double(mode, v) == to_r_double(mode, x) &&
+            to_i_double(mode, v) == to_i_double(mode, x);
+    }
+    else if (is_real_number(v) || is_real_number(x)) {
+        value = to_double(mode, v) == to_double(mode, x);
+    }
+    else {
+        value = to_int(mode, v) == to_int(mode, x);
     }
+    if (sy == SY_NEQ) value = !value;
+    if (mode != MODE_NORMAL) value = 0;
+    v->constant = v->constant && x->constant;
+    set_bool_value(v, value);
 }
 
 static void equality_expression(int mode, Value * v) {
@@ -3638,56 +3797,45 @@ static void equality_expression(int mode, Value * v) {
         int sy = text_sy;
         next_sy();
         relational_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            uint32_t value = 0;
-            if (v->type_class == TYPE_CLASS_ARRAY && x.type_class == TYPE_CLASS_ARRAY) {
-                load_value(v);
-                load_value(&x);
-                value = strcmp((char *)v->value, (char *)x.value) == 0;
-            }
-            else if (v->type_class == TYPE_CLASS_COMPLEX || x.type_class == TYPE_CLASS_COMPLEX) {
-                value =
-                    to_r_double(mode, v) == to_r_double(mode, &x) &&
-                    to_i_double(mode, v) == to_i_double(mode, &x);
-            }
-            else if (is_real_number(v) || is_real_number(&x)) {
-                value = to_double(mode, v) == to_double(mode, &x);
-            }
-            else {
-                value = to_int(mode, v) == to_int(mode, &x);
-            }
-            if (sy == SY_NEQ) value = !value;
-            if (mode != MODE_NORMAL) value = 0;
-            v->constant = v->constant && x.constant;
-            set_bool_value(v, value);
+        if (mode != MODE_SKIP) op_equ(mode, sy, v, &x);
+    }
+}
+
+static void op_bitwise(int mode, int sy, Value * v, Value * x) {
+    int64_t value = 0;
+    if (!is_whole_number(v) || !is_whole_number(x)) {
+        error(ERR_INV_EXPRESSION, "Integral types expected");
+    }
+    if (v->type_class == TYPE_CLASS_CARDINAL || x->type_class == TYPE_CLASS_CARDINAL) {
+        v->type_class = TYPE_CLASS_CARDINAL;
+        switch (sy) {
+        case '&': value = to_uns(mode, v) & to_uns(mode, x); break;
+        case '^': value = to_uns(mode, v) ^ to_uns(mode, x); break;
+        case '|': value = to_uns(mode, v) | to_uns(mode, x); break;
         }
     }
+    else {
+        v->type_class = TYPE_CLASS_INTEGER;
+        switch (sy) {
+        case '&': value = to_int(mode, v) & to_int(mode, x); break;
+        case '^': value = to_int(mode, v) ^ to_int(mode, x); break;
+        case '|': value = to_int(mode, v) | to_int(mode, x); break;
+        }
+    }
+    if (mode != MODE_NORMAL) value = 0;
+    v->type = NULL;
+    v->constant = v->constant && x->constant;
+    set_int_value(v, sizeof(int64_t), value);
 }
 
 static void and_expression(int mode, Value * v) {
     equality_expression(mode, v);
     while (text_sy == '&') {
         Value x;
+        int sy = text_sy;
         next_sy();
         equality_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            int64_t value = 0;
-            if (!is_whole_number(v) || !is_whole_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                v->type_class = TYPE_CLASS_CARDINAL;
-                value = to_uns(mode, v) & to_uns(mode, &x);
-            }
-            else {
-                v->type_class = TYPE_CLASS_INTEGER;
-                value = to_int(mode, v) & to_int(mode, &x);
-            }
-            if (mode != MODE_NORMAL) value = 0;
-            v->type = NULL;
-            v->constant = v->constant && x.constant;
-            set_int_value(v, sizeof(int64_t), value);
-        }
+        if (mode != MODE_SKIP) op_bitwise(mode, sy, v, &x);
     }
 }
 
@@ -3695,26 +3843,10 @@ static void exclusive_or_expression(int mode, Value * v) {
     and_expression(mode, v);
     while (text_sy == '^') {
         Value x;
+        int sy = text_sy;
         next_sy();
         and_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            int64_t value = 0;
-            if (!is_whole_number(v) || !is_whole_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                v->type_class = TYPE_CLASS_CARDINAL;
-                value = to_uns(mode, v) ^ to_uns(mode, &x);
-            }
-            else {
-                v->type_class = TYPE_CLASS_INTEGER;
-                value = to_int(mode, v) ^ to_int(mode, &x);
-            }
-            if (mode != MODE_NORMAL) value = 0;
-            v->type = NULL;
-            v->constant = v->constant && x.constant;
-            set_int_value(v, sizeof(int64_t), value);
-        }
+        if (mode != MODE_SKIP) op_bitwise(mode, sy, v, &x);
     }
 }
 
@@ -3722,26 +3854,10 @@ static void inclusive_or_expression(int mode, Value * v) {
     exclusive_or_expression(mode, v);
     while (text_sy == '|') {
         Value x;
+        int sy = text_sy;
         next_sy();
         exclusive_or_expression(mode, &x);
-        if (mode != MODE_SKIP) {
-            int64_t value = 0;
-            if (!is_whole_number(v) || !is_whole_number(&x)) {
-                error(ERR_INV_EXPRESSION, "Integral types expected");
-            }
-            if (v->type_class == TYPE_CLASS_CARDINAL || x.type_class == TYPE_CLASS_CARDINAL) {
-                v->type_class = TYPE_CLASS_CARDINAL;
-                value = to_uns(mode, v) | to_uns(mode, &x);
-            }
-            else {
-                v->type_class = TYPE_CLASS_INTEGER;
-                value = to_int(mode, v) | to_int(mode, &x);
-            }
-            if (mode != MODE_NORMAL) value = 0;
-            v->type = NULL;
-            v->constant = v->constant && x.constant;
-            set_int_value(v, sizeof(int64_t), value);
-        }
+        if (mode != MODE_SKIP) op_bitwise(mode, sy, v, &x);
     }
 }
 
@@ -3845,9 +3961,386 @@ int evaluate_expression(Context * ctx, int frame, ContextAddress addr, char * s,
     expression_context = ctx;
     expression_frame = frame;
     expression_addr = addr;
+    expression_scope = NULL;
     return evaluate_script(MODE_NORMAL, s, load, v);
 }
 
+static void invalidate_compiled_expressions(void) {
+    compiled_generation++;
+}
+
+static void compiled_context_exited(Context * ctx, void * args) {
+    invalidate_compiled_expressions();
+}
+
+#if SERVICE_MemoryMap
+static void compiled_memory_map_changed(Context * ctx, void * args) {
+    invalidate_compiled_expressions();
+}
+
+static void compiled_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * args) {
+    invalidate_compiled_expressions();
+}
+#endif
+
+#if SERVICE_PathMap
+static void compiled_path_map_changed(Channel * c, void * args) {
+    invalidate_compiled_expressions();
+}
+#endif
+
+static void clear_compiled_scope(CompiledScope * scope) {
+    unsigned i;
+    for (i = 0; i < scope->syms_cnt; i++) {
+        CompiledSymbol * cs = scope->syms + i;
+        loc_free(cs->name);
+        loc_free(cs->id);
+    }
+    scope->syms_cnt = 0;
+}
+
+#if ENABLE_Symbols
+static CompiledScope * get_compiled_scope(Context * ctx, int frame, CompiledExpression * e) {
+    CompiledScope * scope = NULL;
+    uint64_t pc = 0;
+    unsigned i;
+
+    if (frame != STACK_NO_FRAME) {
+        StackFrame * info = NULL;
+        RegisterDefinition * def = get_PC_definition(ctx);
+        if (def == NULL) return NULL;
+        if (get_frame_info(ctx, frame, &info) < 0) return NULL;
+        if (read_reg_value(info, def, &pc) < 0) return NULL;
+    }
+    for (i = 0; i < COMPILED_EXPRESSION_SCOPES; i++) {
+        scope = e->scopes + i;
+        if (scope->ctx == ctx && scope->frame == frame && scope->pc == pc &&
+                scope->generation == compiled_generation) return scope;
+    }
+    scope = e->scopes + e->scope_pos;
+    e->scope_pos = (e->scope_pos + 1) % COMPILED_EXPRESSION_SCOPES;
+    clear_compiled_scope(scope);
+    scope->ctx = ctx;
+    scope->frame = frame;
+    scope->pc = pc;
+    scope->generation = compiled_generation;
+    return scope;
+}
+#endif
+
+static void free_compiled_program(CompiledExpression * e) {
+    unsigned i;
+    for (i = 0; i < e->prog_cnt; i++) {
+        CompiledOp * op = e->prog + i;
+        loc_free(op->val.value);
+        loc_free(op->name);
+    }
+    loc_free(e->prog);
+    e->prog = NULL;
+    e->prog_cnt = 0;
+    e->prog_max = 0;
+}
+
+static unsigned add_compiled_op(CompiledExpression * e, int code, int sy, int pos) {
+    CompiledOp * op = NULL;
+    if (e->prog_cnt >= e->prog_max) {
+        e->prog_max += 16;
+        e->prog = (CompiledOp *)loc_realloc(e->prog, sizeof(CompiledOp) * e->prog_max);
+    }
+    op = e->prog + e->prog_cnt;
+    memset(op, 0, sizeof(CompiledOp));
+    op->code = code;
+    op->sy = sy;
+    op->pos = pos;
+    return e->prog_cnt++;
+}
+
+static unsigned compile_depth = 0;
+
+static void compile_push(void) {
+    if (++compile_depth > COMPILED_EXPRESSION_STACK) error(ERR_INV_EXPRESSION, "Expression is too complex");
+}
+
+static int compiled_binary_priority(int sy) {
+    switch (sy) {
+    case SY_OR: return 1;
+    case SY_AND: return 2;
+    case '|': return 3;
+    case '^': return 4;
+    case '&': return 5;
+    case SY_EQU: case SY_NEQ: return 6;
+    case '<': case '>': case SY_LEQ: case SY_GEQ: return 7;
+    case SY_SHL: case SY_SHR: return 8;
+    case '+': case '-': return 9;
+    case '*': case '/': case '%': return 10;
+    }
+    return 0;
+}
+
+static void compile_binary(CompiledExpression * e, int priority);
+
+/* Only literals, plain identifiers, unary and binary arithmetic, and logical operators are compiled,
+ * anything else throws an exception and the expression is evaluated by the parser */
+static void compile_unary(CompiledExpression * e) {
+    int sy = text_sy;
+    unsigned i = 0;
+
+    switch (sy) {
+    case '+':
+    case '-':
+    case '!':
+    case '~':
+        next_sy();
+        /* '~' followed by a name can be C++ destructor */
+        if (sy == '~' && text_sy == SY_NAME) error(ERR_INV_EXPRESSION, "Cannot compile");
+        compile_unary(e);
+        if (sy != '+') add_compiled_op(e, CP_UNARY, sy, sy_pos);
+        break;
+    case '(':
+        next_sy();
+        i = e->prog_cnt;
+        compile_binary(e, 1);
+        if (text_sy != ')') error(ERR_INV_EXPRESSION, "Missing ')'");
+        next_sy();
+        if (e->prog_cnt == i + 1 && e->prog[i].code == CP_NAME) {
+            /* "(name)" followed by an operand can be a type cast */
+            switch (text_sy) {
+            case '(': case '+': case '-': case '!': case '~': case '*': case '&':
+            case SY_VAL: case SY_NAME: case SY_ID: case SY_SIZEOF: case SY_INC: case SY_DEC: case SY_SCOPE:
+                error(ERR_INV_EXPRESSION, "Cannot compile");
+            }
+        }
+        break;
+    case SY_VAL:
+        if (text_val.type_class != TYPE_CLASS_INTEGER && text_val.type_class != TYPE_CLASS_CARDINAL &&
+                text_val.type_class != TYPE_CLASS_REAL) error(ERR_INV_EXPRESSION, "Cannot compile");
+        i = add_compiled_op(e, CP_CONST, sy, 0);
+        e->prog[i].val = text_val;
+        e->prog[i].val.value = loc_alloc((size_t)text_val.size);
+        memcpy(e->prog[i].val.value, text_val.value, (size_t)text_val.size);
+        e->prog[i].val_flags = text_val_flags;
+        next_sy();
+        e->prog[i].pos = sy_pos;
+        compile_push();
+        break;
+    case SY_NAME:
+        i = add_compiled_op(e, CP_NAME, sy, 0);
+        e->prog[i].name = loc_strdup((char *)text_val.value);
+        next_sy();
+        if (text_sy == SY_SCOPE) error(ERR_INV_EXPRESSION, "Cannot compile");
+        e->prog[i].pos = sy_pos;
+        compile_push();
+        break;
+    default:
+        error(ERR_INV_EXPRESSION, "Cannot compile");
+        break;
+    }
+}
+
+static void compile_binary(CompiledExpression * e, int priority) {
+    compile_unary(e);
+    for (;;) {
+        int sy = text_sy;
+        int pos = sy_pos;
+        int p = compiled_binary_priority(sy);
+        if (p == 0 || p < priority) break;
+        next_sy();
+        if (sy == SY_AND || sy == SY_OR) {
+            unsigned i = add_compiled_op(e, sy == SY_AND ? CP_AND : CP_OR, sy, pos);
+            compile_binary(e, p + 1);
+            add_compiled_op(e, CP_BINARY, sy, sy_pos);
+            e->prog[i].jump = e->prog_cnt;
+        }
+        else {
+            compile_binary(e, p + 1);
+            add_compiled_op(e, CP_BINARY, sy, sy_pos);
+        }
+        compile_depth--;
+    }
+}
+
+static void compile_program(CompiledExpression * e) {
+    Trap trap;
+    if (set_trap(&trap)) {
+        text = e->text;
+        text_pos = 0;
+        text_len = strlen(e->text) + 1;
+        compile_depth = 0;
+        next_ch();
+        next_sy();
+        compile_binary(e, 1);
+        if (text_sy != 0) error(ERR_INV_EXPRESSION, "Cannot compile");
+        clear_trap(&trap);
+    }
+    else {
+        free_compiled_program(e);
+    }
+}
+
+static void compiled_name_value(CompiledOp * op, Value * v) {
+    char * name = tmp_strdup(op->name);
+    int sym_class = identifier(MODE_NORMAL, NULL, name, 0, v);
+    if (sym_class < 0) error(ERR_INV_EXPRESSION, "Undefined identifier '%s'", name);
+    if (sym_class == SYM_CLASS_TYPE) error(ERR_INV_EXPRESSION, "Illegal usage of a type in expression");
+    resolve_ref_type(MODE_NORMAL, v);
+    if (v->func_cb) error(ERR_INV_EXPRESSION, "'(' expected");
+#if ENABLE_Symbols
+    if (v->sym != NULL && v->size == 0 && get_symbol_size(v->sym, &v->size) < 0) {
+        error(errno, "Cannot retrieve symbol size");
+    }
+#endif
+}
+
+static void run_compiled_program(CompiledExpression * e, Value * v) {
+    Value stack[COMPILED_EXPRESSION_STACK];
+    unsigned sp = 0;
+    unsigned i = 0;
+
+    while (i < e->prog_cnt) {
+        CompiledOp * op = e->prog + i++;
+        Value * x = NULL;
+        Value * y = NULL;
+        sy_pos = op->pos;
+        switch (op->code) {
+        case CP_CONST:
+            x = stack + sp++;
+            *x = op->val;
+            x->ctx = expression_context;
+            set_value(x, op->val.value, (size_t)op->val.size, op->val.big_endian);
+#if ENABLE_Symbols
+            set_literal_type(x, op->val_flags);
+#endif
+            break;
+        case CP_NAME:
+            x = stack + sp++;
+            compiled_name_value(op, x);
+            break;
+        case CP_UNARY:
+            x = stack + sp - 1;
+            switch (op->sy) {
+            case '-': op_neg(MODE_NORMAL, x); break;
+            case '!': op_not(MODE_NORMAL, x); break;
+            case '~': op_inv(MODE_NORMAL, x); break;
+            }
+            break;
+        case CP_BINARY:
+            sp--;
+            x = stack + sp - 1;
+            y = stack + sp;
+            switch (op->sy) {
+            case '*': case '/': case '%': op_mul(MODE_NORMAL, op->sy, x, y); break;
+            case '+': case '-': op_add(MODE_NORMAL, op->sy, x, y); break;
+            case SY_SHL: case SY_SHR: op_shift(MODE_NORMAL, op->sy, x, y); break;
+            case '<': case '>': case SY_LEQ: case SY_GEQ: op_rel(MODE_NORMAL, op->sy, x, y); break;
+            case SY_EQU: case SY_NEQ: op_equ(MODE_NORMAL, op->sy, x, y); break;
+            case '&': case '^': case '|': op_bitwise(MODE_NORMAL, op->sy, x, y); break;
+            case SY_AND:
+            case SY_OR:
+                /* Left operand did not decide the result, the result is right operand */
+                if (!x->constant) y->constant = 0;
+                *x = *y;
+                break;
+            }
+            break;
+        case CP_AND:
+            if (!to_boolean(MODE_NORMAL, stack + sp - 1)) i = op->jump;
+            break;
+        case CP_OR:
+            if (to_boolean(MODE_NORMAL, stack + sp - 1)) i = op->jump;
+            break;
+        }
+    }
+    assert(sp == 1);
+    *v = stack[0];
+}
+
+CompiledExpression * compile_expression(const char * s) {
+    static int init = 0;
+    CompiledExpression * e = NULL;
+
+    if (!init) {
+        static ContextEventListener ctx_listener = {
+            NULL,
+            compiled_context_exited,
+            NULL,
+            NULL,
+            NULL,
+            compiled_context_exited
+        };
+        add_context_event_listener(&ctx_listener, NULL);
+#if SERVICE_MemoryMap
+        {
+            static MemoryMapEventListener map_listener = {
+                compiled_memory_map_changed,
+                compiled_code_unmapped,
+                compiled_memory_map_changed,
+                compiled_memory_map_changed,
+            };
+            add_memory_map_event_listener(&map_listener, NULL);
+        }
+#endif
+#if SERVICE_PathMap
+        {
+            static PathMapEventListener path_listener = {
+                compiled_path_map_changed,
+            };
+            add_path_map_event_listener(&path_listener, NULL);
+        }
+#endif
+        init = 1;
+    }
+#if !defined(SERVICE_Expressions)
+    big_endian = big_endian_host();
+#endif
+    e = (CompiledExpression *)loc_alloc_zero(sizeof(CompiledExpression));
+    e->text = loc_strdup(s);
+    compile_program(e);
+    return e;
+}
+
+int evaluate_compiled_expression(Context * ctx, int frame, CompiledExpression * e, int load, Value * v) {
+    Trap trap;
+#if !defined(SERVICE_Expressions)
+    big_endian = big_endian_host();
+#endif
+    expression_context = ctx;
+    expression_frame = frame;
+    expression_addr = 0;
+    expression_scope = NULL;
+#if ENABLE_Symbols
+    if (ctx != NULL) expression_scope = get_compiled_scope(ctx, frame, e);
+#endif
+    if (e->prog == NULL) {
+        int res = evaluate_script(MODE_NORMAL, e->text, load, v);
+        expression_scope = NULL;
+        return res;
+    }
+    expression_has_func_call = 0;
+    if (set_trap(&trap)) {
+        run_compiled_program(e, v);
+        if (load) load_value(v);
+        clear_trap(&trap);
+    }
+    expression_scope = NULL;
+    if (trap.error) {
+        errno = trap.error;
+        return -1;
+    }
+    return 0;
+}
+
+void free_compiled_expression(CompiledExpression * e) {
+    unsigned i;
+    if (e == NULL) return;
+    for (i = 0; i < COMPILED_EXPRESSION_SCOPES; i++) {
+        clear_compiled_scope(e->scopes + i);
+        loc_free(e->scopes[i].syms);
+    }
+    free_compiled_program(e);
+    loc_free(e->text);
+    loc_free(e);
+}
+
 int value_to_boolean(Value * v, int * res) {
     Trap trap;
     if (!set_trap(&trap)) return -1;
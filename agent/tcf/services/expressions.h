@@ -98,6 +98,25 @@ struct Value {
  */
 extern int evaluate_expression(Context * ctx, int frame, ContextAddress addr, char * s, int load, Value * v);
 
+/*
+ * Compiled expression is intended for expressions that are evaluated many times,
+ * like breakpoint conditions. Expressions that consist of literals, identifiers, arithmetic,
+ * comparison and logical operators are parsed once into a postfix program, other expressions
+ * are parsed on every evaluation. Symbol lookups are done once for a context and frame PC,
+ * later evaluations in same scope re-use resolved symbols.
+ * Resolved symbols are discarded when memory map or path map changes.
+ */
+typedef struct CompiledExpression CompiledExpression;
+
+extern CompiledExpression * compile_expression(const char * s);
+
+/*
+ * Evaluate compiled expression, same as evaluate_expression().
+ */
+extern int evaluate_compiled_expression(Context * ctx, int frame, CompiledExpression * e, int load, Value * v);
+
+extern void free_compiled_expression(CompiledExpression * e);
+
 /*
  * Cast a Value to another type ("boolean" means 0 or 1).
  * Returns 0 if no errors, otherwise returns -1 and sets errno.
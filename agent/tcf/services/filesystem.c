@@ -17,6 +17,11 @@
  * Target service implementation: file system access (TCF name FileSystem)
  */
 
+#if defined(__GNUC__) && !defined(_GNU_SOURCE)
+/* copy_file_range() needs _GNU_SOURCE */
+#  define _GNU_SOURCE
+#endif
+
 #include <tcf/config.h>
 
 #if SERVICE_FileSystem
@@ -46,9 +51,38 @@
 #include <tcf/framework/trace.h>
 #include <tcf/framework/json.h>
 #include <tcf/framework/exceptions.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/errors.h>
 #include <tcf/services/filesystem.h>
 
+#if !defined(USE_copy_file_range)
+#  if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#    define USE_copy_file_range 1
+#  else
+#    define USE_copy_file_range 0
+#  endif
+#endif
+
+#if !defined(USE_sendfile)
+#  if defined(__linux__)
+#    define USE_sendfile 1
+#  else
+#    define USE_sendfile 0
+#  endif
+#endif
+
+#if USE_sendfile
+#  include <sys/sendfile.h>
+#endif
+#if defined(__linux__)
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
+
 #define BUF_SIZE (128 * MEM_USAGE_FACTOR)
+#define COPY_BUF_SIZE (BUF_SIZE * 16)
+#define COPY_CHUNK_SIZE ((int64_t)64 * 1024 * 1024)
+#define READ_STREAM_CHUNK_SIZE (BUF_SIZE * 256)
 #define DIR_BUF_SIZE 64
 
 static const char * FILE_SYSTEM = "FileSystem";
@@ -94,17 +128,57 @@ struct IORequest {
     OpenFileInfo * handle;
     AsyncReqInfo info;
     LINK link_reqs;
+    int splice;             /* File data is read by worker threads a chunk at a time, and spliced into the channel */
+    int stream;             /* FileSystem.readStream: data is sent in progress messages */
+    int splice_fd;
+    int64_t splice_offs;    /* File offset, -1 - read at current file position */
+    int64_t splice_size;    /* Bytes left to send, -1 - until end of file */
+#if ENABLE_Splice
+    int chunk_pipe[2];      /* Pipe that holds the chunk data */
+#else
+    char * chunk_buf;
+#endif
+    size_t chunk_size;
+    int chunk_eof;
 };
 
+/* State of FileSystem.copy, the copy is done by AsyncReqUser requests, one chunk at a time */
+typedef struct CopyInfo {
+    LINK link_all;
+    char token[256];
+    Channel * channel;      /* NULL if the channel is closed */
+    AsyncReqInfo req;
+    char src[FILE_PATH_SIZE];
+    char dst[FILE_PATH_SIZE];
+    int copy_uidgid;
+    int copy_perms;
+    struct stat st;
+    int fi;
+    int fo;
+    int mode;
+    int started;
+    int done;
+    int err;
+    int64_t pos;
+    char * buf;
+} CopyInfo;
+
+#define COPY_MODE_RANGE     0   /* copy_file_range() */
+#define COPY_MODE_SENDFILE  1   /* sendfile() */
+#define COPY_MODE_RW        2   /* read() and write() */
+
+#define out2channel(A)  ((Channel *)((char *)(A) - offsetof(Channel, out)))
 #define hash2file(A)    ((OpenFileInfo *)((char *)(A) - offsetof(OpenFileInfo, link_hash)))
 #define ring2file(A)    ((OpenFileInfo *)((char *)(A) - offsetof(OpenFileInfo, link_ring)))
 #define reqs2req(A)     ((IORequest *)((char *)(A) - offsetof(IORequest, link_reqs)))
+#define all2copy(A)     ((CopyInfo *)((char *)(A) - offsetof(CopyInfo, link_all)))
 
 static unsigned long handle_cnt = 0;
 
 #define HANDLE_HASH_SIZE (4 * MEM_USAGE_FACTOR - 1)
 static LINK handle_hash[HANDLE_HASH_SIZE];
 static LINK file_info_ring = TCF_LIST_INIT(file_info_ring);
+static LINK copy_list = TCF_LIST_INIT(copy_list);
 
 static OpenFileInfo * create_open_file_info(Channel * ch, char * path, int file, DIR * dir) {
     LINK * list_head = NULL;
@@ -157,6 +231,16 @@ static void delete_open_file_info(OpenFileInfo * h) {
 }
 
 static void free_io_req(IORequest * req) {
+    if (req->splice) {
+#if ENABLE_Splice
+        if (req->chunk_pipe[0] > 0) close(req->chunk_pipe[0]);
+        if (req->chunk_pipe[1] > 0) close(req->chunk_pipe[1]);
+#else
+        loc_free(req->chunk_buf);
+#endif
+        loc_free(req);
+        return;
+    }
     switch (req->info.type) {
     case AsyncReqStat:
     case AsyncReqLstat:
@@ -235,6 +319,17 @@ static void channel_close_listener(Channel * c) {
     }
 
     while (!list_is_empty(&list)) delete_open_file_info(hash2file(list.next));
+
+    /* Copy requests are always in flight, they stop after current chunk */
+    list_next = copy_list.next;
+    while (list_next != &copy_list) {
+        CopyInfo * ci = all2copy(list_next);
+        list_next = list_next->next;
+        if (ci->channel == c) {
+            list_remove(&ci->link_all);
+            ci->channel = NULL;
+        }
+    }
 }
 
 static void write_fs_errno(OutputStream * out, int err) {
@@ -731,6 +826,15 @@ static void reply_read(char * token, OutputStream * out, int err, void * buf, si
     write_stream(out, MARKER_EOM);
 }
 
+static void reply_read_stream(char * token, OutputStream * out, int err, int eof) {
+    write_stringz(out, "R");
+    write_stringz(out, token);
+    write_fs_errno(out, err);
+    json_write_boolean(out, eof);
+    write_stream(out, 0);
+    write_stream(out, MARKER_EOM);
+}
+
 static void reply_write(char * token, OutputStream * out, int err) {
     write_stringz(out, "R");
     write_stringz(out, token);
@@ -807,6 +911,21 @@ static void reply_readdir(char * token, OutputStream * out, int err, struct DirF
     write_stream(out, MARKER_EOM);
 }
 
+static void reply_copy(char * token, OutputStream * out, int err) {
+    write_stringz(out, "R");
+    write_stringz(out, token);
+    write_fs_errno(out, err);
+    write_stream(out, MARKER_EOM);
+}
+
+static void reply_copy_progress(char * token, OutputStream * out, int64_t pos) {
+    write_stringz(out, "P");
+    write_stringz(out, token);
+    json_write_int64(out, pos);
+    write_stream(out, 0);
+    write_stream(out, MARKER_EOM);
+}
+
 static void reply_roots(char * token, OutputStream * out, int err, struct RootDevNode * rootlst) {
     FileAttrs attrs;
     int cnt = 0;
@@ -850,7 +969,8 @@ static void terminate_open_file_info(OpenFileInfo * handle) {
         switch (req->info.type) {
         case AsyncReqRead:
         case AsyncReqSeekRead:
-            reply_read(req->token, handle->out, EBADF, NULL, 0, 0);
+            if (req->stream) reply_read_stream(req->token, handle->out, EBADF, 0);
+            else reply_read(req->token, handle->out, EBADF, NULL, 0, 0);
             break;
         case AsyncReqWrite:
         case AsyncReqSeekWrite:
@@ -1014,12 +1134,147 @@ static void done_io_request(void * arg) {
     post_io_request(handle);
 }
 
+/* Read next chunk of file data, called on a worker thread.
+ * With splice() the data is moved into a pipe, and the dispatch thread splices it
+ * from the pipe into the channel, so file I/O never blocks the dispatch thread. */
+static int read_file_chunk(void * args) {
+    IORequest * req = (IORequest *)args;
+    int64_t pos = req->splice_offs;
+    int64_t want = req->splice_size;
+    struct stat st;
+
+    req->chunk_size = 0;
+    req->chunk_eof = 0;
+    if (pos < 0 && (pos = lseek(req->splice_fd, 0, SEEK_CUR)) < 0) return -1;
+    if (fstat(req->splice_fd, &st) < 0) return -1;
+    if (want < 0 || want > (st.st_size > pos ? st.st_size - pos : 0)) {
+        want = st.st_size > pos ? st.st_size - pos : 0;
+        req->chunk_eof = 1;
+    }
+    if (want > READ_STREAM_CHUNK_SIZE) {
+        want = READ_STREAM_CHUNK_SIZE;
+        req->chunk_eof = 0;
+    }
+    while (req->chunk_size < (size_t)want) {
+        size_t size = (size_t)want - req->chunk_size;
+        ssize_t rd = 0;
+#if ENABLE_Splice
+        loff_t offs = pos + req->chunk_size;
+        if (req->chunk_pipe[0] == 0) {
+            if (pipe(req->chunk_pipe) < 0) {
+                req->chunk_pipe[0] = req->chunk_pipe[1] = 0;
+                return -1;
+            }
+#  if defined(F_SETPIPE_SZ)
+            fcntl(req->chunk_pipe[1], F_SETPIPE_SZ, READ_STREAM_CHUNK_SIZE);
+#  endif
+        }
+        /* The pipe is empty, but can be smaller than the chunk: stop when it is full */
+        rd = splice(req->splice_fd, req->splice_offs < 0 ? NULL : &offs,
+            req->chunk_pipe[1], NULL, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (rd < 0 && errno == EAGAIN && req->chunk_size > 0) rd = 0;
+#else
+        if (req->chunk_buf == NULL) req->chunk_buf = (char *)loc_alloc(READ_STREAM_CHUNK_SIZE);
+        if (req->splice_offs < 0) rd = read(req->splice_fd, req->chunk_buf + req->chunk_size, size);
+        else rd = pread(req->splice_fd, req->chunk_buf + req->chunk_size, size, (off_t)(pos + req->chunk_size));
+#endif
+        if (rd < 0) return -1;
+        if (rd == 0) {
+            /* The file was truncated, or the pipe is full */
+            req->chunk_eof = 0;
+            break;
+        }
+        req->chunk_size += rd;
+    }
+    if (req->splice_offs >= 0) req->splice_offs += req->chunk_size;
+    if (req->splice_size > 0) req->splice_size -= req->chunk_size;
+    return 0;
+}
+
+static void post_read_chunk(void * args) {
+    IORequest * req = (IORequest *)args;
+
+    if (req->handle == NULL) {
+        /* Abandoned I/O request, channel is already closed */
+        close(req->splice_fd);
+        free_io_req(req);
+        return;
+    }
+    async_req_post(&req->info);
+}
+
+static void done_read_chunk(void * arg) {
+    IORequest * req = (IORequest *)((AsyncReqInfo *)arg)->client_data;
+    OpenFileInfo * handle = req->handle;
+    int err = req->info.error;
+    int eof = req->chunk_eof;
+
+    if (handle == NULL) {
+        post_read_chunk(req);
+        return;
+    }
+
+    if (!err && (!req->stream || req->chunk_size > 0)) {
+        Trap trap;
+        OutputStream * out = handle->out;
+        if (set_trap(&trap)) {
+            write_stringz(out, req->stream ? "P" : "R");
+            write_stringz(out, req->token);
+#if ENABLE_Splice
+            json_splice_binary(out, req->chunk_pipe[0], req->chunk_size);
+#else
+            json_write_binary(out, req->chunk_buf, req->chunk_size);
+#endif
+            write_stream(out, 0);
+            if (!req->stream) {
+                write_fs_errno(out, 0);
+                json_write_boolean(out, eof);
+                write_stream(out, 0);
+            }
+            write_stream(out, MARKER_EOM);
+            clear_trap(&trap);
+        }
+        else {
+            /* The message is partially written, the channel cannot be used anymore */
+            trace(LOG_ALWAYS, "Cannot read file FS%lu: %s", handle->handle, errno_to_str(trap.error));
+            channel_close(out2channel(out));
+            err = trap.error;
+        }
+    }
+
+    if (req->stream && !err && !eof && req->chunk_size > 0 && req->splice_size != 0) {
+        /* Wait until the client consumes already queued data */
+        channel_wait_out_ready(out2channel(handle->out), post_read_chunk, req);
+        return;
+    }
+    if (req->stream) reply_read_stream(req->token, handle->out, err, eof);
+    else if (err) reply_read(req->token, handle->out, err, NULL, 0, 0);
+
+    assert(handle->posted_req == req);
+    handle->posted_req = NULL;
+    list_remove(&req->link_reqs);
+    free_io_req(req);
+    post_io_request(handle);
+}
+
+static void init_read_chunk(IORequest * req, int fd, int64_t offset, int64_t size) {
+    req->splice = 1;
+    req->splice_fd = fd;
+    req->splice_offs = offset < 0 ? -1 : offset;
+    req->splice_size = size < 0 ? -1 : size;
+    req->info.type = AsyncReqUser;
+    req->info.done = done_read_chunk;
+    req->info.u.user.func = read_file_chunk;
+    req->info.u.user.data = req;
+}
+
 static void post_io_request(OpenFileInfo * handle) {
     if (handle->posted_req == NULL && !list_is_empty(&handle->link_reqs)) {
         LINK * link = handle->link_reqs.next;
         IORequest * req = reqs2req(link);
         handle->posted_req = req;
-        async_req_post(&req->info);
+        if (req->splice) channel_wait_out_ready(out2channel(handle->out), post_read_chunk, req);
+        else async_req_post(&req->info);
     }
 }
 
@@ -1059,6 +1314,13 @@ static void command_close(char * token, Channel * c) {
     }
 }
 
+static int can_splice_file(OpenFileInfo * h) {
+    struct stat st;
+    if (!h->out->supports_zero_copy) return 0;
+    if (h->file < 0 || fstat(h->file, &st) < 0) return 0;
+    return S_ISREG(st.st_mode);
+}
+
 static void command_read(char * token, Channel * c) {
     char id[256];
     OpenFileInfo * h;
@@ -1079,13 +1341,49 @@ static void command_read(char * token, Channel * c) {
     }
     else {
         IORequest * req = create_io_request(token, h, AsyncReqRead);
-        if (offset >= 0) {
-            req->info.type = AsyncReqSeekRead;
-            req->info.u.fio.offset = offset;
+        if (len <= READ_STREAM_CHUNK_SIZE && can_splice_file(h)) {
+            init_read_chunk(req, h->file, offset, len);
+        }
+        else {
+            if (offset >= 0) {
+                req->info.type = AsyncReqSeekRead;
+                req->info.u.fio.offset = offset;
+            }
+            req->info.u.fio.fd = h->file;
+            req->info.u.fio.bufp = loc_alloc(len);
+            req->info.u.fio.bufsz = len;
         }
-        req->info.u.fio.fd = h->file;
-        req->info.u.fio.bufp = loc_alloc(len);
-        req->info.u.fio.bufsz = len;
+        post_io_request(h);
+    }
+}
+
+static void command_read_stream(char * token, Channel * c) {
+    char id[256];
+    OpenFileInfo * h;
+    int64_t offset;
+    int64_t size;
+    struct stat st;
+
+    json_read_string(&c->inp, id, sizeof(id));
+    json_test_char(&c->inp, MARKER_EOA);
+    offset = json_read_int64(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    size = json_read_int64(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+
+    h = find_open_file_info(id);
+    if (h == NULL || h->file < 0) {
+        reply_read_stream(token, &c->out, EBADF, 0);
+    }
+    else if (fstat(h->file, &st) < 0 || !S_ISREG(st.st_mode)) {
+        /* Size of the data must be known before it is sent */
+        reply_read_stream(token, &c->out, ERR_UNSUPPORTED, 0);
+    }
+    else {
+        IORequest * req = create_io_request(token, h, AsyncReqRead);
+        init_read_chunk(req, h->file, offset, size);
+        req->stream = 1;
         post_io_request(h);
     }
 }
@@ -1485,73 +1783,153 @@ static void command_symlink(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
-static void command_copy(char * token, Channel * c) {
-    char src[FILE_PATH_SIZE];
-    char dst[FILE_PATH_SIZE];
-    int copy_uidgid;
-    int copy_perms;
-    struct stat st;
-    int fi = -1;
-    int fo = -1;
-    int err = 0;
-    int64_t pos = 0;
-
-    read_path(&c->inp, src, sizeof(src));
-    json_test_char(&c->inp, MARKER_EOA);
-    read_path(&c->inp, dst, sizeof(dst));
-    json_test_char(&c->inp, MARKER_EOA);
-    copy_uidgid = json_read_boolean(&c->inp);
-    json_test_char(&c->inp, MARKER_EOA);
-    copy_perms = json_read_boolean(&c->inp);
-    json_test_char(&c->inp, MARKER_EOA);
-    json_test_char(&c->inp, MARKER_EOM);
-
-    if (stat(src, &st) < 0) err = errno;
-    if (err == 0 && (fi = open(src, O_RDONLY | O_BINARY, 0)) < 0) err = errno;
-    if (err == 0 && (fo = open(dst, O_WRONLY | O_BINARY | O_CREAT, 0775)) < 0) err = errno;
-
-    while (err == 0 && pos < st.st_size) {
-        char buf[BUF_SIZE];
-        ssize_t wr;
-        ssize_t rd = read(fi, buf, sizeof(buf));
-        if (rd == 0) break;
-        if (rd < 0) {
-            err = errno;
+/* Copy next chunk of a file, called on a worker thread */
+static int copy_file_chunk(void * args) {
+    CopyInfo * ci = (CopyInfo *)args;
+    int64_t end = ci->pos + COPY_CHUNK_SIZE;
+    int eof = 0;
+
+    if (!ci->started) {
+        ci->started = 1;
+        if (stat(ci->src, &ci->st) < 0) ci->err = errno;
+        if (ci->err == 0 && (ci->fi = open(ci->src, O_RDONLY | O_BINARY, 0)) < 0) ci->err = errno;
+        if (ci->err == 0 && (ci->fo = open(ci->dst, O_WRONLY | O_BINARY | O_CREAT, 0775)) < 0) ci->err = errno;
+#if defined(FICLONE)
+        if (ci->err == 0 && ci->st.st_size > 0) {
+            /* Share data blocks if the file system supports it. Only into an empty file,
+             * otherwise the result would differ from a copy over existing data. */
+            struct stat st;
+            if (fstat(ci->fo, &st) == 0 && st.st_size == 0 && ioctl(ci->fo, FICLONE, ci->fi) == 0) {
+                ci->pos = ci->st.st_size;
+            }
+        }
+#endif
+    }
+    if (end > ci->st.st_size) end = ci->st.st_size;
+
+    while (ci->err == 0 && ci->pos < end) {
+        size_t size = (size_t)(end - ci->pos);
+        ssize_t rd = 0;
+        switch (ci->mode) {
+#if USE_copy_file_range
+        case COPY_MODE_RANGE:
+            rd = copy_file_range(ci->fi, NULL, ci->fo, NULL, size, 0);
+            if (rd < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                ci->mode = COPY_MODE_SENDFILE;
+                continue;
+            }
+            break;
+#endif
+#if USE_sendfile
+        case COPY_MODE_SENDFILE:
+            rd = sendfile(ci->fo, ci->fi, NULL, size);
+            if (rd < 0 && (errno == ENOSYS || errno == EINVAL)) {
+                ci->mode = COPY_MODE_RW;
+                continue;
+            }
+            break;
+#endif
+        default:
+            {
+                ssize_t wr;
+                if (ci->buf == NULL) ci->buf = (char *)loc_alloc(COPY_BUF_SIZE);
+                if (size > COPY_BUF_SIZE) size = COPY_BUF_SIZE;
+                rd = read(ci->fi, ci->buf, size);
+                if (rd <= 0) break;
+                wr = write(ci->fo, ci->buf, rd);
+                if (wr < 0) {
+                    ci->err = errno;
+                    break;
+                }
+                if (wr < rd) ci->err = ENOSPC;
+            }
             break;
         }
-        wr = write(fo, buf, rd);
-        if (wr < 0) {
-            err = errno;
+        if (ci->err) break;
+        if (rd == 0) {
+            eof = 1;
             break;
         }
-        if (wr < rd) {
-            err = ENOSPC;
+        if (rd < 0) {
+            ci->err = errno;
             break;
         }
-        pos += rd;
+        ci->pos += rd;
     }
 
-    if (fo >= 0 && close(fo) < 0 && err == 0) err = errno;
-    if (fi >= 0 && close(fi) < 0 && err == 0) err = errno;
+    if (ci->err == 0 && !eof && ci->pos < ci->st.st_size) return 0;
 
-    if (err == 0) {
+    if (ci->fo >= 0 && close(ci->fo) < 0 && ci->err == 0) ci->err = errno;
+    if (ci->fi >= 0 && close(ci->fi) < 0 && ci->err == 0) ci->err = errno;
+    ci->fo = ci->fi = -1;
+
+    if (ci->err == 0) {
         struct utimbuf buf;
-        buf.actime = st.st_atime;
-        buf.modtime = st.st_mtime;
-        if (utime(dst, &buf) < 0) err = errno;
+        buf.actime = ci->st.st_atime;
+        buf.modtime = ci->st.st_mtime;
+        if (utime(ci->dst, &buf) < 0) ci->err = errno;
     }
-    if (err == 0 && copy_perms && chmod(dst, st.st_mode) < 0) err = errno;
+    if (ci->err == 0 && ci->copy_perms && chmod(ci->dst, ci->st.st_mode) < 0) ci->err = errno;
 #if !defined(_WIN32) && !defined(_WRS_KERNEL)
-    if (err == 0 && copy_uidgid && chown(dst, st.st_uid, st.st_gid) < 0) err = errno;
+    if (ci->err == 0 && ci->copy_uidgid && chown(ci->dst, ci->st.st_uid, ci->st.st_gid) < 0) ci->err = errno;
+#endif
+    ci->done = 1;
+    return 0;
+}
+
+static void done_copy_chunk(void * arg) {
+    CopyInfo * ci = (CopyInfo *)((AsyncReqInfo *)arg)->client_data;
+
+    if (ci->channel != NULL) {
+        if (!ci->done) {
+            /* Report progress and copy next chunk */
+            reply_copy_progress(ci->token, &ci->channel->out, ci->pos);
+            async_req_post(&ci->req);
+            return;
+        }
+        reply_copy(ci->token, &ci->channel->out, ci->err);
+        list_remove(&ci->link_all);
+    }
+    if (ci->fo >= 0) close(ci->fo);
+    if (ci->fi >= 0) close(ci->fi);
+    loc_free(ci->buf);
+    loc_free(ci);
+}
+
+static void command_copy(char * token, Channel * c) {
+    CopyInfo * ci = (CopyInfo *)loc_alloc_zero(sizeof(CopyInfo));
+
+    read_path(&c->inp, ci->src, sizeof(ci->src));
+    json_test_char(&c->inp, MARKER_EOA);
+    read_path(&c->inp, ci->dst, sizeof(ci->dst));
+    json_test_char(&c->inp, MARKER_EOA);
+    ci->copy_uidgid = json_read_boolean(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    ci->copy_perms = json_read_boolean(&c->inp);
+    json_test_char(&c->inp, MARKER_EOA);
+    json_test_char(&c->inp, MARKER_EOM);
+
+    ci->fi = -1;
+    ci->fo = -1;
+#if USE_copy_file_range
+    ci->mode = COPY_MODE_RANGE;
+#elif USE_sendfile
+    ci->mode = COPY_MODE_SENDFILE;
 #else
-    /* disable "set but not used" warning */
-    (void)copy_uidgid;
+    ci->mode = COPY_MODE_RW;
 #endif
 
-    write_stringz(&c->out, "R");
-    write_stringz(&c->out, token);
-    write_fs_errno(&c->out, err);
-    write_stream(&c->out, MARKER_EOM);
+    /* The copy runs on worker threads, a chunk at a time, so the dispatch thread is not blocked.
+     * If the channel is closed, the copy stops after current chunk. */
+    strlcpy(ci->token, token, sizeof(ci->token));
+    ci->channel = c;
+    ci->req.type = AsyncReqUser;
+    ci->req.done = done_copy_chunk;
+    ci->req.client_data = ci;
+    ci->req.u.user.func = copy_file_chunk;
+    ci->req.u.user.data = ci;
+    list_add_last(&ci->link_all, &copy_list);
+    async_req_post(&ci->req);
 }
 
 static void command_user(char * token, Channel * c) {
@@ -1596,6 +1974,7 @@ void ini_file_system_service(Protocol * proto) {
     add_command_handler(proto, FILE_SYSTEM, "open", command_open);
     add_command_handler(proto, FILE_SYSTEM, "close", command_close);
     add_command_handler(proto, FILE_SYSTEM, "read", command_read);
+    add_command_handler(proto, FILE_SYSTEM, "readStream", command_read_stream);
     add_command_handler(proto, FILE_SYSTEM, "write", command_write);
     add_command_handler(proto, FILE_SYSTEM, "stat", command_stat);
     add_command_handler(proto, FILE_SYSTEM, "lstat", command_lstat);
@@ -302,24 +302,22 @@ int line_to_address(Context * ctx, const char * file_name, int line, int column,
             if (file == NULL) continue;
             if (set_trap(&trap)) {
                 DWARFCache * cache = get_dwarf_cache(get_dwarf_file(file));
-                if (!cache->mLineInfoLoaded) {
-                    for (j = 0; j < file->section_cnt; j++) {
-                        ObjectInfo * info = cache->mObjectHashTable[j].mCompUnits;
-                        while (info != NULL) {
-                            CompUnit * unit = info->mCompUnit;
-                            if (!unit->mLineInfoLoaded) load_line_numbers(unit);
-                            info = info->mSibling;
-                        }
+                if (fnm == NULL) {
+                    fnm = canonic_path_map_file_name(file_name);
+                    LINE_TO_ADDR_HOOK_1
+                    h = calc_file_name_hash(fnm);
+                }
+                /* Load line numbers only for units that reference a file with same name hash */
+                for (j = 0; j < file->section_cnt; j++) {
+                    ObjectInfo * info = cache->mObjectHashTable[j].mCompUnits;
+                    while (info != NULL) {
+                        CompUnit * unit = info->mCompUnit;
+                        if (!unit->mLineInfoLoaded && has_line_file_name_hash(unit, h)) load_line_numbers(unit);
+                        info = get_dwarf_sibling(info);
                     }
-                    cache->mLineInfoLoaded = 1;
                 }
                 if (cache->mFileInfoHash) {
                     FileInfo * f = NULL;
-                    if (fnm == NULL) {
-                        fnm = canonic_path_map_file_name(file_name);
-                        LINE_TO_ADDR_HOOK_1
-                        h = calc_file_name_hash(fnm);
-                    }
                     LINE_TO_ADDR_HOOK_BP
                     f = cache->mFileInfoHash[h % cache->mFileInfoHashSize];
                     while (f != NULL) {
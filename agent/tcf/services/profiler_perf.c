@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Wind River Systems, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Wind River Systems - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Profiling samples source based on Linux perf_event_open().
+ */
+
+#include <tcf/config.h>
+
+#if ENABLE_ProfilerPerf
+
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/events.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/trace.h>
+#include <tcf/services/profiler_perf.h>
+
+struct ProfilerPerf {
+    Context * ctx;
+    int fd;
+    struct perf_event_mmap_page * page;
+    size_t mmap_size;
+    uint8_t * data;
+    uint64_t data_size;
+    ProfilerPerfCallBack * callback;
+    void * args;
+    uint8_t * rec_buf;
+    size_t rec_max;
+    ContextAddress * stk_buf;
+    unsigned stk_max;
+};
+
+static void read_ring_buffer(ProfilerPerf * perf, uint64_t pos, void * buf, size_t size) {
+    size_t offs = (size_t)(pos & (perf->data_size - 1));
+    size_t n = (size_t)perf->data_size - offs;
+    if (n >= size) {
+        memcpy(buf, perf->data + offs, size);
+    }
+    else {
+        /* Record wraps around the end of the buffer */
+        memcpy(buf, perf->data + offs, n);
+        memcpy((uint8_t *)buf + n, perf->data, size - n);
+    }
+}
+
+static void read_sample(ProfilerPerf * perf, uint8_t * rec, size_t size) {
+    unsigned i;
+    unsigned stk_len = 0;
+    uint64_t ip = 0;
+    uint64_t nr = 0;
+    uint64_t * ips = NULL;
+    size_t pos = sizeof(struct perf_event_header);
+
+    if (pos + sizeof(ip) > size) return;
+    memcpy(&ip, rec + pos, sizeof(ip));
+    pos += sizeof(ip);
+    if (pos + sizeof(nr) <= size) {
+        memcpy(&nr, rec + pos, sizeof(nr));
+        pos += sizeof(nr);
+        if (nr > (size - pos) / sizeof(uint64_t)) nr = 0;
+        ips = (uint64_t *)(rec + pos);
+    }
+    if (nr > perf->stk_max) {
+        perf->stk_max = (unsigned)nr;
+        perf->stk_buf = (ContextAddress *)loc_realloc(perf->stk_buf, sizeof(ContextAddress) * perf->stk_max);
+    }
+    for (i = 0; i < nr; i++) {
+        uint64_t addr = ips[i];
+        /* Skip PERF_CONTEXT_* markers and the sampled PC itself */
+        if (addr >= (uint64_t)PERF_CONTEXT_MAX) continue;
+        if (stk_len == 0 && addr == ip) continue;
+        perf->stk_buf[stk_len++] = (ContextAddress)addr;
+    }
+    perf->callback(perf->args, (ContextAddress)ip, perf->stk_buf, stk_len);
+}
+
+void profiler_perf_poll(ProfilerPerf * perf) {
+    uint64_t head = __atomic_load_n(&perf->page->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = perf->page->data_tail;
+
+    while (tail < head) {
+        struct perf_event_header hdr;
+        read_ring_buffer(perf, tail, &hdr, sizeof(hdr));
+        if (hdr.size < sizeof(hdr) || hdr.size > head - tail) break;
+        if (hdr.type == PERF_RECORD_SAMPLE) {
+            if (hdr.size > perf->rec_max) {
+                perf->rec_max = hdr.size;
+                perf->rec_buf = (uint8_t *)loc_realloc(perf->rec_buf, perf->rec_max);
+            }
+            read_ring_buffer(perf, tail, perf->rec_buf, hdr.size);
+            read_sample(perf, perf->rec_buf, hdr.size);
+        }
+        else if (hdr.type == PERF_RECORD_LOST) {
+            trace(LOG_CONTEXT, "perf: ctx %s, lost profiler samples", perf->ctx->id);
+        }
+        tail += hdr.size;
+    }
+    __atomic_store_n(&perf->page->data_tail, head, __ATOMIC_RELEASE);
+}
+
+static void perf_timer_event(void * args) {
+    ProfilerPerf * perf = (ProfilerPerf *)args;
+    profiler_perf_poll(perf);
+    post_event_with_delay(perf_timer_event, perf, PROFILER_PERF_POLL_PERIOD);
+}
+
+ProfilerPerf * profiler_perf_open(Context * ctx, int call_chain, ProfilerPerfCallBack * callback, void * args) {
+    struct perf_event_attr attr;
+    ProfilerPerf * perf = NULL;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    pid_t pid = id2pid(ctx->id, NULL);
+    int fd = -1;
+    void * ptr = NULL;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.sample_period = PROFILER_PERF_SAMPLE_PERIOD;
+    attr.sample_type = PERF_SAMPLE_IP;
+    if (call_chain) attr.sample_type |= PERF_SAMPLE_CALLCHAIN;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+
+    fd = (int)syscall(__NR_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) {
+        int error = errno;
+        trace(LOG_CONTEXT, "perf: ctx %s, cannot open perf event: %s", ctx->id, errno_to_str(error));
+        errno = error;
+        return NULL;
+    }
+    ptr = mmap(NULL, (PROFILER_PERF_BUFFER_PAGES + 1) * page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        int error = errno;
+        trace(LOG_CONTEXT, "perf: ctx %s, cannot map perf buffer: %s", ctx->id, errno_to_str(error));
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+
+    perf = (ProfilerPerf *)loc_alloc_zero(sizeof(ProfilerPerf));
+    perf->ctx = ctx;
+    perf->fd = fd;
+    perf->page = (struct perf_event_mmap_page *)ptr;
+    perf->mmap_size = (PROFILER_PERF_BUFFER_PAGES + 1) * page_size;
+    perf->data = (uint8_t *)ptr + page_size;
+    perf->data_size = PROFILER_PERF_BUFFER_PAGES * page_size;
+    perf->callback = callback;
+    perf->args = args;
+    context_lock(ctx);
+    post_event_with_delay(perf_timer_event, perf, PROFILER_PERF_POLL_PERIOD);
+    trace(LOG_CONTEXT, "perf: ctx %s, sampling started", ctx->id);
+    return perf;
+}
+
+void profiler_perf_close(ProfilerPerf * perf) {
+    cancel_event(perf_timer_event, perf, 0);
+    munmap(perf->page, perf->mmap_size);
+    close(perf->fd);
+    context_unlock(perf->ctx);
+    loc_free(perf->rec_buf);
+    loc_free(perf->stk_buf);
+    loc_free(perf);
+}
+
+#endif /* ENABLE_ProfilerPerf */
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Wind River Systems, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Wind River Systems - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Profiling samples source based on Linux perf_event_open().
+ *
+ * The kernel samples a thread on its task clock and records the PC and the user call chain
+ * into a ring buffer, so the thread is not stopped. The buffer is drained periodically
+ * on the dispatch thread. Call chains are collected by the kernel using frame pointers,
+ * so they are used only if PROFILER_PERF_CALL_CHAINS is enabled.
+ */
+
+#ifndef D_profiler_perf
+#define D_profiler_perf
+
+#include <tcf/config.h>
+
+#if ENABLE_ProfilerPerf
+
+#include <tcf/framework/context.h>
+
+#ifndef PROFILER_PERF_SAMPLE_PERIOD
+/* Sample period in nanoseconds of thread CPU time */
+#  define PROFILER_PERF_SAMPLE_PERIOD 1000000
+#endif
+
+#ifndef PROFILER_PERF_POLL_PERIOD
+/* Period in microseconds of reading samples from the ring buffer */
+#  define PROFILER_PERF_POLL_PERIOD 100000
+#endif
+
+#ifndef PROFILER_PERF_CALL_CHAINS
+/* Use perf events for hierarchical profiling too. The kernel unwinds user stacks by
+ * frame pointers, which gives wrong callers for code built without them, so by default
+ * stack traces are collected by stopping the thread and unwinding with CFI. */
+#  define PROFILER_PERF_CALL_CHAINS 0
+#endif
+
+#ifndef PROFILER_PERF_BUFFER_PAGES
+/* Ring buffer size in pages, must be power of 2 */
+#  define PROFILER_PERF_BUFFER_PAGES 64
+#endif
+
+typedef struct ProfilerPerf ProfilerPerf;
+
+/*
+ * Sample call-back: 'pc' is the sampled PC, 'stk' is array of return addresses of caller frames.
+ */
+typedef void ProfilerPerfCallBack(void * args, ContextAddress pc, ContextAddress * stk, unsigned stk_len);
+
+/*
+ * Start sampling of thread 'ctx'.
+ * Return NULL and set errno if perf events are not available.
+ */
+extern ProfilerPerf * profiler_perf_open(Context * ctx, int call_chain, ProfilerPerfCallBack * callback, void * args);
+
+/* Pass all samples collected so far to the call-back */
+extern void profiler_perf_poll(ProfilerPerf * perf);
+
+/* Stop sampling and dispose the sampler */
+extern void profiler_perf_close(ProfilerPerf * perf);
+
+#endif /* ENABLE_ProfilerPerf */
+
+#endif /* D_profiler_perf */
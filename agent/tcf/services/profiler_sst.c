@@ -29,40 +29,54 @@
 #include <tcf/services/stacktrace.h>
 #include <tcf/services/profiler.h>
 #include <tcf/services/profiler_sst.h>
+#include <tcf/services/profiler_perf.h>
 
-typedef struct SampleStackTrace {
-    struct SampleStackTrace * next;
+/*
+ * Stack traces are interned as nodes of a call tree: a node is a caller PC and its parent
+ * node is the rest of the stack trace, up to the outermost frame.
+ * Node index 0 is the empty stack trace.
+ */
+typedef struct {
+    ContextAddress pc;
+    unsigned parent;
     unsigned len;
-    ContextAddress pc[1];
 } SampleStackTrace;
 
 typedef struct {
     ContextAddress pc;
-    SampleStackTrace * stk;
+    unsigned stk;
     unsigned cnt;
 } ProfilerSample;
 
+/* Open addressing hash table of array indices, 0 means empty slot */
 typedef struct {
-    ProfilerSample * buf;
-    unsigned buf_pos;
-    unsigned buf_max;
-} ProfilerSampleArray;
+    unsigned * buf;
+    unsigned size;
+} ProfilerHashTable;
 
-#define PSAMPLE_HASH_SIZE 511
-#define STRACE_HASH_SIZE 511
+#define PROFILER_HASH_MIN_SIZE 256
 
 typedef struct ProfilerSST {
     LINK link_core;
     Context * ctx;
     Channel * channel;
     unsigned frame_cnt;
-    ProfilerSampleArray psample_hash[PSAMPLE_HASH_SIZE];
+    ProfilerSample * psample_buf;
+    unsigned psample_pos;
+    unsigned psample_max;
+    ProfilerHashTable psample_hash;
     unsigned psample_cnt;
-    SampleStackTrace * strace_hash[STRACE_HASH_SIZE];
+    SampleStackTrace * strace_buf;
+    unsigned strace_pos;
+    unsigned strace_max;
+    ProfilerHashTable strace_hash;
     int stop_pending;
     ContextAddress pc;
     int disposed;
     int lock;
+#if ENABLE_ProfilerPerf
+    ProfilerPerf * perf;
+#endif
 } ProfilerSST;
 
 typedef struct {
@@ -102,54 +116,126 @@ static void get_stack_trace(ProfilerSST * prf) {
     }
 }
 
-static SampleStackTrace * find_stack_trace(ProfilerSST * prf) {
-    SampleStackTrace * stk = NULL;
-    if (stk_buf_pos > 0) {
-        unsigned i = 0;
-        unsigned h = 0;
-        for (i = 0; i < stk_buf_pos; i++) {
-            h = (h + (unsigned)(stk_buf[i] >> 4)) % STRACE_HASH_SIZE;
-        }
-        stk = prf->strace_hash[h];
-        while (stk != NULL) {
-            if (stk->len == stk_buf_pos && memcmp(stk->pc, stk_buf, stk_buf_pos * sizeof(ContextAddress)) == 0) {
-                return stk;
-            }
-            stk = stk->next;
-        }
-        stk = (SampleStackTrace *)loc_alloc_zero(sizeof(SampleStackTrace) + sizeof(ContextAddress) * (stk_buf_pos - 1));
-        memcpy(stk->pc, stk_buf, stk_buf_pos * sizeof(ContextAddress));
-        stk->next = prf->strace_hash[h];
-        prf->strace_hash[h] = stk;
-        stk->len = stk_buf_pos;
+static unsigned hash_key(ContextAddress pc, unsigned n) {
+    uint64_t x = (uint64_t)pc ^ ((uint64_t)n << 32 | n);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (unsigned)x;
+}
+
+static int hash_table_full(ProfilerHashTable * hash, unsigned cnt) {
+    /* Keep load factor below 1/2 */
+    return cnt * 2 >= hash->size;
+}
+
+static void hash_table_init(ProfilerHashTable * hash, unsigned cnt) {
+    unsigned size = PROFILER_HASH_MIN_SIZE;
+    while (size <= cnt * 2) size *= 2;
+    loc_free(hash->buf);
+    hash->buf = (unsigned *)loc_alloc_zero(sizeof(unsigned) * size);
+    hash->size = size;
+}
+
+static void hash_table_add(ProfilerHashTable * hash, unsigned h, unsigned idx) {
+    unsigned mask = hash->size - 1;
+    while (hash->buf[h & mask] != 0) h++;
+    hash->buf[h & mask] = idx;
+}
+
+static void rehash_stack_traces(ProfilerSST * prf) {
+    unsigned i;
+    hash_table_init(&prf->strace_hash, prf->strace_pos);
+    for (i = 1; i < prf->strace_pos; i++) {
+        SampleStackTrace * t = prf->strace_buf + i;
+        hash_table_add(&prf->strace_hash, hash_key(t->pc, t->parent), i);
+    }
+}
+
+static unsigned find_stack_trace_node(ProfilerSST * prf, unsigned parent, ContextAddress pc) {
+    unsigned h = hash_key(pc, parent);
+    unsigned mask = prf->strace_hash.size - 1;
+    SampleStackTrace * t = NULL;
+    unsigned idx;
+
+    for (;;) {
+        idx = prf->strace_hash.buf[h & mask];
+        if (idx == 0) break;
+        t = prf->strace_buf + idx;
+        if (t->pc == pc && t->parent == parent) return idx;
+        h++;
+    }
+    if (prf->strace_pos >= prf->strace_max) {
+        prf->strace_max = prf->strace_max == 0 ? 256 : prf->strace_max * 2;
+        prf->strace_buf = (SampleStackTrace *)loc_realloc(prf->strace_buf, sizeof(SampleStackTrace) * prf->strace_max);
+    }
+    idx = prf->strace_pos++;
+    t = prf->strace_buf + idx;
+    t->pc = pc;
+    t->parent = parent;
+    t->len = parent == 0 ? 1 : prf->strace_buf[parent].len + 1;
+    prf->strace_hash.buf[h & mask] = idx;
+    if (hash_table_full(&prf->strace_hash, prf->strace_pos)) rehash_stack_traces(prf);
+    return idx;
+}
+
+static unsigned find_stack_trace(ProfilerSST * prf) {
+    unsigned stk = 0;
+    unsigned i = stk_buf_pos;
+    if (prf->strace_hash.buf == NULL) {
+        /* Index 0 is reserved for the empty stack trace */
+        prf->strace_pos = 1;
+        rehash_stack_traces(prf);
+    }
+    /* Insert from the outermost frame, so stack traces share common callers */
+    while (i > 0) {
+        i--;
+        stk = find_stack_trace_node(prf, stk, stk_buf[i]);
     }
     return stk;
 }
 
-static void add_to_sample_array(ProfilerSST * prf, ContextAddress pc, SampleStackTrace * stk) {
+static void rehash_samples(ProfilerSST * prf) {
     unsigned i;
-    unsigned h = (unsigned)(pc >> 4) % PSAMPLE_HASH_SIZE;
-    ProfilerSampleArray * a = prf->psample_hash + h;
+    hash_table_init(&prf->psample_hash, prf->psample_pos);
+    for (i = 0; i < prf->psample_pos; i++) {
+        ProfilerSample * s = prf->psample_buf + i;
+        hash_table_add(&prf->psample_hash, hash_key(s->pc, s->stk), i + 1);
+    }
+}
+
+static void add_to_sample_array(ProfilerSST * prf, ContextAddress pc, unsigned stk) {
+    unsigned h = hash_key(pc, stk);
+    unsigned mask = 0;
     ProfilerSample * s = NULL;
-    for (i = 0; i < a->buf_pos; i++) {
-        ProfilerSample * p = a->buf + i;
-        if (p->pc == pc && p->stk == stk) {
-            s = p;
-            break;
+    unsigned idx;
+
+    if (prf->psample_hash.buf == NULL) rehash_samples(prf);
+    mask = prf->psample_hash.size - 1;
+    for (;;) {
+        idx = prf->psample_hash.buf[h & mask];
+        if (idx == 0) break;
+        s = prf->psample_buf + idx - 1;
+        if (s->pc == pc && s->stk == stk) {
+            s->cnt++;
+            return;
         }
+        h++;
     }
-    if (s == NULL) {
-        if (a->buf_pos >= a->buf_max) {
-            a->buf = (ProfilerSample *)loc_realloc(a->buf, sizeof(ProfilerSample) * (a->buf_max += 64));
-        }
-        s = a->buf + a->buf_pos++;
-        prf->psample_cnt += 3;
-        if (stk != NULL) prf->psample_cnt += stk->len;
-        s->pc = pc;
-        s->stk = stk;
-        s->cnt = 0;
+    if (prf->psample_pos >= prf->psample_max) {
+        prf->psample_max = prf->psample_max == 0 ? 256 : prf->psample_max * 2;
+        prf->psample_buf = (ProfilerSample *)loc_realloc(prf->psample_buf, sizeof(ProfilerSample) * prf->psample_max);
     }
-    s->cnt++;
+    s = prf->psample_buf + prf->psample_pos++;
+    s->pc = pc;
+    s->stk = stk;
+    s->cnt = 1;
+    prf->psample_hash.buf[h & mask] = prf->psample_pos;
+    prf->psample_cnt += 3;
+    if (stk != 0) prf->psample_cnt += prf->strace_buf[stk].len;
+    if (hash_table_full(&prf->psample_hash, prf->psample_pos)) rehash_samples(prf);
 }
 
 static void add_sample_cache_client(void * x) {
@@ -171,8 +257,7 @@ static void add_sample_cache_client(void * x) {
     }
     cache_exit();
     if (error == 0 && !prf->disposed && !prf->stop_pending) {
-        SampleStackTrace * stk = find_stack_trace(prf);
-        add_to_sample_array(prf, prf->pc, stk);
+        add_to_sample_array(prf, prf->pc, find_stack_trace(prf));
     }
     prf->lock--;
     if (prf->disposed && prf->lock == 0) loc_free(prf);
@@ -193,7 +278,16 @@ static void add_sample(ProfilerSST * prf) {
 
 int profiler_sst_is_enabled(Context * ctx) {
     ContextExtensionPrfSST * ext = EXT(ctx);
+#if ENABLE_ProfilerPerf
+    LINK * l;
+    for (l = ext->list.next; l != &ext->list; l = l->next) {
+        /* Profilers that use perf events don't need the context to be stopped */
+        if (link_core2prf(l)->perf == NULL) return 1;
+    }
+    return 0;
+#else
     return !list_is_empty(&ext->list);
+#endif
 }
 
 void profiler_sst_sample(Context * ctx, ContextAddress pc) {
@@ -201,9 +295,12 @@ void profiler_sst_sample(Context * ctx, ContextAddress pc) {
     ContextExtensionPrfSST * ext = EXT(ctx);
     for (l = ext->list.next; l != &ext->list; l = l->next) {
         ProfilerSST * prf = link_core2prf(l);
+#if ENABLE_ProfilerPerf
+        if (prf->perf != NULL) continue;
+#endif
         if (prf->frame_cnt <= 1) {
             /* Shortcut for non-hierarchical profiling */
-            if (prf->frame_cnt > 0) add_to_sample_array(prf, pc, NULL);
+            if (prf->frame_cnt > 0) add_to_sample_array(prf, pc, 0);
             continue;
         }
         prf->pc = pc;
@@ -212,20 +309,16 @@ void profiler_sst_sample(Context * ctx, ContextAddress pc) {
 }
 
 static void free_buffers(ProfilerSST * prf) {
-    unsigned i;
+    /* Keep allocated memory, next read period likely needs similar amount */
     assert(!prf->disposed);
-    for (i = 0; i < PSAMPLE_HASH_SIZE; i++) {
-        loc_free(prf->psample_hash[i].buf);
-    }
-    memset(prf->psample_hash, 0, sizeof(prf->psample_hash));
+    prf->psample_pos = 0;
     prf->psample_cnt = 0;
-    for (i = 0; i < STRACE_HASH_SIZE; i++) {
-        SampleStackTrace * s = prf->strace_hash[i];
-        while (s != NULL) {
-            prf->strace_hash[i] = s->next;
-            loc_free(s);
-            s = prf->strace_hash[i];
-        }
+    if (prf->psample_hash.buf != NULL) {
+        memset(prf->psample_hash.buf, 0, sizeof(unsigned) * prf->psample_hash.size);
+    }
+    prf->strace_pos = 1;
+    if (prf->strace_hash.buf != NULL) {
+        memset(prf->strace_hash.buf, 0, sizeof(unsigned) * prf->strace_hash.size);
     }
 }
 
@@ -237,11 +330,37 @@ void profiler_sst_reset(Context * ctx) {
     }
 }
 
+#if ENABLE_ProfilerPerf
+static void perf_sample(void * args, ContextAddress pc, ContextAddress * stk, unsigned stk_len) {
+    ProfilerSST * prf = (ProfilerSST *)args;
+    unsigned stk_trace = 0;
+    assert(!prf->disposed);
+    if (prf->frame_cnt > 1) {
+        stk_buf = stk;
+        stk_buf_pos = stk_len < prf->frame_cnt - 1 ? stk_len : prf->frame_cnt - 1;
+        stk_trace = find_stack_trace(prf);
+    }
+    add_to_sample_array(prf, pc, stk_trace);
+}
+
+static void close_perf(ProfilerSST * prf) {
+    if (prf->perf == NULL) return;
+    profiler_perf_close(prf->perf);
+    prf->perf = NULL;
+}
+#endif
+
 static void profiler_dispose(void * args) {
     ProfilerSST * prf = (ProfilerSST *)args;
     assert(!prf->disposed);
+#if ENABLE_ProfilerPerf
+    close_perf(prf);
+#endif
     list_remove(&prf->link_core);
-    free_buffers(prf);
+    loc_free(prf->psample_buf);
+    loc_free(prf->psample_hash.buf);
+    loc_free(prf->strace_buf);
+    loc_free(prf->strace_hash.buf);
     prf->disposed = 1;
     if (prf->lock == 0) loc_free(prf);
 }
@@ -277,6 +396,12 @@ static void * profiler_configure(void * args, Context * ctx, ProfilerParams * pa
             assert(!prf->disposed);
             free_buffers(prf);
         }
+#if ENABLE_ProfilerPerf
+        if (prf->perf != NULL && (prf->frame_cnt > 1) != (params->frame_cnt > 1)) close_perf(prf);
+        if (prf->perf == NULL && (params->frame_cnt <= 1 || PROFILER_PERF_CALL_CHAINS)) {
+            prf->perf = profiler_perf_open(ctx, params->frame_cnt > 1, perf_sample, prf);
+        }
+#endif
         prf->frame_cnt = params->frame_cnt;
     }
     else {
@@ -301,12 +426,15 @@ static void profiler_read(void * args, OutputStream * out) {
     RegisterDefinition * pc_def = get_PC_definition(prf->ctx);
 
     assert(!prf->disposed);
+#if ENABLE_ProfilerPerf
+    if (prf->perf != NULL) profiler_perf_poll(prf->perf);
+#endif
     write_stream(out, '{');
     json_write_string(out, "Format");
     write_stream(out, ':');
     json_write_string(out, "StackTraces");
     if (prf->psample_cnt > 0 && pc_def != NULL) {
-        unsigned i, j;
+        unsigned i;
         uint8_t * buf = (uint8_t *)tmp_alloc(pc_def->size * (prf->frame_cnt + 2));
         JsonWriteBinaryState state;
         assert(pc_def->size <= sizeof(ContextAddress));
@@ -318,22 +446,19 @@ static void profiler_read(void * args, OutputStream * out) {
         json_write_string(out, "Data");
         write_stream(out, ':');
         json_write_binary_start(&state, out, prf->psample_cnt * pc_def->size);
-        for (i = 0; i < PSAMPLE_HASH_SIZE; i++) {
-            ProfilerSampleArray * arr = prf->psample_hash + i;
-            for (j = 0; j < arr->buf_pos; j++) {
-                unsigned p = 0;
-                unsigned n = 1;
-                unsigned m = 1;
-                ProfilerSample * s = arr->buf + j;
-                add_num(buf, &p, pc_def->size, s->cnt);
-                if (s->stk != NULL) m += s->stk->len;
-                add_num(buf, &p, pc_def->size, m);
-                add_num(buf, &p, pc_def->size, s->pc);
-                while (n < m) {
-                    add_num(buf, &p, pc_def->size, s->stk->pc[n++ - 1]);
-                }
-                json_write_binary_data(&state, buf, p);
+        for (i = 0; i < prf->psample_pos; i++) {
+            unsigned p = 0;
+            unsigned m = 1;
+            unsigned stk = 0;
+            ProfilerSample * s = prf->psample_buf + i;
+            add_num(buf, &p, pc_def->size, s->cnt);
+            if (s->stk != 0) m += prf->strace_buf[s->stk].len;
+            add_num(buf, &p, pc_def->size, m);
+            add_num(buf, &p, pc_def->size, s->pc);
+            for (stk = s->stk; stk != 0; stk = prf->strace_buf[stk].parent) {
+                add_num(buf, &p, pc_def->size, prf->strace_buf[stk].pc);
             }
+            json_write_binary_data(&state, buf, p);
         }
         json_write_binary_end(&state);
     }
@@ -40,6 +40,7 @@
 #include <tcf/services/stacktrace.h>
 #include <tcf/services/diagnostics.h>
 #include <tcf/services/symbols.h>
+#include <tcf/services/disassembly.h>
 #include <tcf/main/cmdline.h>
 
 #ifndef EN_STEP_OVER
@@ -48,6 +49,9 @@
 #ifndef EN_STEP_LINE
 #  define EN_STEP_LINE (ENABLE_LineNumbers)
 #endif
+#ifndef EN_RANGE_STEP
+#  define EN_RANGE_STEP (EN_STEP_OVER && SERVICE_Disassembly)
+#endif
 
 #define STOP_ALL_TIMEOUT 1000000
 #define STOP_ALL_MAX_CNT 20
@@ -60,6 +64,14 @@
 #define SKIP_PROLOGUE_MAX_STEPS 50
 #endif
 
+#ifndef RANGE_STEP_MAX_SIZE
+#define RANGE_STEP_MAX_SIZE 0x1000
+#endif
+
+#ifndef RANGE_STEP_MAX_BPS
+#define RANGE_STEP_MAX_BPS 32
+#endif
+
 typedef struct Listener {
     RunControlEventListener * listener;
     void * args;
@@ -71,6 +83,23 @@ static unsigned listener_max = 0;
 
 static const char RUN_CONTROL[] = "RunControl";
 
+#if EN_RANGE_STEP
+/*
+ * Step machine breakpoints planted at all exits of a step range and at
+ * instructions that need to be single stepped (calls, returns and indirect jumps),
+ * allow to run through the range at full speed when the target does not
+ * support range stepping natively.
+ */
+typedef struct RangeStep {
+    ContextAddress range_start;
+    ContextAddress range_end;
+    int failed;             /* the range cannot be decoded, single step it */
+    unsigned cnt;
+    ContextAddress addr[RANGE_STEP_MAX_BPS];
+    BreakpointInfo * bps[RANGE_STEP_MAX_BPS];
+} RangeStep;
+#endif
+
 typedef struct ContextExtensionRC {
     int pending_safe_event; /* safe events are waiting for this context to be stopped */
     int intercepted;        /* context is reported to a host as suspended */
@@ -94,6 +123,9 @@ typedef struct ContextExtensionRC {
     int step_inlined;
     int step_set_frame_level;
     CodeArea * step_code_area;
+#if EN_RANGE_STEP
+    RangeStep * range_step;
+#endif
     ErrorReport * step_error;
     const char * step_done;
     Channel * step_channel;
@@ -810,6 +842,14 @@ static void free_code_area(CodeArea * area) {
     loc_free(area);
 }
 
+#if EN_RANGE_STEP
+static void free_range_step(RangeStep * rs) {
+    unsigned i;
+    for (i = 0; i < rs->cnt; i++) destroy_eventpoint(rs->bps[i]);
+    loc_free(rs);
+}
+#endif
+
 static void cancel_step_mode(Context * ctx) {
     ContextExtensionRC * ext = EXT(ctx);
 
@@ -827,6 +867,12 @@ static void cancel_step_mode(Context * ctx) {
         free_code_area(ext->step_code_area);
         ext->step_code_area = NULL;
     }
+#if EN_RANGE_STEP
+    if (ext->range_step != NULL) {
+        free_range_step(ext->range_step);
+        ext->range_step = NULL;
+    }
+#endif
     if (ext->step_func_id != NULL) {
         loc_free(ext->step_func_id);
         ext->step_func_id = NULL;
@@ -1582,6 +1628,116 @@ static BreakpointInfo * create_step_machine_breakpoint(ContextAddress addr, Cont
 }
 #endif
 
+#if EN_RANGE_STEP
+static int add_range_step_addr(RangeStep * rs, ContextAddress addr) {
+    unsigned i;
+    for (i = 0; i < rs->cnt; i++) {
+        if (rs->addr[i] == addr) return 0;
+    }
+    if (rs->cnt >= RANGE_STEP_MAX_BPS) return -1;
+    rs->addr[rs->cnt++] = addr;
+    return 0;
+}
+
+static int get_range_step_addrs(Context * ctx, RangeStep * rs, ContextAddress pc) {
+    /* Decode instructions of the range and collect addresses where the context must stop.
+     * Return -1 if the range cannot be handled this way */
+    ContextISA isa;
+    DisassemblerParams params;
+    Disassembler * disassembler = NULL;
+    ContextAddress size = rs->range_end - rs->range_start;
+    ContextAddress addr = rs->range_start;
+    uint8_t * buf = NULL;
+    int pc_ok = 0;
+    int error = 0;
+
+    if (size > RANGE_STEP_MAX_SIZE) return -1;
+    disassembler = get_disassembler(ctx, addr, &isa);
+    if (disassembler == NULL) return -1;
+    if (isa.size != 0 && (addr < isa.addr || addr - isa.addr + size > isa.size)) return -1;
+    buf = (uint8_t *)tmp_alloc((size_t)size);
+    if (context_read_mem(ctx, addr, buf, (size_t)size) < 0) return -1;
+
+    memset(&params, 0, sizeof(DisassemblerParams));
+    params.big_endian = ctx->big_endian;
+    while (!error && addr < rs->range_end) {
+        DisassemblyResult * dr = NULL;
+        ContextAddress next = 0;
+        int fall_through = 1;
+
+        if (addr == pc) pc_ok = 1;
+        dr = disassembler(buf + (addr - rs->range_start), addr, rs->range_end - addr, &params);
+        if (dr == NULL || dr->flow == 0 || dr->size == 0) {
+            error = 1;
+            break;
+        }
+        next = addr + dr->size;
+        switch (dr->flow) {
+        case DISASSEMBLY_FLOW_JUMP:
+            fall_through = 0;
+            /* fall through */
+        case DISASSEMBLY_FLOW_COND_JUMP:
+            if (dr->target < rs->range_start || dr->target >= rs->range_end) {
+                if (add_range_step_addr(rs, dr->target) < 0) error = 1;
+            }
+            break;
+        case DISASSEMBLY_FLOW_CALL:
+        case DISASSEMBLY_FLOW_CALL_INDIRECT:
+            /* Single step into the callee, the step machine handles it as usual */
+            if (add_range_step_addr(rs, addr) < 0) error = 1;
+            break;
+        case DISASSEMBLY_FLOW_JUMP_INDIRECT:
+            fall_through = 0;
+            if (add_range_step_addr(rs, addr) < 0) error = 1;
+            break;
+        }
+        if (fall_through && next >= rs->range_end) {
+            if (add_range_step_addr(rs, next) < 0) error = 1;
+        }
+        addr = next;
+    }
+    loc_free(params.state);
+    if (error || !pc_ok) return -1;
+    return 0;
+}
+
+static int update_range_step(Context * ctx) {
+    /* Return 1 if the context must be single stepped, 0 if it can run until one of range step breakpoints */
+    ContextExtensionRC * ext = EXT(ctx);
+    RangeStep * rs = ext->range_step;
+    unsigned i;
+
+    if (rs != NULL && (rs->range_start != ext->step_range_start ||
+            rs->range_end != ext->step_range_end)) {
+        free_range_step(rs);
+        ext->range_step = rs = NULL;
+    }
+    if (rs == NULL) {
+        rs = (RangeStep *)loc_alloc_zero(sizeof(RangeStep));
+        rs->range_start = ext->step_range_start;
+        rs->range_end = ext->step_range_end;
+        if (get_range_step_addrs(ctx, rs, ext->pc) < 0) {
+            if (cache_miss_count() > 0) {
+                loc_free(rs);
+                errno = ERR_CACHE_MISS;
+                return -1;
+            }
+            rs->failed = 1;
+            rs->cnt = 0;
+        }
+        for (i = 0; i < rs->cnt; i++) {
+            rs->bps[i] = create_step_machine_breakpoint(rs->addr[i], ctx);
+        }
+        ext->range_step = rs;
+    }
+    if (rs->failed) return 1;
+    for (i = 0; i < rs->cnt; i++) {
+        if (rs->addr[i] == ext->pc) return 1;
+    }
+    return 0;
+}
+#endif /* EN_RANGE_STEP */
+
 static int update_step_machine_state(Context * ctx) {
     ContextExtensionRC * ext = EXT(ctx);
     ContextAddress addr = ext->pc;
@@ -2092,6 +2248,19 @@ static int update_step_machine_state(Context * ctx) {
         break;
     }
 
+#if EN_RANGE_STEP
+    if (ext->step_range_end - ext->step_range_start > 1 &&
+            (ext->step_continue_mode == RM_STEP_INTO_RANGE || ext->step_continue_mode == RM_STEP_OVER_RANGE)) {
+        /* Target does not support range stepping, run to range step breakpoints instead of single stepping */
+        int single_step = update_range_step(ctx);
+        if (single_step < 0) return -1;
+        if (!single_step) {
+            ext->step_continue_mode = RM_RESUME;
+            return 0;
+        }
+    }
+#endif
+
     switch (ext->step_continue_mode) {
     case RM_STEP_OVER:
         if (context_can_resume(ctx, ext->step_continue_mode = RM_STEP_INTO)) return 0;
@@ -2197,19 +2366,42 @@ static void check_step_breakpoint_instances(InputStream * inp, void * args) {
     json_read_struct(inp, check_step_breakpoint_status, args);
 }
 
+#if SERVICE_Breakpoints
+static int get_step_breakpoint_error(BreakpointInfo * bp) {
+    int error = 0;
+    char * status = get_breakpoint_status(bp);
+    ByteArrayInputStream buf;
+    InputStream * inp = create_byte_array_input_stream(&buf, status, strlen(status));
+    json_read_struct(inp, check_step_breakpoint_status, &error);
+    loc_free(status);
+    return error;
+}
+#endif
+
 static int check_step_breakpoint(Context * ctx) {
 #if SERVICE_Breakpoints
     /* Return error if step machine breakpoint cannot be planted */
     int error = 0;
-    char * status = NULL;
-    ByteArrayInputStream buf;
-    InputStream * inp = NULL;
     ContextExtensionRC * ext = EXT(ctx);
+#if EN_RANGE_STEP
+    RangeStep * rs = ext->range_step;
+    if (rs != NULL && ext->step_continue_mode == RM_RESUME) {
+        unsigned i;
+        for (i = 0; i < rs->cnt; i++) {
+            if (get_step_breakpoint_error(rs->bps[i]) == 0) continue;
+            /* Cannot run through the range, fall back to single stepping */
+            while (rs->cnt > 0) destroy_eventpoint(rs->bps[--rs->cnt]);
+            rs->failed = 1;
+            if (!context_can_resume(ctx, ext->step_continue_mode = RM_STEP_INTO)) {
+                errno = ERR_UNSUPPORTED;
+                return -1;
+            }
+            break;
+        }
+    }
+#endif
     if (ext->step_bp_info == NULL) return 0;
-    status = get_breakpoint_status(ext->step_bp_info);
-    inp = create_byte_array_input_stream(&buf, status, strlen(status));
-    json_read_struct(inp, check_step_breakpoint_status, &error);
-    loc_free(status);
+    error = get_step_breakpoint_error(ext->step_bp_info);
     if (!error) return 0;
     errno = error;
     return -1;
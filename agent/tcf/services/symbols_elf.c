@@ -971,16 +971,16 @@ static int cmp_object_profiles(ObjectInfo * x, ObjectInfo * y) {
             for (;;) {
                 while (px != NULL) {
                     if (px->mTag == TAG_formal_parameter) break;
-                    px = px->mSibling;
+                    px = get_dwarf_sibling(px);
                 }
                 while (py != NULL) {
                     if (py->mTag == TAG_formal_parameter) break;
-                    py = py->mSibling;
+                    py = get_dwarf_sibling(py);
                 }
                 if (px == NULL || py == NULL) break;
                 if (!cmp_object_profiles(px->mType, py->mType)) return 0;
-                px = px->mSibling;
-                py = py->mSibling;
+                px = get_dwarf_sibling(px);
+                py = get_dwarf_sibling(py);
             }
             if (x->mName != NULL && x->mName[0] == '~') break;
             if (px != NULL || py != NULL) return 0;
@@ -1161,12 +1161,14 @@ static void sort_find_symbol_buf(void) {
 }
 
 static int same_namespace(ObjectInfo * x, ObjectInfo * y) {
-    int xn = x->mParent != NULL && x->mParent->mTag == TAG_namespace;
-    int yn = y->mParent != NULL && y->mParent->mTag == TAG_namespace;
+    ObjectInfo * px = get_dwarf_loaded_parent(x);
+    ObjectInfo * py = get_dwarf_loaded_parent(y);
+    int xn = px != NULL && px->mTag == TAG_namespace;
+    int yn = py != NULL && py->mTag == TAG_namespace;
     if (xn != yn) return 0;
     if (!xn) return 1;
-    x = x->mParent;
-    y = y->mParent;
+    x = px;
+    y = py;
     if (x->mName == y->mName) return 1;
     if (x->mName == NULL) return 0;
     if (y->mName == NULL) return 0;
@@ -1201,6 +1203,7 @@ static ObjectInfo * find_definition(ObjectInfo * decl) {
             ObjectInfo * def = NULL;
             DWARFCache * cache = get_dwarf_cache(get_dwarf_file(decl->mCompUnit->mFile));
             PubNamesTable * tbl = &cache->mPubNames;
+            load_dwarf_pub_names(cache, get_dwarf_parent(decl), decl->mName);
             if (tbl->mHash != NULL) {
                 unsigned n = tbl->mHash[calc_symbol_name_hash(decl->mName) % tbl->mHashSize];
                 while (n != 0) {
@@ -1232,11 +1235,13 @@ static ObjectInfo * find_definition(ObjectInfo * decl) {
 
 static void find_by_name_in_pub_names(DWARFCache * cache, const char * name) {
     PubNamesTable * tbl = &cache->mPubNames;
+    load_dwarf_pub_names(cache, NULL, name);
     if (tbl->mHash != NULL) {
         unsigned n = tbl->mHash[calc_symbol_name_hash(name) % tbl->mHashSize];
         while (n != 0) {
             ObjectInfo * obj = tbl->mNext[n].mObject;
-            int ns = obj->mParent != NULL && obj->mParent->mTag == TAG_namespace;
+            ObjectInfo * parent = get_dwarf_loaded_parent(obj);
+            int ns = parent != NULL && parent->mTag == TAG_namespace;
             if (!ns && equ_symbol_names(obj->mName, name)) {
                 add_obj_to_find_symbol_buf(obj, 1);
             }
@@ -1299,7 +1304,7 @@ static int find_in_object_tree(ObjectInfo * parent, unsigned level,
                 if (find_in_object_tree(obj, level + 1, ip, name)) found = 1;
                 break;
             }
-            obj = obj->mSibling;
+            obj = get_dwarf_sibling(obj);
         }
         if (!found && check_in_range(parent, ip)) found = 1;
         if (!found && ip->unit->mObject != parent) return 0;
@@ -1326,7 +1331,7 @@ static int find_in_object_tree(ObjectInfo * parent, unsigned level,
                 }
             }
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
     }
 
     if (sym_this != NULL) {
@@ -1405,7 +1410,7 @@ static int find_in_object_tree(ObjectInfo * parent, unsigned level,
             }
             break;
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
     }
     return 1;
 }
@@ -1469,7 +1474,7 @@ static void find_by_name_in_sym_table(ELF_File * file, const char * name, int gl
                                     break;
                                 }
                             }
-                            obj = obj->mSibling;
+                            obj = get_dwarf_sibling(obj);
                         }
                     }
                 }
@@ -1739,7 +1744,7 @@ int find_symbol_in_scope(Context * ctx, int frame, ContextAddress ip, Symbol * s
                 ObjectInfo * obj = get_dwarf_children(scope->obj);
                 while (obj != NULL) {
                     if (obj->mTag == TAG_lexical_block) find_in_object_tree(obj, 3, NULL, name);
-                    obj = obj->mSibling;
+                    obj = get_dwarf_sibling(obj);
                 }
             }
             clear_trap(&trap);
@@ -1815,7 +1820,7 @@ static int find_by_addr_in_unit(ObjectInfo * parent, int level, UnitAddress * ad
             }
             break;
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
     }
     return 0;
 }
@@ -1976,7 +1981,7 @@ static void enumerate_local_vars(ObjectInfo * parent, int level,
             }
             break;
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
     }
 }
 
@@ -2551,7 +2556,7 @@ static void search_inlined_subroutine(Context * ctx, ObjectInfo * obj, UnitAddre
             }
             break;
         }
-        o = o->mSibling;
+        o = get_dwarf_sibling(o);
     }
 }
 
@@ -2711,7 +2716,7 @@ static U8_T get_array_index_length(ObjectInfo * ref, ObjectInfo * obj) {
         x = 0;
         while (c != NULL) {
             x++;
-            c = c->mSibling;
+            c = get_dwarf_sibling(c);
         }
         return x;
     }
@@ -2822,7 +2827,7 @@ static int get_object_size(ObjectInfo * ref, ObjectInfo * obj, unsigned dimensio
             ObjectInfo * idx = get_dwarf_children(obj);
             while (idx != NULL) {
                 if (i++ >= dimension) length *= get_array_index_length(ref, idx);
-                idx = idx->mSibling;
+                idx = get_dwarf_sibling(idx);
             }
             if (get_num_prop(obj, AT_stride_size, &n)) {
                 *byte_size = (n * length + 7) / 8;
@@ -3357,10 +3362,10 @@ int get_symbol_base_type(const Symbol * sym, Symbol ** base_type) {
             int i = sym->dimension;
             ObjectInfo * idx = get_dwarf_children(obj);
             while (i > 0 && idx != NULL) {
-                idx = idx->mSibling;
+                idx = get_dwarf_sibling(idx);
                 i--;
             }
-            if (idx != NULL && idx->mSibling != NULL) {
+            if (idx != NULL && idx->mSibling != 0) {
                 object2symbol(sym->ref, obj, base_type);
                 (*base_type)->dimension = sym->dimension + 1;
                 return 0;
@@ -3397,7 +3402,7 @@ int get_symbol_index_type(const Symbol * sym, Symbol ** index_type) {
             int i = sym->dimension;
             ObjectInfo * idx = get_dwarf_children(obj);
             while (i > 0 && idx != NULL) {
-                idx = idx->mSibling;
+                idx = get_dwarf_sibling(idx);
                 i--;
             }
             if (idx != NULL) {
@@ -3469,7 +3474,7 @@ int get_symbol_length(const Symbol * sym, ContextAddress * length) {
             int i = sym->dimension;
             ObjectInfo * idx = get_dwarf_children(obj);
             while (i > 0 && idx != NULL) {
-                idx = idx->mSibling;
+                idx = get_dwarf_sibling(idx);
                 i--;
             }
             if (idx != NULL) {
@@ -3512,7 +3517,7 @@ int get_symbol_lower_bound(const Symbol * sym, int64_t * value) {
             int i = sym->dimension;
             ObjectInfo * idx = get_dwarf_children(obj);
             while (i > 0 && idx != NULL) {
-                idx = idx->mSibling;
+                idx = get_dwarf_sibling(idx);
                 i--;
             }
             if (idx != NULL) {
@@ -3595,7 +3600,7 @@ int get_symbol_children(const Symbol * sym, Symbol *** children, int * count) {
                         }
                         buf[n++] = y;
                     }
-                    i = i->mSibling;
+                    i = get_dwarf_sibling(i);
                 }
                 *children = buf;
                 *count = n;
@@ -3641,7 +3646,7 @@ int get_symbol_children(const Symbol * sym, Symbol *** children, int * count) {
                     buf = (Symbol **)tmp_realloc(buf, sizeof(Symbol *) * buf_len);
                 }
                 buf[n++] = x;
-                i = i->mSibling;
+                i = get_dwarf_sibling(i);
             }
         }
         *children = buf;
@@ -3753,7 +3758,7 @@ static void add_member_location_command(LocationInfo * info, ObjectInfo * obj) {
 
 static int add_member_location(LocationInfo * info, ObjectInfo * type, ObjectInfo * member) {
     ObjectInfo * obj = NULL;
-    if (member->mParent == type) {
+    if (get_dwarf_loaded_parent(member) == type) {
         add_member_location_command(info, member);
         return 1;
     }
@@ -3766,7 +3771,7 @@ static int add_member_location(LocationInfo * info, ObjectInfo * type, ObjectInf
             if (add_member_location(info, obj->mType, member)) return 1;
             info->value_cmds.cnt = cnt;
         }
-        obj = obj->mSibling;
+        obj = get_dwarf_sibling(obj);
     }
     return 0;
 }
@@ -3799,8 +3804,8 @@ static int read_discriminant_values(ObjectInfo * obj, LocationInfo * info) {
          * that the parent of this object contains the info to the
          * discriminant.
          */
-        assert(obj->mParent != NULL);
-        type = get_original_type(obj->mParent);
+        assert(obj->mParent != 0);
+        type = get_original_type(get_dwarf_loaded_parent(obj));
         get_object_type_class(type, &type_class);
         discr_signed = type_class == TYPE_CLASS_INTEGER;
 
@@ -4043,7 +4048,7 @@ int get_location_info(const Symbol * sym, LocationInfo ** res) {
                                     */
                                 }
                             }
-                            l = l->mSibling;
+                            l = get_dwarf_sibling(l);
                         }
                     }
                 }
@@ -101,10 +101,53 @@ static ElfListState * elf_list_state = NULL;
 
 #if ENABLE_DebugContext
 
+#if ENABLE_MemoryMap
+
+/*
+ * Regions of an ELF map index that belong to a file,
+ * used to map link-time addresses of the file to run-time addresses.
+ */
+typedef struct ElfFileRegions {
+    struct ElfFileRegions * next;
+    ELF_File * file;
+    unsigned names_cnt;
+    unsigned cnt;
+    unsigned * regions;
+} ElfFileRegions;
+
+/*
+ * ELF map of a memory context, see elf_get_map(), indexed by address.
+ * The index caches ELF files of the regions, and it is rebuilt only when
+ * the context memory map changes.
+ */
+typedef struct ElfMapIndex {
+    struct ElfMapIndex * next;
+    Context * ctx;
+    MemoryMap map;
+    ELF_File ** files;          /* Cached elf_open_memory_region_file() results */
+    unsigned * addr_index;      /* Region indices sorted by address */
+    ContextAddress * max_end;   /* Max region end address in addr_index[0..i] */
+    ElfFileRegions * file_regions;
+} ElfMapIndex;
+
+static ElfMapIndex * map_indexes = NULL;
+
+#else
+
 static MemoryMap elf_map;
 
 #endif
 
+/* Result of ELF map search: indices of regions in 'map', in map order */
+typedef struct ElfMapSearch {
+    MemoryMap * map;
+    ELF_File ** files;
+    unsigned * regions;
+    unsigned cnt;
+} ElfMapSearch;
+
+#endif
+
 static ELF_File * find_open_file_by_name(const char * name);
 
 void elf_add_open_listener(ELFOpenListener listener) {
@@ -123,10 +166,45 @@ void elf_add_close_listener(ELFCloseListener listener) {
     closelisteners[closelisteners_cnt++] = listener;
 }
 
+#if ENABLE_DebugContext && ENABLE_MemoryMap
+static void free_elf_map_index(ElfMapIndex * index) {
+    while (index->file_regions != NULL) {
+        ElfFileRegions * f = index->file_regions;
+        index->file_regions = f->next;
+        loc_free(f->regions);
+        loc_free(f);
+    }
+    /* Note: the regions are shallow copies, the strings are owned by memory maps and ELF files */
+    loc_free(index->map.regions);
+    loc_free(index->files);
+    loc_free(index->addr_index);
+    loc_free(index->max_end);
+    loc_free(index);
+}
+
+static void flush_elf_map_index(Context * ctx) {
+    ElfMapIndex ** p = &map_indexes;
+    while (*p != NULL) {
+        ElfMapIndex * index = *p;
+        if (ctx == NULL || index->ctx == ctx) {
+            *p = index->next;
+            free_elf_map_index(index);
+        }
+        else {
+            p = &index->next;
+        }
+    }
+}
+#endif
+
 static void elf_dispose(ELF_File * file) {
     unsigned n;
     assert(file->lock_cnt == 0);
     trace(LOG_ELF, "Dispose ELF file cache %s", file->name);
+#if ENABLE_DebugContext && ENABLE_MemoryMap
+    /* Map indexes refer to the file and to its name */
+    flush_elf_map_index(NULL);
+#endif
     for (n = 0; n < closelisteners_cnt; n++) {
         closelisteners[n](file);
     }
@@ -1382,18 +1460,150 @@ static void search_regions(MemoryMap * map, ContextAddress addr0, ContextAddress
     }
 }
 
+#if ENABLE_MemoryMap
+
+static ElfMapIndex * addr_index_sort_map = NULL;
+
+static int addr_index_comparator(const void * x, const void * y) {
+    MemoryRegion * rx = addr_index_sort_map->map.regions + *(unsigned *)x;
+    MemoryRegion * ry = addr_index_sort_map->map.regions + *(unsigned *)y;
+    if (rx->addr < ry->addr) return -1;
+    if (rx->addr > ry->addr) return +1;
+    return 0;
+}
+
+static ContextAddress get_region_end(MemoryRegion * r) {
+    /* Zero length regions are section symbols, they match their address */
+    if (r->size == 0) return r->addr;
+    return r->addr + r->size - 1;
+}
+
+static ElfMapIndex * get_elf_map_index(Context * ctx) {
+    unsigned i;
+    ContextAddress max_end = 0;
+    MemoryMap * client_map = NULL;
+    MemoryMap * target_map = NULL;
+    ElfMapIndex * index = map_indexes;
+
+    ctx = context_get_group(ctx, CONTEXT_GROUP_PROCESS);
+    while (index != NULL) {
+        if (index->ctx == ctx) return index;
+        index = index->next;
+    }
+
+    /* A map read while there are pending cache misses might be stale, don't index it */
+    if (cache_miss_count() > 0 || memory_map_get(ctx, &client_map, &target_map) < 0 ||
+            cache_miss_count() > 0) {
+        if (cache_miss_count() > 0) errno = ERR_CACHE_MISS;
+        return NULL;
+    }
+    index = (ElfMapIndex *)loc_alloc_zero(sizeof(ElfMapIndex));
+    index->ctx = ctx;
+    search_regions(client_map, 0, ~(ContextAddress)0, &index->map);
+    search_regions(target_map, 0, ~(ContextAddress)0, &index->map);
+    if (cache_miss_count() > 0) {
+        free_elf_map_index(index);
+        errno = ERR_CACHE_MISS;
+        return NULL;
+    }
+
+    index->files = (ELF_File **)loc_alloc_zero(sizeof(ELF_File *) * (index->map.region_cnt + 1));
+    index->addr_index = (unsigned *)loc_alloc(sizeof(unsigned) * (index->map.region_cnt + 1));
+    index->max_end = (ContextAddress *)loc_alloc(sizeof(ContextAddress) * (index->map.region_cnt + 1));
+    for (i = 0; i < index->map.region_cnt; i++) index->addr_index[i] = i;
+    addr_index_sort_map = index;
+    qsort(index->addr_index, index->map.region_cnt, sizeof(unsigned), addr_index_comparator);
+    addr_index_sort_map = NULL;
+    for (i = 0; i < index->map.region_cnt; i++) {
+        ContextAddress end = get_region_end(index->map.regions + index->addr_index[i]);
+        if (i == 0 || end > max_end) max_end = end;
+        index->max_end[i] = max_end;
+    }
+
+    trace(LOG_ELF, "ELF map index of %s: %u regions", ctx->id, index->map.region_cnt);
+    index->next = map_indexes;
+    map_indexes = index;
+    return index;
+}
+
+static int cmp_region_index(const void * x, const void * y) {
+    unsigned ix = *(unsigned *)x;
+    unsigned iy = *(unsigned *)y;
+    if (ix < iy) return -1;
+    if (ix > iy) return +1;
+    return 0;
+}
+
+static void search_elf_map_index(ElfMapIndex * index, ContextAddress addr0, ContextAddress addr1, ElfMapSearch * s) {
+    unsigned l = 0;
+    unsigned h = index->map.region_cnt;
+
+    s->map = &index->map;
+    s->files = index->files;
+    s->regions = NULL;
+    s->cnt = 0;
+
+    /* Find number of regions that start at or below addr1 */
+    while (l < h) {
+        unsigned k = (l + h) / 2;
+        if (index->map.regions[index->addr_index[k]].addr <= addr1) l = k + 1;
+        else h = k;
+    }
+    while (l > 0 && index->max_end[l - 1] >= addr0) {
+        unsigned i = index->addr_index[--l];
+        if (get_region_end(index->map.regions + i) < addr0) continue;
+        if (s->regions == NULL) s->regions = (unsigned *)tmp_alloc(sizeof(unsigned) * (l + 1));
+        s->regions[s->cnt++] = i;
+    }
+    /* Preserve map order, callers can depend on it */
+    if (s->cnt > 1) qsort(s->regions, s->cnt, sizeof(unsigned), cmp_region_index);
+}
+
+#endif /* ENABLE_MemoryMap */
+
+static int search_elf_map(Context * ctx, ContextAddress addr0, ContextAddress addr1, ElfMapSearch * s) {
+#if ENABLE_MemoryMap
+    ElfMapIndex * index = get_elf_map_index(ctx);
+    if (index == NULL) return -1;
+    search_elf_map_index(index, addr0, addr1, s);
+#else
+    unsigned i;
+    if (elf_get_map(ctx, addr0, addr1, &elf_map) < 0) return -1;
+    s->map = &elf_map;
+    s->files = NULL;
+    s->cnt = elf_map.region_cnt;
+    s->regions = (unsigned *)tmp_alloc(sizeof(unsigned) * (s->cnt + 1));
+    for (i = 0; i < s->cnt; i++) s->regions[i] = i;
+#endif
+    return 0;
+}
+
+static ELF_File * open_search_region_file(ElfMapSearch * s, unsigned i, int * error) {
+    unsigned n = s->regions[i];
+    ELF_File * file = NULL;
+    if (s->files != NULL) {
+        file = s->files[n];
+        if (file != NULL && !file->mtime_changed) {
+            file->age = 0;
+            return file;
+        }
+    }
+    file = elf_open_memory_region_file(s->map->regions + n, error);
+    if (s->files != NULL) s->files[n] = file;
+    return file;
+}
+
 int elf_get_map(Context * ctx, ContextAddress addr0, ContextAddress addr1, MemoryMap * map) {
     map->region_cnt = 0;
-    ctx = context_get_group(ctx, CONTEXT_GROUP_PROCESS);
 #if ENABLE_MemoryMap
     {
-        MemoryMap * client_map = NULL;
-        MemoryMap * target_map = NULL;
-        if (memory_map_get(ctx, &client_map, &target_map) < 0) return -1;
-        search_regions(client_map, addr0, addr1, map);
-        search_regions(target_map, addr0, addr1, map);
+        unsigned i;
+        ElfMapSearch s;
+        if (search_elf_map(ctx, addr0, addr1, &s) < 0) return -1;
+        for (i = 0; i < s.cnt; i++) *add_region(map) = s.map->regions[s.regions[i]];
     }
 #else
+    ctx = context_get_group(ctx, CONTEXT_GROUP_PROCESS);
     {
         int error = 0;
         MemoryMap target_map;
@@ -1414,16 +1624,16 @@ int elf_get_map(Context * ctx, ContextAddress addr0, ContextAddress addr1, Memor
 ELF_File * elf_open_inode(Context * ctx, dev_t dev, ino_t ino, int64_t mtime) {
     unsigned i;
     int error = 0;
+    ElfMapSearch s;
     ELF_File * file = find_open_file_by_inode(dev, ino, mtime);
     if (file != NULL) {
         if (file->error == NULL) return file;
         set_error_report_errno(file->error);
         return NULL;
     }
-    if (elf_get_map(ctx, 0, ~(ContextAddress)0, &elf_map) < 0) return NULL;
-    for (i = 0; i < elf_map.region_cnt; i++) {
-        MemoryRegion * r = elf_map.regions + i;
-        file = elf_open_memory_region_file(r, &error);
+    if (search_elf_map(ctx, 0, ~(ContextAddress)0, &s) < 0) return NULL;
+    for (i = 0; i < s.cnt; i++) {
+        file = open_search_region_file(&s, i, &error);
         if (file == NULL) continue;
         if (file->dev == dev && file->ino == ino && file->mtime == mtime) return file;
         file = get_dwarf_file(file);
@@ -1569,16 +1779,17 @@ UnitAddressRange * elf_find_unit(Context * ctx, ContextAddress addr_min, Context
     unsigned i, j;
     UnitAddressRange * range = NULL;
     int error = 0;
+    ElfMapSearch s;
 
-    if (elf_get_map(ctx, addr_min, addr_max, &elf_map) < 0) return NULL;
-    for (i = 0; range == NULL && i < elf_map.region_cnt; i++) {
+    if (search_elf_map(ctx, addr_min, addr_max, &s) < 0) return NULL;
+    for (i = 0; range == NULL && i < s.cnt; i++) {
         ContextAddress link_addr_min, link_addr_max;
-        MemoryRegion * r = elf_map.regions + i;
+        MemoryRegion * r = s.map->regions + s.regions[i];
         ELF_File * file = NULL;
         assert(r->addr <= addr_max);
         if (r->size == 0) continue;
         assert(r->addr + r->size - 1 >= addr_min);
-        file = elf_open_memory_region_file(r, &error);
+        file = open_search_region_file(&s, i, &error);
         if (file == NULL) {
             if (error) {
                 if (r->id != NULL) continue;
@@ -1680,33 +1891,76 @@ ContextAddress elf_run_time_address_in_region(Context * ctx, MemoryRegion * r, E
     return 0;
 }
 
+static int is_file_region(ELF_File * file, ElfMapSearch * s, unsigned i) {
+    MemoryRegion * r = s->map->regions + s->regions[i];
+    int same_file = 0;
+    if (r->dev == 0) {
+        same_file = file_name_equ(file, r->file_name);
+    }
+    else {
+       ino_t ino = r->ino;
+       if (ino == 0) ino = elf_ino(r->file_name);
+       same_file = file->ino == ino && file->dev == r->dev;
+    }
+    if (!same_file) {
+        /* Check if the memory map entry has a separate debug info file */
+        ELF_File * exec = NULL;
+        if (!file->debug_info_file) return 0;
+        exec = open_search_region_file(s, i, NULL);
+        if (exec == NULL) return 0;
+        if (get_dwarf_file(exec) != file) return 0;
+    }
+    return 1;
+}
+
+static int search_elf_file_regions(Context * ctx, ELF_File * file, ElfMapSearch * s) {
+    /* Note: link-time address cannot be used to search the map, search by file instead */
+    unsigned i;
+#if ENABLE_MemoryMap
+    ElfFileRegions * f = NULL;
+    ElfMapIndex * index = get_elf_map_index(ctx);
+    if (index == NULL) return -1;
+    for (f = index->file_regions; f != NULL; f = f->next) {
+        /* File name aliases can be added after the regions are found */
+        if (f->file == file && f->names_cnt == file->names_cnt) break;
+    }
+    if (f == NULL) {
+        search_elf_map_index(index, 0, ~(ContextAddress)0, s);
+        f = (ElfFileRegions *)loc_alloc_zero(sizeof(ElfFileRegions));
+        f->file = file;
+        f->names_cnt = file->names_cnt;
+        f->regions = (unsigned *)loc_alloc(sizeof(unsigned) * (s->cnt + 1));
+        for (i = 0; i < s->cnt; i++) {
+            if (is_file_region(file, s, i)) f->regions[f->cnt++] = s->regions[i];
+        }
+        f->next = index->file_regions;
+        index->file_regions = f;
+    }
+    s->map = &index->map;
+    s->files = index->files;
+    s->regions = f->regions;
+    s->cnt = f->cnt;
+#else
+    unsigned n = 0;
+    if (search_elf_map(ctx, 0, ~(ContextAddress)0, s) < 0) return -1;
+    for (i = 0; i < s->cnt; i++) {
+        if (is_file_region(file, s, i)) s->regions[n++] = s->regions[i];
+    }
+    s->cnt = n;
+#endif
+    return 0;
+}
+
 ContextAddress elf_map_to_run_time_address(Context * ctx, ELF_File * file, ELF_Section * sec, ContextAddress addr) {
     unsigned i;
     unsigned cnt = 0;
     ContextAddress rt = 0;
+    ElfMapSearch s;
 
-    /* Note: 'addr' is link-time address - it cannot be used as elf_get_map() argument */
-    if (elf_get_map(ctx, 0, ~(ContextAddress)0, &elf_map) < 0) return 0;
-    for (i = 0; i < elf_map.region_cnt; i++) {
-        MemoryRegion * r = elf_map.regions + i;
+    if (search_elf_file_regions(ctx, file, &s) < 0) return 0;
+    for (i = 0; i < s.cnt; i++) {
+        MemoryRegion * r = s.map->regions + s.regions[i];
         ContextAddress a = 0;
-        int same_file = 0;
-        if (r->dev == 0) {
-            same_file = file_name_equ(file, r->file_name);
-        }
-        else {
-           ino_t ino = r->ino;
-           if (ino == 0) ino = elf_ino(r->file_name);
-           same_file = file->ino == ino && file->dev == r->dev;
-        }
-        if (!same_file) {
-            /* Check if the memory map entry has a separate debug info file */
-            ELF_File * exec = NULL;
-            if (!file->debug_info_file) continue;
-            exec = elf_open_memory_region_file(r, NULL);
-            if (exec == NULL) continue;
-            if (get_dwarf_file(exec) != file) continue;
-        }
         a = elf_run_time_address_in_region(ctx, r, file, sec, addr);
         if (errno == 0) {
             rt = a;
@@ -1730,14 +1984,15 @@ ContextAddress elf_map_to_link_time_address(Context * ctx, ContextAddress addr,
     unsigned cnt = 0;
     ContextAddress lt = 0;
     ELF_Section * exec_sec = NULL;
+    ElfMapSearch s;
 
-    if (elf_get_map(ctx, addr, addr, &elf_map) < 0) return 0;
-    for (i = 0; i < elf_map.region_cnt; i++) {
-        MemoryRegion * r = elf_map.regions + i;
+    if (search_elf_map(ctx, addr, addr, &s) < 0) return 0;
+    for (i = 0; i < s.cnt; i++) {
+        MemoryRegion * r = s.map->regions + s.regions[i];
         ELF_File * f = NULL;
         ELF_File * d = NULL;
         assert(r->addr <= addr);
-        f = elf_open_memory_region_file(r, NULL);
+        f = open_search_region_file(&s, i, NULL);
         if (f == NULL) continue;
         d = to_dwarf ? get_dwarf_file(f) : f;
         if (r->sect_name == NULL) {
@@ -2306,7 +2561,39 @@ void elf_invalidate(void) {
     }
 }
 
+#if ENABLE_DebugContext && ENABLE_MemoryMap
+static void event_map_changed(Context * ctx, void * args) {
+    flush_elf_map_index(ctx);
+}
+
+static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * args) {
+    flush_elf_map_index(ctx);
+}
+
+static void event_context_exited(Context * ctx, void * args) {
+    flush_elf_map_index(ctx);
+}
+#endif
+
 void ini_elf(void) {
+#if ENABLE_DebugContext && ENABLE_MemoryMap
+    static MemoryMapEventListener map_listener = {
+        event_map_changed,
+        event_code_unmapped,
+        event_map_changed,
+        event_map_changed,
+    };
+    static ContextEventListener ctx_listener = {
+        NULL,
+        event_context_exited,
+        NULL,
+        NULL,
+        NULL,
+        event_context_exited
+    };
+    add_memory_map_event_listener(&map_listener, NULL);
+    add_context_event_listener(&ctx_listener, NULL);
+#endif
 }
 
 #endif /* ENABLE_ELF */
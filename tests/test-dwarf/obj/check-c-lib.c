@@ -0,0 +1,7 @@
+#include <string.h>
+int main() {
+  char buf[256];
+  strlcpy(buf, "", sizeof(buf));
+  strlcat(buf, "", sizeof(buf));
+  return 0;
+}
@@ -36,6 +36,7 @@
 #include <tcf/services/memorymap.h>
 #include <tcf/services/dwarfframe.h>
 #include <tcf/services/dwarfcache.h>
+#include <tcf/services/dwarfdiskcache.h>
 #include <tcf/services/stacktrace.h>
 #include <tcf/services/expressions.h>
 #include <tcf/services/dwarf.h>
@@ -403,6 +404,7 @@ static char * esc(char * s) {
 
 static void test(void * args);
 static void loc_var_func(void * args, Symbol * sym);
+static int file_name_comparator(const void * x, const void * y);
 
 static int is_cpp_reference(Symbol * type) {
     int type_class = 0;
@@ -852,7 +854,7 @@ static void loc_var_func(void * args, Symbol * sym) {
         error_sym("get_symbol_name", sym);
     }
     /* Check for out-of-body definition */
-    out_of_body = sym_container != NULL && get_symbol_object(sym)->mParent != get_symbol_object(sym_container);
+    out_of_body = sym_container != NULL && get_dwarf_loaded_parent(get_symbol_object(sym)) != get_symbol_object(sym_container);
     if (!out_of_body && name != NULL) {
         int found_next = 0;
         int search_in_scope = 0;
@@ -1577,14 +1579,183 @@ static int is_in_segment(U8_T lt_addr) {
     return 0;
 }
 
+static char * get_symbol_ids(const char * name) {
+    /* Return sorted IDs of all symbols with given name, or error message */
+    Symbol * sym = NULL;
+    char ** ids = NULL;
+    unsigned cnt = 0;
+    unsigned max = 0;
+    size_t len = 1;
+    char * res = NULL;
+    unsigned i;
+
+    if (find_symbol_by_name(elf_ctx, STACK_NO_FRAME, 0, name, &sym) < 0) {
+        return loc_strdup(errno_to_str(errno));
+    }
+    do {
+        if (cnt >= max) {
+            max = max == 0 ? 8 : max * 2;
+            ids = (char **)tmp_realloc(ids, sizeof(char *) * max);
+        }
+        ids[cnt] = tmp_strdup(symbol2id(sym));
+        len += strlen(ids[cnt++]) + 1;
+    }
+    while (find_next_symbol(&sym) == 0);
+    qsort(ids, cnt, sizeof(char *), file_name_comparator);
+    res = (char *)loc_alloc(len);
+    *res = 0;
+    for (i = 0; i < cnt; i++) {
+        strcat(res, ids[i]);
+        strcat(res, " ");
+    }
+    return res;
+}
+
+static int object_name_comparator(const void * x, const void * y) {
+    return strcmp((*(ObjectInfo **)x)->mName, (*(ObjectInfo **)y)->mName);
+}
+
+static void test_name_index(void) {
+    /* Search names of top level objects while public names are loaded on demand using the name index,
+     * then load all public names and check that the search results are same.
+     * Must be called before any other symbol search in the file. */
+    DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
+    ObjectInfo ** objs = NULL;
+    char ** ids = NULL;
+    unsigned objs_cnt = 0;
+    unsigned objs_max = 0;
+    unsigned pass = 0;
+    unsigned n = 0;
+    unsigned m = 0;
+    unsigned k = 0;
+    time_t time_start = time(0);
+
+    if (cache->mPubNamesDeferredCnt == 0) return;
+    for (m = 1; m < cache->mFile->section_cnt; m++) {
+        ObjectInfo * unit = cache->mObjectHashTable[m].mCompUnits;
+        while (unit != NULL) {
+            ObjectInfo * obj = get_dwarf_children(unit);
+            while (obj != NULL) {
+                if (obj->mName != NULL) {
+                    if (objs_cnt >= objs_max) {
+                        objs_max = objs_max == 0 ? 256 : objs_max * 2;
+                        objs = (ObjectInfo **)loc_realloc(objs, sizeof(ObjectInfo *) * objs_max);
+                    }
+                    objs[objs_cnt++] = obj;
+                }
+                obj = get_dwarf_sibling(obj);
+            }
+            unit = get_dwarf_sibling(unit);
+        }
+    }
+    qsort(objs, objs_cnt, sizeof(ObjectInfo *), object_name_comparator);
+    ids = (char **)loc_alloc_zero(sizeof(char *) * (objs_cnt + 1));
+    /* Search names while most of units are not loaded yet: names that are only declared first,
+     * then names that are defined in one unit, names that are used more than once last. */
+    for (pass = 0; pass < 3 && time(0) - time_start < 120; pass++) {
+        for (n = 0; n < objs_cnt; n = m) {
+            const char * name = objs[n]->mName;
+            unsigned decl_cnt = 0;
+            unsigned name_pass = 0;
+            for (m = n; m < objs_cnt && strcmp(objs[m]->mName, name) == 0; m++) {
+                if (objs[m]->mFlags & DOIF_declaration) decl_cnt++;
+            }
+            if (decl_cnt == m - n) name_pass = 0;
+            else if (m - n == 1) name_pass = 1;
+            else name_pass = 2;
+            if (name_pass != pass) continue;
+            load_dwarf_pub_names(cache, NULL, name);
+            for (k = n; k < m; k++) {
+                ObjectInfo * obj = objs[k];
+                if ((obj->mFlags & DOIF_declaration) == 0 && obj->mCompUnit->mPubNamesDeferred) {
+                    printf("Name          : %s\n", name);
+                    printf("Unit          : %s\n", obj->mCompUnit->mObject->mName);
+                    set_errno(ERR_OTHER, "The name index does not list the unit");
+                    error("load_dwarf_pub_names");
+                }
+            }
+            ids[n] = get_symbol_ids(name);
+            tmp_gc();
+            if (time(0) - time_start >= 120) break;
+        }
+    }
+    load_dwarf_pub_names(cache, NULL, NULL);
+    for (n = 0; n < objs_cnt; n++) {
+        char * res = NULL;
+        if (ids[n] == NULL) continue;
+        res = get_symbol_ids(objs[n]->mName);
+        if (strcmp(res, ids[n]) != 0) {
+            printf("Name          : %s\n", objs[n]->mName);
+            printf("With index    : %s\n", ids[n]);
+            printf("Without index : %s\n", res);
+            set_errno(ERR_OTHER, "Symbol search result depends on the name index");
+            error("find_symbol_by_name");
+        }
+        loc_free(res);
+        loc_free(ids[n]);
+        tmp_gc();
+    }
+    loc_free(objs);
+    loc_free(ids);
+}
+
+static void test_disk_cache_file_names(void) {
+    /* Check that file name hashes restored from the disk cache are same as hashes in line info headers,
+     * then save the hashes, so the next run of the test can check them. */
+    DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
+    DWARFDiskCache * disk_cache = cache->mDiskCache;
+    unsigned idx;
+
+    if (disk_cache == NULL) return;
+    for (idx = 1; idx < cache->mFile->section_cnt; idx++) {
+        ObjectInfo * info = cache->mObjectHashTable[idx].mCompUnits;
+        while (info != NULL) {
+            CompUnit * unit = info->mCompUnit;
+            if (!unit->mLineInfoLoaded && !unit->mFileNameHashLoaded) {
+                Trap trap;
+                unsigned * hashes = NULL;
+                U4_T cnt = 0;
+                if (set_trap(&trap)) {
+                    has_line_file_name_hash(unit, 0);
+                    clear_trap(&trap);
+                }
+                if (unit->mFileNameHashLoaded) {
+                    cnt = unit->mFileNameHashCnt;
+                    hashes = (unsigned *)tmp_alloc(sizeof(unsigned) * (cnt + 1));
+                    memcpy(hashes, unit->mFileNameHash, sizeof(unsigned) * cnt);
+                    loc_free(unit->mFileNameHash);
+                    unit->mFileNameHash = NULL;
+                    unit->mFileNameHashCnt = 0;
+                    unit->mFileNameHashLoaded = 0;
+                    cache->mDiskCache = NULL;
+                    if (set_trap(&trap)) {
+                        has_line_file_name_hash(unit, 0);
+                        clear_trap(&trap);
+                    }
+                    cache->mDiskCache = disk_cache;
+                    if (unit->mFileNameHashCnt != cnt || memcmp(hashes, unit->mFileNameHash, sizeof(unsigned) * cnt) != 0) {
+                        printf("Unit          : %s\n", info->mName);
+                        set_errno(ERR_OTHER, "Invalid file names in the disk cache");
+                        error("has_line_file_name_hash");
+                    }
+                }
+            }
+            info = get_dwarf_sibling(info);
+        }
+    }
+    dwarf_disk_cache_save(cache);
+    tmp_gc();
+}
+
 static void test_public_names(void) {
     DWARFCache * cache = get_dwarf_cache(get_dwarf_file(elf_file));
     unsigned n = 0;
     unsigned m = 0;
     time_t time_start = time(0);
+    load_dwarf_pub_names(cache, NULL, NULL);
     while (n < cache->mPubNames.mCnt) {
         ObjectInfo * obj = cache->mPubNames.mNext[n++].mObject;
-        if (obj != NULL && (obj->mParent == NULL || obj->mParent->mTag != TAG_namespace)) {
+        if (obj != NULL && (obj->mParent == 0 || get_dwarf_loaded_parent(obj)->mTag != TAG_namespace)) {
             Symbol * sym1 = NULL;
             Symbol * sym2 = NULL;
             ContextAddress addr = 0;
@@ -1736,6 +1907,26 @@ static void next_region(void) {
     ContextAddress isa_range_addr = 0;
     ContextAddress isa_range_size = 0;
 
+    if (loaded) {
+        /* Exclude the name index and disk cache tests from the load time */
+        struct timespec time_test;
+        get_dwarf_cache(get_dwarf_file(elf_file));
+        clock_gettime(CLOCK_REALTIME, &time_now);
+        test_name_index();
+        test_disk_cache_file_names();
+        clock_gettime(CLOCK_REALTIME, &time_test);
+        time_start.tv_sec += time_test.tv_sec - time_now.tv_sec;
+        time_start.tv_nsec += time_test.tv_nsec - time_now.tv_nsec;
+        if (time_start.tv_nsec < 0) {
+            time_start.tv_sec--;
+            time_start.tv_nsec += 1000000000;
+        }
+        else if (time_start.tv_nsec >= 1000000000) {
+            time_start.tv_sec++;
+            time_start.tv_nsec -= 1000000000;
+        }
+    }
+
     for (;;) {
         if (mem_region_pos < 0) {
             mem_region_pos = 0;
@@ -2420,6 +2611,7 @@ static void add_dir(const char * dir_name) {
 
 void init_contexts_sys_dep(void) {
     const char * dir_name = ".";
+    set_dwarf_disk_cache(getenv("DWARF_TEST_CACHE"), 0);
     add_dir(dir_name);
     test_posted = 1;
     post_event(test, NULL);
@@ -101,4 +101,10 @@
 #define ENABLE_PortForwardProxy                 0
 #define ENABLE_LibWebSockets                    0
 
+/* The test compares symbol search with and without name index, then checks all public names */
+#define ENABLE_DWARF_NAME_INDEX                 1
+
+/* DWARF_TEST_CACHE environment variable sets on-disk cache directory, run the test twice to check cached indices */
+#define ENABLE_DwarfDiskCache                   1
+
 #endif /* D_config */
@@ -0,0 +1,145 @@
+/*******************************************************************************
+ * Copyright (c) 2026 Wind River Systems, Inc. and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ * You may elect to redistribute this code under either of these licenses.
+ *
+ * Contributors:
+ *     Wind River Systems - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Micro-benchmark of the event queue timers:
+ * post_event_with_delay() and cancel_event() throughput with many pending timers,
+ * and throughput of events posted by background threads.
+ *
+ * Usage: timer-bench [<number of timers>]
+ */
+
+#include <tcf/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <tcf/framework/mdep-threads.h>
+#include <tcf/framework/myalloc.h>
+#include <tcf/framework/errors.h>
+#include <tcf/framework/trace.h>
+#include <tcf/framework/events.h>
+
+#define BG_THREAD_CNT   4
+#define BG_EVENT_CNT    100000
+
+static int timer_cnt = 100000;
+static char * timer_args = NULL;
+static int bg_done_cnt = 0;
+static int bg_next[BG_THREAD_CNT];
+static struct timespec time_start;
+
+static void start_time(void) {
+    clock_gettime(CLOCK_MONOTONIC, &time_start);
+}
+
+static void print_time(const char * name, int cnt) {
+    struct timespec time_now;
+    double t;
+    clock_gettime(CLOCK_MONOTONIC, &time_now);
+    t = (double)(time_now.tv_sec - time_start.tv_sec) + (double)(time_now.tv_nsec - time_start.tv_nsec) / 1e9;
+    printf("%-32s %9d ops %8.3f sec %10.0f ops/sec\n", name, cnt, t, t > 0 ? cnt / t : 0.0);
+    fflush(stdout);
+}
+
+static void timer_event(void * args) {
+    fprintf(stderr, "Unexpected timer event\n");
+    exit(1);
+}
+
+static void bg_event(void * args) {
+    /* Events posted by same thread must be dispatched in order */
+    uintptr_t n = (uintptr_t)args;
+    if ((int)(n % BG_EVENT_CNT) != bg_next[n / BG_EVENT_CNT]++) {
+        fprintf(stderr, "Background events out of order\n");
+        exit(1);
+    }
+    if (++bg_done_cnt < BG_THREAD_CNT * BG_EVENT_CNT) return;
+    print_time("post_event (background threads)", bg_done_cnt);
+    cancel_event_loop();
+}
+
+static void * bg_thread(void * args) {
+    uintptr_t i;
+    uintptr_t n = (uintptr_t)args * BG_EVENT_CNT;
+    for (i = 0; i < BG_EVENT_CNT; i++) post_event(bg_event, (void *)(n + i));
+    return NULL;
+}
+
+static void run_benchmark(void * args) {
+    int i;
+    int * order = (int *)loc_alloc(sizeof(int) * timer_cnt);
+    pthread_t threads[BG_THREAD_CNT];
+
+    timer_args = (char *)loc_alloc_zero(timer_cnt);
+    for (i = 0; i < timer_cnt; i++) order[i] = i;
+    for (i = timer_cnt - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int x = order[i];
+        order[i] = order[j];
+        order[j] = x;
+    }
+
+    /* Delays from 100 to 200 seconds, so the timers never expire while the benchmark runs */
+    start_time();
+    for (i = 0; i < timer_cnt; i++) {
+        post_event_with_delay(timer_event, timer_args + i, 100000000 + (unsigned long)(rand() % 100000) * 1000);
+    }
+    print_time("post_event_with_delay", timer_cnt);
+
+    /* Re-arm pattern used by cache and channel timers: cancel and post again */
+    start_time();
+    for (i = 0; i < timer_cnt; i++) {
+        char * arg = timer_args + order[i];
+        if (!cancel_event(timer_event, arg, 0)) {
+            fprintf(stderr, "Timer not found\n");
+            exit(1);
+        }
+        post_event_with_delay(timer_event, arg, 100000000 + (unsigned long)(rand() % 100000) * 1000);
+    }
+    print_time("cancel_event + post (re-arm)", timer_cnt);
+
+    start_time();
+    for (i = 0; i < timer_cnt; i++) {
+        if (!cancel_event(timer_event, timer_args + order[i], 0)) {
+            fprintf(stderr, "Timer not found\n");
+            exit(1);
+        }
+    }
+    print_time("cancel_event", timer_cnt);
+    loc_free(order);
+
+    start_time();
+    for (i = 0; i < BG_THREAD_CNT; i++) {
+        check_error(pthread_create(threads + i, NULL, bg_thread, (void *)(uintptr_t)i));
+    }
+    for (i = 0; i < BG_THREAD_CNT; i++) {
+        check_error(pthread_detach(threads[i]));
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) timer_cnt = atoi(argv[1]);
+    if (timer_cnt <= 0) {
+        fprintf(stderr, "Invalid number of timers: %s\n", argv[1]);
+        return 1;
+    }
+    ini_mdep();
+    ini_trace();
+    ini_events_queue();
+    post_event(run_benchmark, NULL);
+    run_event_loop();
+    return 0;
+}